@@ -109,6 +109,10 @@ LOCAL_C_INCLUDES := \
 
 LOCAL_SRC_FILES := \
 		jni/src/ban.cpp                           \
+		jni/src/benchmark/benchmark.cpp           \
+		jni/src/benchmark/benchmark_areastore.cpp \
+		jni/src/benchmark/benchmark_biome.cpp     \
+		jni/src/benchmark/benchmark_mapblock_mesh.cpp \
 		jni/src/chat.cpp                          \
 		jni/src/client/activeobjectmgr.cpp        \
 		jni/src/client/camera.cpp                 \
@@ -223,6 +227,8 @@ LOCAL_SRC_FILES := \
 		jni/src/mapgen/mg_decoration.cpp          \
 		jni/src/mapgen/mg_ore.cpp                 \
 		jni/src/mapgen/mg_schematic.cpp           \
+		jni/src/mapgen/noise_cache.cpp            \
+		jni/src/mapgen/placement_batch.cpp        \
 		jni/src/mapgen/treegen.cpp                \
 		jni/src/mapnode.cpp                       \
 		jni/src/mapsector.cpp                     \
@@ -259,19 +265,24 @@ LOCAL_SRC_FILES := \
 		jni/src/tool.cpp                          \
 		jni/src/translation.cpp                   \
 		jni/src/unittest/test_authdatabase.cpp    \
+		jni/src/unittest/test_biome.cpp           \
 		jni/src/unittest/test_collision.cpp       \
 		jni/src/unittest/test_compression.cpp     \
 		jni/src/unittest/test_connection.cpp      \
+		jni/src/unittest/test_craftdef.cpp        \
 		jni/src/unittest/test.cpp                 \
 		jni/src/unittest/test_filepath.cpp        \
 		jni/src/unittest/test_gameui.cpp          \
 		jni/src/unittest/test_inventory.cpp       \
+		jni/src/unittest/test_mapblock_mesh.cpp   \
 		jni/src/unittest/test_mapnode.cpp         \
 		jni/src/unittest/test_map_settings_manager.cpp \
 		jni/src/unittest/test_nodedef.cpp         \
 		jni/src/unittest/test_noderesolver.cpp    \
+		jni/src/unittest/test_nodetimer.cpp       \
 		jni/src/unittest/test_noise.cpp           \
 		jni/src/unittest/test_objdef.cpp          \
+		jni/src/unittest/test_pathfinder.cpp      \
 		jni/src/unittest/test_profiler.cpp        \
 		jni/src/unittest/test_random.cpp          \
 		jni/src/unittest/test_schematic.cpp       \
@@ -367,6 +378,7 @@ LOCAL_SRC_FILES += \
 		jni/src/script/lua_api/l_util.cpp         \
 		jni/src/script/lua_api/l_vmanip.cpp       \
 		jni/src/script/scripting_client.cpp       \
+		jni/src/script/scripting_emerge.cpp       \
 		jni/src/script/scripting_server.cpp       \
 		jni/src/script/scripting_mainmenu.cpp
 
@@ -416,6 +428,7 @@ LOCAL_SRC_FILES += deps/sqlite/sqlite3.c
 LOCAL_SRC_FILES += \
 		jni/src/threading/event.cpp \
 		jni/src/threading/semaphore.cpp \
+		jni/src/threading/task_pool.cpp \
 		jni/src/threading/thread.cpp
 
 # JSONCPP
@@ -1,17 +1,23 @@
 
 core.log("info", "Initializing Asynchronous environment")
 
-function core.job_processor(serialized_func, serialized_param)
-	local func = loadstring(serialized_func)
+local function pack(...)
+	return {n = select("#", ...), ...}
+end
+
+function core.job_processor(func, serialized_param, objects)
 	local param = core.deserialize(serialized_param)
 	local retval = nil
 
-	if type(func) == "function" then
-		retval = core.serialize(func(param))
+	if objects then
+		-- Argument list of a server job, native objects are passed apart
+		for i, index in ipairs(param.objects) do
+			param[index] = objects[i]
+		end
+		retval = core.serialize(pack(func(unpack(param, 1, param.n))))
 	else
-		core.log("error", "ASYNC WORKER: Unable to deserialize function")
+		retval = core.serialize(func(param))
 	end
 
 	return retval or core.serialize(nil)
 end
-
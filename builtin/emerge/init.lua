@@ -0,0 +1,22 @@
+
+core.log("info", "Initializing mapgen environment")
+
+-- Reduced copy of core.run_callbacks, only the modes used by the engine
+-- in this environment are needed
+function core.run_callbacks(callbacks, mode, ...)
+	assert(type(callbacks) == "table")
+	local ret
+	for i = 1, #callbacks do
+		local cb_ret = callbacks[i](...)
+		if mode == 0 and i == 1 or mode == 1 and i == #callbacks then
+			ret = cb_ret
+		end
+	end
+	return ret
+end
+
+core.registered_on_generateds = {}
+
+function core.register_on_generated(func)
+	core.registered_on_generateds[#core.registered_on_generateds + 1] = func
+end
@@ -0,0 +1,42 @@
+
+core.async_jobs = {}
+
+function core.async_event_handler(jobid, serialized_retval, err)
+	local callback = core.async_jobs[jobid]
+	assert(type(callback) == "function")
+	core.async_jobs[jobid] = nil
+
+	local retval = not err and core.deserialize(serialized_retval)
+	if type(retval) ~= "table" then
+		err = err or "Invalid result of async job"
+		core.log("error", "Async job " .. jobid .. " failed: " .. err)
+		callback(nil, err)
+		return
+	end
+	callback(unpack(retval, 1, retval.n))
+end
+
+function core.handle_async(func, callback, ...)
+	assert(type(func) == "function" and type(callback) == "function",
+		"Invalid core.handle_async invocation")
+
+	-- VoxelManips and ItemStacks are copied by the engine, everything else
+	-- is serialized
+	local args = {n = select("#", ...), objects = {}}
+	local objects = {}
+	for i = 1, args.n do
+		local arg = select(i, ...)
+		if type(arg) == "userdata" then
+			objects[#objects + 1] = arg
+			args.objects[#objects] = i
+		else
+			args[i] = arg
+		end
+	end
+
+	local jobid = core.do_async_callback(func, core.serialize(args),
+		unpack(objects))
+	core.async_jobs[jobid] = callback
+
+	return true
+end
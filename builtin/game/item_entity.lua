@@ -286,11 +286,15 @@ core.register_entity(":__builtin:item", {
 			return
 		end
 		-- Collect the items around to merge with
+		self:merge_with_objects(core.get_objects_inside_radius(pos, 1.0))
+	end,
+
+	-- Also called by the engine when a natively stepped item comes to rest
+	merge_with_objects = function(self, objects)
 		local own_stack = ItemStack(self.itemstring)
 		if own_stack:get_free_space() == 0 then
 			return
 		end
-		local objects = core.get_objects_inside_radius(pos, 1.0)
 		for k, obj in pairs(objects) do
 			local entity = obj:get_luaentity()
 			if entity and entity.name == "__builtin:item" then
@@ -317,3 +321,9 @@ core.register_entity(":__builtin:item", {
 		self.object:remove()
 	end,
 })
+
+-- The engine runs on_step natively as long as mods don't override it.
+-- 'age' is synced before the engine calls into the entity, the other
+-- state fields are not updated in that case.
+local item_def = core.registered_entities["__builtin:item"]
+item_def.native_on_step = item_def.on_step
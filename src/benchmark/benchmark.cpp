@@ -0,0 +1,88 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "benchmark.h"
+
+#include <iomanip>
+#include <sstream>
+#include "log.h"
+#include "porting.h"
+
+////
+//// run_benchmarks
+////
+
+int run_benchmarks()
+{
+	u64 t1 = porting::getTimeMs();
+
+	g_logger.setLevelSilenced(LL_ERROR, true);
+
+	u32 num_total_benchmarks_run = 0;
+	std::vector<BenchmarkBase *> &modules = BenchmarkManager::getBenchmarkModules();
+	for (BenchmarkBase *module : modules) {
+		module->benchmarkModule();
+		num_total_benchmarks_run += module->num_benchmarks_run;
+	}
+
+	u64 tdiff = porting::getTimeMs() - t1;
+
+	g_logger.setLevelSilenced(LL_ERROR, false);
+
+	rawstream
+		<< "++++++++++++++++++++++++++++++++++++++++"
+		<< "++++++++++++++++++++++++++++++++++++++++" << std::endl
+		<< "Benchmarks: " << num_total_benchmarks_run << " cases in "
+		<< modules.size() << " modules." << std::endl
+		<< "    Benchmarking took " << tdiff << "ms total." << std::endl
+		<< "++++++++++++++++++++++++++++++++++++++++"
+		<< "++++++++++++++++++++++++++++++++++++++++" << std::endl;
+
+	return 0;
+}
+
+////
+//// BenchmarkBase
+////
+
+void BenchmarkBase::benchmarkModule()
+{
+	rawstream << "======== Benchmarking module " << getName() << std::endl;
+	u64 t1 = porting::getTimeMs();
+
+	runBenchmarks();
+
+	u64 tdiff = porting::getTimeMs() - t1;
+	rawstream << "======== Module " << getName() << " done ("
+		<< num_benchmarks_run << " cases) - " << tdiff << "ms" << std::endl;
+}
+
+void BenchmarkBase::report(const std::string &name, u32 iterations, u64 time_us)
+{
+	num_benchmarks_run++;
+
+	double per_iteration = iterations ? (double)time_us / iterations : 0.0;
+	std::ostringstream os;
+	os << std::left << std::setw(48) << name << std::right
+		<< std::setw(8) << iterations << " iterations "
+		<< std::setw(10) << time_us / 1000 << "ms "
+		<< std::fixed << std::setprecision(2) << std::setw(12)
+		<< per_iteration << "us/iteration";
+	rawstream << os.str() << std::endl;
+}
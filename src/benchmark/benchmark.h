@@ -0,0 +1,61 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "irrlichttypes.h"
+
+/*
+	Benchmarks are run with --run-benchmarks. Unlike the unit tests they
+	do not check results; each module measures a hot path and reports the
+	time spent per iteration so that changes can be compared objectively.
+*/
+
+class BenchmarkBase {
+public:
+	void benchmarkModule();
+
+	virtual void runBenchmarks() = 0;
+	virtual const char *getName() = 0;
+
+	u32 num_benchmarks_run = 0;
+
+protected:
+	// Reports one measured case: total time of all iterations in microseconds
+	void report(const std::string &name, u32 iterations, u64 time_us);
+};
+
+class BenchmarkManager {
+public:
+	static std::vector<BenchmarkBase *> &getBenchmarkModules()
+	{
+		static std::vector<BenchmarkBase *> m_modules_to_benchmark;
+		return m_modules_to_benchmark;
+	}
+
+	static void registerBenchmarkModule(BenchmarkBase *module)
+	{
+		getBenchmarkModules().push_back(module);
+	}
+};
+
+int run_benchmarks();
@@ -0,0 +1,155 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "benchmark.h"
+
+#include <sstream>
+#include "log.h"
+#include "noise.h"
+#include "porting.h"
+#include "util/areastore.h"
+
+/*
+	Compares VectorAreaStore with RTreeAreaStore for stores of different
+	sizes: insertion, position and area queries, and loading a serialized
+	store.
+
+	Areas are small protected regions scattered over a part of the map,
+	similar to what protection mods create. The getAreasForPos cache is
+	disabled to measure the stores themselves.
+*/
+
+class BenchmarkAreaStore : public BenchmarkBase {
+public:
+	BenchmarkAreaStore() { BenchmarkManager::registerBenchmarkModule(this); }
+	const char *getName() { return "BenchmarkAreaStore"; }
+
+	void runBenchmarks();
+
+	void benchmarkStores(u32 num_areas);
+
+private:
+	// Number of queries per case
+	static const u32 QUERIES = 2000;
+
+	template <typename T>
+	void benchmarkStore(const std::string &name,
+		const std::vector<Area> &areas, const std::vector<v3s16> &positions,
+		const std::string &serialized);
+};
+
+static BenchmarkAreaStore g_benchmark_instance;
+
+void BenchmarkAreaStore::runBenchmarks()
+{
+	benchmarkStores(1000);
+	benchmarkStores(10000);
+	benchmarkStores(100000);
+}
+
+void BenchmarkAreaStore::benchmarkStores(u32 num_areas)
+{
+	PcgRandom pr(31337);
+	const s16 range = 4000;
+
+	std::vector<Area> areas;
+	areas.reserve(num_areas);
+	for (u32 i = 0; i < num_areas; i++) {
+		v3s16 minedge(pr.range(-range, range), pr.range(-100, 100),
+			pr.range(-range, range));
+		v3s16 size(pr.range(2, 40), pr.range(2, 40), pr.range(2, 40));
+		areas.emplace_back(minedge, minedge + size);
+	}
+
+	std::vector<v3s16> positions(QUERIES);
+	for (v3s16 &pos : positions)
+		pos = v3s16(pr.range(-range, range), pr.range(-100, 100),
+			pr.range(-range, range));
+
+	std::string serialized;
+	{
+		VectorAreaStore store;
+		for (Area a : areas)
+			store.insertArea(&a);
+		std::ostringstream os(std::ios_base::binary);
+		store.serialize(os);
+		serialized = os.str();
+	}
+
+	const std::string suffix = ", " + std::to_string(num_areas) + " areas";
+
+	benchmarkStore<VectorAreaStore>("vector" + suffix, areas, positions,
+		serialized);
+	benchmarkStore<RTreeAreaStore>("rtree" + suffix, areas, positions,
+		serialized);
+}
+
+template <typename T>
+void BenchmarkAreaStore::benchmarkStore(const std::string &name,
+	const std::vector<Area> &areas, const std::vector<v3s16> &positions,
+	const std::string &serialized)
+{
+	T store_obj;
+	AreaStore *store = &store_obj;
+	store->setCacheParams(false, 16, 20);
+
+	u64 t1 = porting::getTimeUs();
+	for (Area a : areas)
+		store->insertArea(&a);
+	report(name + ", insert", areas.size(), porting::getTimeUs() - t1);
+
+	std::vector<Area *> result;
+	size_t found = 0;
+
+	t1 = porting::getTimeUs();
+	for (const v3s16 &pos : positions) {
+		store->getAreasForPos(&result, pos);
+		found += result.size();
+		result.clear();
+	}
+	report(name + ", get_areas_for_pos", positions.size(),
+		porting::getTimeUs() - t1);
+
+	t1 = porting::getTimeUs();
+	for (const v3s16 &pos : positions) {
+		store->getAreasInArea(&result, pos, pos + v3s16(64, 64, 64), true);
+		found += result.size();
+		result.clear();
+	}
+	report(name + ", get_areas_in_area", positions.size(),
+		porting::getTimeUs() - t1);
+
+	// Remove a quarter of the areas, insertion assigned IDs from 0
+	t1 = porting::getTimeUs();
+	for (u32 id = 0; id < areas.size(); id += 4)
+		store->removeArea(id);
+	report(name + ", remove", (areas.size() + 3) / 4,
+		porting::getTimeUs() - t1);
+
+	// Loading into an empty store, as done by from_file()
+	T loaded;
+	std::istringstream is(serialized, std::ios_base::binary);
+	t1 = porting::getTimeUs();
+	loaded.deserialize(is);
+	report(name + ", deserialize", areas.size(), porting::getTimeUs() - t1);
+
+	// Keeps the queries from being optimized out
+	verbosestream << "BenchmarkAreaStore: " << name << ": found "
+		<< found << " areas" << std::endl;
+}
@@ -0,0 +1,157 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "benchmark.h"
+
+#include "log.h"
+#include "mapgen/mg_biome.h"
+#include "noise.h"
+#include "porting.h"
+
+/*
+	Compares the linear scan over all biomes with the BiomeLookup
+	structure, for biome sets of different sizes.
+
+	Biomes are generated deterministically in layers like those of typical
+	games: deep underground, ocean, beach with vertical blend, land and
+	highlands, a few of them with X/Z limits.
+*/
+
+class BenchmarkBiome : public BenchmarkBase {
+public:
+	BenchmarkBiome() { BenchmarkManager::registerBenchmarkModule(this); }
+	const char *getName() { return "BenchmarkBiome"; }
+
+	void runBenchmarks();
+
+	void benchmarkBiomes(u32 num_biomes);
+
+private:
+	// Number of looked up positions per pass
+	static const u32 QUERIES = 1 << 16;
+	// Number of passes over all positions per case
+	static const u32 PASSES = 10;
+
+	struct Query {
+		float heat;
+		float humidity;
+		v3s16 pos;
+	};
+};
+
+static BenchmarkBiome g_benchmark_instance;
+
+void BenchmarkBiome::runBenchmarks()
+{
+	benchmarkBiomes(16);
+	benchmarkBiomes(128);
+	benchmarkBiomes(240);
+}
+
+void BenchmarkBiome::benchmarkBiomes(u32 num_biomes)
+{
+	BiomeManager bmgr(nullptr);
+	PcgRandom pr(4242);
+
+	const s16 limit = 31000;
+	for (u32 i = 0; i < num_biomes; i++) {
+		Biome *b = BiomeManager::create(BIOMETYPE_NORMAL);
+		b->name = "bench_biome_" + std::to_string(i);
+		b->flags = 0;
+		b->heat_point = pr.range(0, 100);
+		b->humidity_point = pr.range(0, 100);
+		b->vertical_blend = 0;
+		b->min_pos = v3s16(-limit, -limit, -limit);
+		b->max_pos = v3s16(limit, limit, limit);
+
+		switch (i % 5) {
+		case 0: // Underground
+			b->max_pos.Y = -256;
+			break;
+		case 1: // Ocean
+			b->min_pos.Y = -255;
+			b->max_pos.Y = -2;
+			break;
+		case 2: // Beach
+			b->min_pos.Y = -1;
+			b->max_pos.Y = 4;
+			b->vertical_blend = 2;
+			break;
+		case 3: // Land
+			b->min_pos.Y = 5;
+			b->max_pos.Y = 60 + pr.range(0, 4) * 10;
+			b->vertical_blend = pr.range(0, 8);
+			break;
+		default: // Highland
+			b->min_pos.Y = 61 + pr.range(0, 4) * 10;
+			break;
+		}
+
+		if (i % 16 == 15) {
+			b->min_pos.X = pr.range(-2000, 0);
+			b->max_pos.X = b->min_pos.X + 1000;
+		}
+
+		bmgr.add(b);
+	}
+
+	bmgr.updateLookup();
+
+	std::vector<Query> queries(QUERIES);
+	for (Query &q : queries) {
+		// Heat and humidity noise: offset 50, scale 50, 3 octaves
+		q.heat = 50.0f + (pr.range(-1000, 1000) + pr.range(-1000, 1000)) * 0.04f;
+		q.humidity = 50.0f + (pr.range(-1000, 1000) + pr.range(-1000, 1000)) * 0.04f;
+		q.pos = v3s16(pr.range(-3000, 3000), pr.range(-300, 300),
+			pr.range(-3000, 3000));
+	}
+
+	u32 mismatches = 0;
+	for (const Query &q : queries) {
+		if (bmgr.getBiomeFromNoiseLinear(q.heat, q.humidity, q.pos) !=
+				bmgr.getBiomeFromNoiseOriginal(q.heat, q.humidity, q.pos))
+			mismatches++;
+	}
+	if (mismatches > 0) {
+		rawstream << "BenchmarkBiome: lookup differs from linear scan for "
+			<< mismatches << " positions" << std::endl;
+	}
+
+	const std::string suffix = ", " + std::to_string(num_biomes) + " biomes";
+	u64 checksum = 0;
+
+	u64 t1 = porting::getTimeUs();
+	for (u32 pass = 0; pass < PASSES; pass++) {
+		for (const Query &q : queries)
+			checksum += bmgr.getBiomeFromNoiseLinear(
+				q.heat, q.humidity, q.pos)->index;
+	}
+	report("linear scan" + suffix, PASSES * QUERIES, porting::getTimeUs() - t1);
+
+	t1 = porting::getTimeUs();
+	for (u32 pass = 0; pass < PASSES; pass++) {
+		for (const Query &q : queries)
+			checksum -= bmgr.getBiomeFromNoiseOriginal(
+				q.heat, q.humidity, q.pos)->index;
+	}
+	report("lookup" + suffix, PASSES * QUERIES, porting::getTimeUs() - t1);
+
+	// Keeps the loops from being optimized out, zero if both agree
+	verbosestream << "BenchmarkBiome: checksum " << checksum << std::endl;
+}
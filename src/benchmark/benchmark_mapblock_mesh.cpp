@@ -0,0 +1,300 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "benchmark.h"
+
+#include <cmath>
+#include <map>
+#include "client/mapblock_mesh.h"
+#include "client/renderingengine.h"
+#include "client/shader.h"
+#include "client/tile.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "porting.h"
+#include "settings.h"
+
+/*
+	Builds MapBlockMesh for every block of a generated region, using
+	Irrlicht's null driver so that no window is required.
+
+	The region is produced deterministically from a fixed seed, so results
+	are comparable between builds. Each scenario enables a different set of
+	drawtypes on top of the base terrain.
+*/
+
+enum MeshBenchmarkScenario {
+	MESH_BENCHMARK_CUBES,   // Normal drawtype only
+	MESH_BENCHMARK_LIQUID,  // Plus liquid sources and glasslike
+	MESH_BENCHMARK_MIXED,   // Plus allfaces leaves, plantlike and nodeboxes
+};
+
+class BenchmarkMapblockMesh : public BenchmarkBase {
+public:
+	BenchmarkMapblockMesh() { BenchmarkManager::registerBenchmarkModule(this); }
+	const char *getName() { return "BenchmarkMapblockMesh"; }
+
+	void runBenchmarks();
+
+	void defineNodes();
+	void generateRegion(MeshBenchmarkScenario scenario);
+	void benchmarkRegion(const std::string &name, bool smooth_lighting,
+			bool greedy_meshing);
+
+private:
+	// Number of meshed blocks along each axis
+	static const s16 REGION_BLOCKS = 4;
+	// Number of passes over the whole region per case
+	static const u32 PASSES = 3;
+
+	content_t defineNode(const std::string &name, NodeDrawType drawtype,
+			const std::string &texture);
+
+	NodeDefManager *m_ndef = nullptr;
+	IWritableTextureSource *m_tsrc = nullptr;
+	IWritableShaderSource *m_shdrsrc = nullptr;
+	TextureSettings m_tsettings;
+
+	content_t c_stone, c_dirt, c_grass, c_water, c_glass, c_leaves,
+		c_plant, c_slab;
+
+	// Block data including a border of one block around the meshed region
+	std::map<v3s16, std::vector<MapNode>> m_blocks;
+};
+
+static BenchmarkMapblockMesh g_benchmark_instance;
+
+void BenchmarkMapblockMesh::runBenchmarks()
+{
+	g_settings->set("video_driver", "null");
+	g_settings->setBool("enable_shaders", false);
+	g_settings->setBool("enable_minimap", false);
+	g_settings->setBool("enable_vbo", false);
+
+	RenderingEngine *engine = new RenderingEngine(nullptr);
+	m_tsrc = createTextureSource();
+	m_shdrsrc = createShaderSource();
+	m_ndef = createNodeDefManager();
+	m_tsettings.readSettings();
+
+	defineNodes();
+
+	generateRegion(MESH_BENCHMARK_CUBES);
+	benchmarkRegion("cubes, flat lighting", false, false);
+	benchmarkRegion("cubes, smooth lighting", true, false);
+	benchmarkRegion("cubes, flat lighting, greedy", false, true);
+	benchmarkRegion("cubes, smooth lighting, greedy", true, true);
+
+	generateRegion(MESH_BENCHMARK_LIQUID);
+	benchmarkRegion("liquid, flat lighting", false, false);
+	benchmarkRegion("liquid, smooth lighting", true, false);
+
+	generateRegion(MESH_BENCHMARK_MIXED);
+	benchmarkRegion("mixed, flat lighting", false, false);
+	benchmarkRegion("mixed, smooth lighting", true, false);
+	benchmarkRegion("mixed, smooth lighting, greedy", true, true);
+
+	m_blocks.clear();
+	delete m_ndef;
+	delete m_shdrsrc;
+	delete m_tsrc;
+	delete engine;
+}
+
+content_t BenchmarkMapblockMesh::defineNode(const std::string &name,
+		NodeDrawType drawtype, const std::string &texture)
+{
+	ContentFeatures f;
+	f.name = name;
+	f.drawtype = drawtype;
+	for (TileDef &tiledef : f.tiledef)
+		tiledef.name = texture;
+
+	if (drawtype != NDT_NORMAL) {
+		f.param_type = CPT_LIGHT;
+		f.light_propagates = true;
+		f.sunlight_propagates = drawtype != NDT_LIQUID;
+	}
+	if (drawtype == NDT_LIQUID) {
+		f.alpha = 160;
+		f.liquid_type = LIQUID_SOURCE;
+		f.liquid_alternative_source = name;
+		f.liquid_alternative_flowing = name;
+		f.walkable = false;
+	} else if (drawtype == NDT_PLANTLIKE) {
+		f.walkable = false;
+	} else if (drawtype == NDT_NODEBOX) {
+		f.node_box.type = NODEBOX_FIXED;
+		f.node_box.fixed.emplace_back(-BS / 2, -BS / 2, -BS / 2,
+				BS / 2, 0, BS / 2);
+	}
+
+	// Only tiles are needed for meshing, skip NodeDefManager::updateTextures
+	// which requires a Client
+	f.updateTextures(m_tsrc, m_shdrsrc,
+			RenderingEngine::get_scene_manager()->getMeshManipulator(),
+			nullptr, m_tsettings);
+	return m_ndef->set(name, f);
+}
+
+void BenchmarkMapblockMesh::defineNodes()
+{
+	const std::string base = "[combine:16x16^[colorize:";
+	c_stone  = defineNode("bench:stone", NDT_NORMAL, base + "#707070");
+	c_dirt   = defineNode("bench:dirt", NDT_NORMAL, base + "#6b4a2b");
+	c_grass  = defineNode("bench:grass", NDT_NORMAL, base + "#3f8f2f");
+	c_water  = defineNode("bench:water", NDT_LIQUID, base + "#2050c0");
+	c_glass  = defineNode("bench:glass", NDT_GLASSLIKE, base + "#c0e0ff");
+	c_leaves = defineNode("bench:leaves", NDT_ALLFACES_OPTIONAL, base + "#2f6f1f");
+	c_plant  = defineNode("bench:plant", NDT_PLANTLIKE, base + "#50b040");
+	c_slab   = defineNode("bench:slab", NDT_NODEBOX, base + "#a08060");
+}
+
+void BenchmarkMapblockMesh::generateRegion(MeshBenchmarkScenario scenario)
+{
+	const s16 size = (REGION_BLOCKS + 2) * MAP_BLOCKSIZE;
+	const s16 water_level = size / 2 - 4;
+	const MapNode n_air(CONTENT_AIR);
+	PcgRandom pr(1337);
+
+	// Generate the region into one flat array first, indexed z, y, x
+	std::vector<MapNode> region(size * size * size, n_air);
+	auto at = [&] (s16 x, s16 y, s16 z) -> MapNode & {
+		return region[(z * size + y) * size + x];
+	};
+
+	for (s16 z = 0; z < size; z++)
+	for (s16 x = 0; x < size; x++) {
+		s16 height = size / 2 + (s16)(6.0f * std::sin(x * 0.11f)
+				+ 5.0f * std::cos(z * 0.07f) + 3.0f * std::sin((x + z) * 0.23f));
+
+		for (s16 y = 0; y <= height && y < size; y++) {
+			if (y < height - 3)
+				at(x, y, z) = MapNode(c_stone);
+			else if (y < height)
+				at(x, y, z) = MapNode(c_dirt);
+			else
+				at(x, y, z) = MapNode(c_grass);
+		}
+
+		if (scenario == MESH_BENCHMARK_CUBES)
+			continue;
+
+		for (s16 y = height + 1; y <= water_level; y++)
+			at(x, y, z) = MapNode(c_water);
+
+		if (height + 1 <= water_level || height + 6 >= size)
+			continue;
+
+		if (scenario == MESH_BENCHMARK_LIQUID) {
+			if (pr.range(0, 99) < 2) {
+				for (s16 y = height + 1; y <= height + 4; y++)
+					at(x, y, z) = MapNode(c_glass);
+			}
+			continue;
+		}
+
+		s32 r = pr.range(0, 99);
+		if (r < 3) {
+			// Small tree: trunk of stone and a blob of leaves
+			for (s16 y = height + 1; y <= height + 3; y++)
+				at(x, y, z) = MapNode(c_stone);
+			for (s16 dz = -2; dz <= 2; dz++)
+			for (s16 dy = 3; dy <= 5; dy++)
+			for (s16 dx = -2; dx <= 2; dx++) {
+				s16 lx = x + dx, ly = height + dy, lz = z + dz;
+				if (lx < 0 || lx >= size || lz < 0 || lz >= size || ly >= size)
+					continue;
+				if (at(lx, ly, lz).getContent() == CONTENT_AIR)
+					at(lx, ly, lz) = MapNode(c_leaves);
+			}
+		} else if (r < 30) {
+			at(x, height + 1, z) = MapNode(c_plant);
+		} else if (r < 35) {
+			at(x, height + 1, z) = MapNode(c_slab);
+		}
+	}
+
+	// Simple sunlight: full light above the topmost light-blocking node
+	for (s16 z = 0; z < size; z++)
+	for (s16 x = 0; x < size; x++) {
+		u8 light = LIGHT_SUN;
+		for (s16 y = size - 1; y >= 0; y--) {
+			MapNode &n = at(x, y, z);
+			const ContentFeatures &f = m_ndef->get(n);
+			if (!f.sunlight_propagates)
+				light = f.light_propagates ? light - 1 : 0;
+			if (light > LIGHT_SUN)
+				light = 0;
+			n.setLight(LIGHTBANK_DAY, light, f);
+			n.setLight(LIGHTBANK_NIGHT, 0, f);
+		}
+	}
+
+	// Split into blocks, positions relative to the region origin
+	m_blocks.clear();
+	v3s16 bp;
+	for (bp.Z = -1; bp.Z <= REGION_BLOCKS; bp.Z++)
+	for (bp.Y = -1; bp.Y <= REGION_BLOCKS; bp.Y++)
+	for (bp.X = -1; bp.X <= REGION_BLOCKS; bp.X++) {
+		std::vector<MapNode> &data = m_blocks[bp];
+		data.resize(MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE);
+		v3s16 origin = (bp + v3s16(1, 1, 1)) * MAP_BLOCKSIZE;
+		u32 i = 0;
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+			data[i++] = at(origin.X + x, origin.Y + y, origin.Z + z);
+	}
+}
+
+void BenchmarkMapblockMesh::benchmarkRegion(const std::string &name,
+		bool smooth_lighting, bool greedy_meshing)
+{
+	u64 time_us = 0;
+	u32 iterations = 0;
+
+	for (u32 pass = 0; pass < PASSES; pass++) {
+		v3s16 bp;
+		for (bp.Z = 0; bp.Z < REGION_BLOCKS; bp.Z++)
+		for (bp.Y = 0; bp.Y < REGION_BLOCKS; bp.Y++)
+		for (bp.X = 0; bp.X < REGION_BLOCKS; bp.X++) {
+			// Copying the block data is done by the main thread in the
+			// client, only measure the mesh generation itself
+			MeshMakeData data(m_ndef, m_tsrc, m_shdrsrc, false);
+			data.fillBlockDataBegin(bp);
+			v3s16 dp;
+			for (dp.X = -1; dp.X <= 1; dp.X++)
+			for (dp.Y = -1; dp.Y <= 1; dp.Y++)
+			for (dp.Z = -1; dp.Z <= 1; dp.Z++)
+				data.fillBlockData(dp, &m_blocks[bp + dp][0]);
+			data.setSmoothLighting(smooth_lighting);
+			data.setGreedyMeshing(greedy_meshing);
+
+			u64 t1 = porting::getTimeUs();
+			MapBlockMesh *mesh = new MapBlockMesh(&data, v3s16(0, 0, 0));
+			time_us += porting::getTimeUs() - t1;
+			iterations++;
+
+			delete mesh;
+		}
+	}
+
+	report(name, iterations, time_us);
+}
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irrlichttypes_extrabloated.h"
 #include "inventory.h"
 #include "client/tile.h"
+#include "settings.h"
 #include <ICameraSceneNode.h>
 #include <ISceneNode.h>
 #include <list>
@@ -227,5 +228,10 @@ class Camera
 	f32 m_cache_fov;
 	bool m_arm_inertia;
 
+	// Settings read every frame
+	SettingHandle<bool> m_free_move{"free_move"};
+	SettingHandle<float> m_viewing_range{"viewing_range"};
+	SettingHandle<float> m_near_plane{"near_plane"};
+
 	std::list<Nametag *> m_nametags;
 };
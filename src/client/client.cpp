@@ -370,6 +370,9 @@ void Client::step(float dtime)
 			g_settings->getS32("client_mapblock_limit"),
 			&deleted_blocks);
 
+		if (!deleted_blocks.empty())
+			m_env.getClientMap().invalidateOcclusionCache();
+
 		/*
 			Send info to server
 			NOTE: This loop is intentionally iterated the way it is.
@@ -524,8 +527,11 @@ void Client::step(float dtime)
 				sendGotBlocks(blocks_to_ack);
 		}
 
-		if (num_processed_meshes > 0)
+		if (num_processed_meshes > 0) {
 			g_profiler->graphAdd("num_processed_meshes", num_processed_meshes);
+			// Nodes changed, blocks might have become visible or hidden
+			m_env.getClientMap().invalidateOcclusionCache();
+		}
 	}
 
 	/*
@@ -116,10 +116,8 @@ void ClientMap::updateDrawList()
 {
 	ScopeProfiler sp(g_profiler, "CM::updateDrawList()", SPT_AVG);
 
-	for (auto &i : m_drawlist) {
-		MapBlock *block = i.second;
+	for (MapBlock *block : m_drawlist)
 		block->refDrop();
-	}
 	m_drawlist.clear();
 
 	v3f camera_position = m_camera_position;
@@ -140,11 +138,13 @@ void ClientMap::updateDrawList()
 	u32 blocks_in_range_with_mesh = 0;
 	// Number of blocks occlusion culled
 	u32 blocks_occlusion_culled = 0;
+	// Number of blocks whose occlusion had to be checked
+	u32 blocks_occlusion_checked = 0;
 
 	// No occlusion culling when free_move is on and camera is
 	// inside ground
 	bool occlusion_culling_enabled = true;
-	if (g_settings->getBool("free_move") && g_settings->getBool("noclip")) {
+	if (m_free_move && m_noclip) {
 		MapNode n = getNode(cam_pos_nodes);
 		if (n.getContent() == CONTENT_IGNORE ||
 				m_nodedef->get(n).solidness == 2)
@@ -156,17 +156,18 @@ void ClientMap::updateDrawList()
 	//if (occlusion_culling_enabled && m_control.show_wireframe)
 	//    occlusion_culling_enabled = porting::getTimeS() & 1;
 
-	for (const auto &sector_it : m_sectors) {
-		MapSector *sector = sector_it.second;
-		v2s16 sp = sector->getPos();
+	if (cam_pos_nodes != m_occlusion_cam_pos) {
+		m_occlusion_cam_pos = cam_pos_nodes;
+		invalidateOcclusionCache();
+	}
 
-		if (!m_control.range_all) {
-			if (sp.X < p_blocks_min.X || sp.X > p_blocks_max.X ||
-					sp.Y < p_blocks_min.Z || sp.Y > p_blocks_max.Z)
-				continue;
-		}
+	float range = 100000 * BS;
+	if (!m_control.range_all)
+		range = m_control.wanted_range * BS;
 
-		MapBlockVect sectorblocks;
+	MapBlockVect sectorblocks;
+	auto add_sector = [&] (MapSector *sector) {
+		sectorblocks.clear();
 		sector->getBlocks(sectorblocks);
 
 		/*
@@ -184,16 +185,11 @@ void ClientMap::updateDrawList()
 			if (block->mesh)
 				block->mesh->updateCameraOffset(m_camera_offset);
 
-			float range = 100000 * BS;
-			if (!m_control.range_all)
-				range = m_control.wanted_range * BS;
-
 			float d = 0.0;
 			if (!isBlockInSight(block->getPos(), camera_position,
 					camera_direction, camera_fov, range, &d))
 				continue;
 
-
 			/*
 				Ignore if mesh doesn't exist
 			*/
@@ -205,28 +201,62 @@ void ClientMap::updateDrawList()
 			/*
 				Occlusion culling
 			*/
-			if ((!m_control.range_all && d > m_control.wanted_range * BS) ||
-					(occlusion_culling_enabled && isBlockOccluded(block, cam_pos_nodes))) {
+			if (!m_control.range_all && d > m_control.wanted_range * BS) {
 				blocks_occlusion_culled++;
 				continue;
 			}
 
+			if (occlusion_culling_enabled) {
+				if (block->occlusion_stamp != m_occlusion_stamp) {
+					block->occluded = isBlockOccluded(block, cam_pos_nodes);
+					block->occlusion_stamp = m_occlusion_stamp;
+					blocks_occlusion_checked++;
+				}
+				if (block->occluded) {
+					blocks_occlusion_culled++;
+					continue;
+				}
+			}
+
 			// This block is in range. Reset usage timer.
 			block->resetUsageTimer();
 
 			// Add to set
 			block->refGrab();
-			m_drawlist[block->getPos()] = block;
+			m_drawlist.push_back(block);
 
 			sector_blocks_drawn++;
 		} // foreach sectorblocks
 
 		if (sector_blocks_drawn != 0)
-			m_last_drawn_sectors.insert(sp);
+			m_last_drawn_sectors.insert(sector->getPos());
+	};
+
+	s32 range_area = (s32)(p_blocks_max.X - p_blocks_min.X + 1) *
+		(p_blocks_max.Z - p_blocks_min.Z + 1);
+	if (m_control.range_all || (size_t)range_area >= m_sectors.size()) {
+		for (const auto &sector_it : m_sectors) {
+			v2s16 sp = sector_it.first;
+			if (!m_control.range_all &&
+					(sp.X < p_blocks_min.X || sp.X > p_blocks_max.X ||
+					sp.Y < p_blocks_min.Z || sp.Y > p_blocks_max.Z))
+				continue;
+
+			add_sector(sector_it.second);
+		}
+	} else {
+		// Sectors are ordered by X first, only visit the rows in range
+		for (s16 x = p_blocks_min.X; x <= p_blocks_max.X; x++) {
+			auto it = m_sectors.lower_bound(v2s16(x, p_blocks_min.Z));
+			for (; it != m_sectors.end() && it->first.X == x &&
+					it->first.Y <= p_blocks_max.Z; ++it)
+				add_sector(it->second);
+		}
 	}
 
 	g_profiler->avg("MapBlock meshes in range [#]", blocks_in_range_with_mesh);
 	g_profiler->avg("MapBlocks occlusion culled [#]", blocks_occlusion_culled);
+	g_profiler->avg("MapBlocks occlusion checked [#]", blocks_occlusion_checked);
 	g_profiler->avg("MapBlocks drawn [#]", m_drawlist.size());
 }
 
@@ -317,9 +347,7 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 
 	MeshBufListList drawbufs;
 
-	for (auto &i : m_drawlist) {
-		MapBlock *block = i.second;
-
+	for (MapBlock *block : m_drawlist) {
 		// If the mesh of the block happened to get deleted, ignore it
 		if (!block->mesh)
 			continue;
@@ -588,7 +616,7 @@ void ClientMap::renderPostFx(CameraMode cam_mode)
 	// - Do not if player is in third person mode
 	const ContentFeatures& features = m_nodedef->get(n);
 	video::SColor post_effect_color = features.post_effect_color;
-	if(features.solidness == 2 && !(g_settings->getBool("noclip") &&
+	if(features.solidness == 2 && !(m_noclip &&
 			m_client->checkLocalPrivilege("noclip")) &&
 			cam_mode == CAMERA_MODE_FIRST)
 	{
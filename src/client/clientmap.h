@@ -101,6 +101,9 @@ class ClientMap : public Map, public scene::ISceneNode
 	void getBlocksInViewRange(v3s16 cam_pos_nodes,
 		v3s16 *p_blocks_min, v3s16 *p_blocks_max);
 	void updateDrawList();
+	// Drops cached occlusion culling results, must be called when nodes
+	// of the map changed
+	void invalidateOcclusionCache() { m_occlusion_stamp++; }
 	void renderMap(video::IVideoDriver* driver, s32 pass);
 
 	int getBackgroundBrightness(float max_d, u32 daylight_factor,
@@ -126,11 +129,20 @@ class ClientMap : public Map, public scene::ISceneNode
 	f32 m_camera_fov = M_PI;
 	v3s16 m_camera_offset;
 
-	std::map<v3s16, MapBlock*> m_drawlist;
+	std::vector<MapBlock *> m_drawlist;
+
+	// Occlusion only depends on the camera node and the map, cached results
+	// stay valid until either changes
+	u32 m_occlusion_stamp = 1;
+	v3s16 m_occlusion_cam_pos;
 
 	std::set<v2s16> m_last_drawn_sectors;
 
 	bool m_cache_trilinear_filter;
 	bool m_cache_bilinear_filter;
 	bool m_cache_anistropic_filter;
+
+	// Settings read every frame
+	SettingHandle<bool> m_free_move{"free_move"};
+	SettingHandle<bool> m_noclip{"noclip"};
 };
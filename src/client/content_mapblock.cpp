@@ -64,7 +64,7 @@ MapblockMeshGenerator::MapblockMeshGenerator(MeshMakeData *input, MeshCollector
 	data      = input;
 	collector = output;
 
-	nodedef   = data->m_client->ndef();
+	nodedef   = data->m_ndef;
 	meshmanip = RenderingEngine::get_scene_manager()->getMeshManipulator();
 
 	enable_mesh_cache = g_settings->getBool("enable_mesh_cache") &&
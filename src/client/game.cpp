@@ -904,6 +904,10 @@ class Game {
 
 	bool m_does_lost_focus_pause_game = false;
 
+	// Settings read every frame
+	SettingHandle<float> m_fps_max{"fps_max"};
+	SettingHandle<float> m_pause_fps_max{"pause_fps_max"};
+
 #ifdef __ANDROID__
 	bool m_cache_hold_aux1;
 	bool m_android_chat_open;
@@ -3904,8 +3908,7 @@ inline void Game::limitFps(FpsControl *fps_timings, f32 *dtime)
 		fps_timings->busy_time = 0;
 
 	u32 frametime_min = 1000 / (g_menumgr.pausesGame()
-			? g_settings->getFloat("pause_fps_max")
-			: g_settings->getFloat("fps_max"));
+			? m_pause_fps_max.get() : m_fps_max.get());
 
 	if (fps_timings->busy_time < frametime_min) {
 		fps_timings->sleep_time = frametime_min - fps_timings->busy_time;
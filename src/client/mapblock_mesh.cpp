@@ -37,7 +37,15 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 MeshMakeData::MeshMakeData(Client *client, bool use_shaders,
 		bool use_tangent_vertices):
-	m_client(client),
+	MeshMakeData(client->ndef(), client->getTextureSource(),
+		client->getShaderSource(), use_shaders, use_tangent_vertices)
+{}
+
+MeshMakeData::MeshMakeData(const NodeDefManager *ndef, ITextureSource *tsrc,
+		IShaderSource *shdrsrc, bool use_shaders, bool use_tangent_vertices):
+	m_ndef(ndef),
+	m_tsrc(tsrc),
+	m_shdrsrc(shdrsrc),
 	m_use_shaders(use_shaders),
 	m_use_tangent_vertices(use_tangent_vertices)
 {}
@@ -119,6 +127,11 @@ void MeshMakeData::setSmoothLighting(bool smooth_lighting)
 	m_smooth_lighting = smooth_lighting;
 }
 
+void MeshMakeData::setGreedyMeshing(bool greedy_meshing)
+{
+	m_greedy_meshing = greedy_meshing;
+}
+
 /*
 	Light and vertex color functions
 */
@@ -190,7 +203,7 @@ u16 getFaceLight(MapNode n, MapNode n2, const v3s16 &face_dir,
 static u16 getSmoothLightCombined(const v3s16 &p,
 	const std::array<v3s16,8> &dirs, MeshMakeData *data)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_ndef;
 
 	u16 ambient_occlusion = 0;
 	u16 light_count = 0;
@@ -604,10 +617,19 @@ static void makeFastFace(const TileSpec &tile, u16 li0, u16 li1, u16 li2, u16 li
 		vpos += pos;
 	}
 
-	f32 abs_scale = 1.0f;
-	if      (scale.X < 0.999f || scale.X > 1.001f) abs_scale = scale.X;
-	else if (scale.Y < 0.999f || scale.Y > 1.001f) abs_scale = scale.Y;
-	else if (scale.Z < 0.999f || scale.Z > 1.001f) abs_scale = scale.Z;
+	// Texture repeat counts along the U and V axes of the face.
+	// Rows are always merged along U, greedy meshing also merges along V.
+	f32 scale_u, scale_v;
+	if (dir.X != 0) {
+		scale_u = scale.Z;
+		scale_v = scale.Y;
+	} else if (dir.Y != 0) {
+		scale_u = scale.X;
+		scale_v = scale.Z;
+	} else {
+		scale_u = scale.X;
+		scale_v = scale.Y;
+	}
 
 	v3f normal(dir.X, dir.Y, dir.Z);
 
@@ -624,10 +646,10 @@ static void makeFastFace(const TileSpec &tile, u16 li0, u16 li1, u16 li2, u16 li
 			< abs(day[1] - day[3]) + abs(night[1] - night[3]);
 
 	v2f32 f[4] = {
-		core::vector2d<f32>(x0 + w * abs_scale, y0 + h),
-		core::vector2d<f32>(x0, y0 + h),
+		core::vector2d<f32>(x0 + w * scale_u, y0 + h * scale_v),
+		core::vector2d<f32>(x0, y0 + h * scale_v),
 		core::vector2d<f32>(x0, y0),
-		core::vector2d<f32>(x0 + w * abs_scale, y0) };
+		core::vector2d<f32>(x0 + w * scale_u, y0) };
 
 	// equivalent to dest.push_back(FastFace()) but faster
 	dest.emplace_back();
@@ -706,7 +728,7 @@ static u8 face_contents(content_t m1, content_t m2, bool *equivalent,
 */
 void getNodeTileN(MapNode mn, const v3s16 &p, u8 tileindex, MeshMakeData *data, TileSpec &tile)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_ndef;
 	const ContentFeatures &f = ndef->get(mn);
 	tile = f.tiles[tileindex];
 	bool has_crack = p == data->m_crack_pos_relative;
@@ -726,7 +748,7 @@ void getNodeTileN(MapNode mn, const v3s16 &p, u8 tileindex, MeshMakeData *data,
 */
 void getNodeTile(MapNode mn, const v3s16 &p, const v3s16 &dir, MeshMakeData *data, TileSpec &tile)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_ndef;
 
 	// Direction must be (1,0,0), (-1,0,0), (0,1,0), (0,-1,0),
 	// (0,0,1), (0,0,-1) or (0,0,0)
@@ -799,7 +821,7 @@ static void getTileInfo(
 	)
 {
 	VoxelManipulator &vmanip = data->m_vmanip;
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_ndef;
 	v3s16 blockpos_nodes = data->m_blockpos * MAP_BLOCKSIZE;
 
 	const MapNode &n0 = vmanip.getNodeRefUnsafe(blockpos_nodes + p);
@@ -998,6 +1020,132 @@ static void updateAllFastFaceRows(MeshMakeData *data,
 				dest);
 }
 
+/*
+	Greedy meshing
+
+	Faces of one slice of the block are gathered into a 2D grid first, then
+	merged into rectangles of identical tile and lighting. The texture is
+	repeated over the resulting quad, so only tileable tiles are merged.
+*/
+
+struct FastFaceInfo
+{
+	bool makes_face = false;
+	bool used = false;
+	v3s16 p_corrected;
+	v3s16 face_dir_corrected;
+	u16 lights[4] = {0, 0, 0, 0};
+	TileSpec tile;
+};
+
+static inline bool canMergeFastFace(const FastFaceInfo &a, const FastFaceInfo &b,
+		const v3s16 &offset)
+{
+	return b.makes_face && !b.used
+			&& b.face_dir_corrected == a.face_dir_corrected
+			&& b.p_corrected == a.p_corrected + offset
+			&& memcmp(b.lights, a.lights, ARRLEN(a.lights) * sizeof(u16)) == 0
+			&& b.tile.isTileable(a.tile);
+}
+
+/*
+	slice_start: position of the first node of the slice
+	u_dir, v_dir: unit vectors spanning the slice, u_dir is the row direction
+	face_dir: unit vector with only one of x, y or z
+*/
+static void updateFastFaceSlice(
+		MeshMakeData *data,
+		const v3s16 &slice_start,
+		const v3s16 &u_dir,
+		const v3s16 &v_dir,
+		const v3s16 &face_dir,
+		std::vector<FastFaceInfo> &grid,
+		std::vector<FastFace> &dest)
+{
+	for (u16 v = 0; v < MAP_BLOCKSIZE; v++)
+	for (u16 u = 0; u < MAP_BLOCKSIZE; u++) {
+		FastFaceInfo &info = grid[v * MAP_BLOCKSIZE + u];
+		info.used = false;
+		getTileInfo(data, slice_start + u_dir * u + v_dir * v, face_dir,
+				info.makes_face, info.p_corrected, info.face_dir_corrected,
+				info.lights, info.tile);
+	}
+
+	for (u16 v = 0; v < MAP_BLOCKSIZE; v++)
+	for (u16 u = 0; u < MAP_BLOCKSIZE; u++) {
+		FastFaceInfo &info = grid[v * MAP_BLOCKSIZE + u];
+		if (!info.makes_face || info.used)
+			continue;
+
+		// Extend along the row
+		u16 width = 1;
+		while (u + width < MAP_BLOCKSIZE && canMergeFastFace(info,
+				grid[v * MAP_BLOCKSIZE + u + width], u_dir * width))
+			width++;
+
+		// Extend over the following rows while all of them match.
+		// World-aligned textures depend on the row layout, keep them in rows.
+		u16 height = 1;
+		if (!info.tile.world_aligned) {
+			while (v + height < MAP_BLOCKSIZE) {
+				bool row_matches = true;
+				for (u16 du = 0; du < width && row_matches; du++)
+					row_matches = canMergeFastFace(info,
+							grid[(v + height) * MAP_BLOCKSIZE + u + du],
+							u_dir * du + v_dir * height);
+				if (!row_matches)
+					break;
+				height++;
+			}
+		}
+
+		for (u16 dv = 0; dv < height; dv++)
+		for (u16 du = 0; du < width; du++)
+			grid[(v + dv) * MAP_BLOCKSIZE + u + du].used = true;
+
+		// Position of the last merged face, same as updateFastFaceRow uses
+		v3s16 p_last = info.p_corrected + u_dir * (width - 1)
+				+ v_dir * (height - 1);
+		v3f pf(p_last.X, p_last.Y, p_last.Z);
+		v3f u_dir_f(u_dir.X, u_dir.Y, u_dir.Z);
+		v3f v_dir_f(v_dir.X, v_dir.Y, v_dir.Z);
+		// Center point of face
+		v3f sp = pf - ((f32)width * 0.5f - 0.5f) * u_dir_f
+				- ((f32)height * 0.5f - 0.5f) * v_dir_f;
+		v3f scale(1, 1, 1);
+		scale += u_dir_f * (width - 1) + v_dir_f * (height - 1);
+
+		makeFastFace(info.tile, info.lights[0], info.lights[1],
+				info.lights[2], info.lights[3],
+				pf, sp, info.face_dir_corrected, scale, dest);
+		g_profiler->avg("Meshgen: Tiles per face [#]", width * height);
+	}
+}
+
+static void updateAllFastFacesGreedy(MeshMakeData *data,
+		std::vector<FastFace> &dest)
+{
+	std::vector<FastFaceInfo> grid(MAP_BLOCKSIZE * MAP_BLOCKSIZE);
+
+	// Top(y+) faces, rows of x+ stacked along z+
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		updateFastFaceSlice(data, v3s16(0, y, 0),
+				v3s16(1, 0, 0), v3s16(0, 0, 1), v3s16(0, 1, 0),
+				grid, dest);
+
+	// Right(x+) faces, rows of z+ stacked along y+
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+		updateFastFaceSlice(data, v3s16(x, 0, 0),
+				v3s16(0, 0, 1), v3s16(0, 1, 0), v3s16(1, 0, 0),
+				grid, dest);
+
+	// Back(z+) faces, rows of x+ stacked along y+
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		updateFastFaceSlice(data, v3s16(0, 0, z),
+				v3s16(1, 0, 0), v3s16(0, 1, 0), v3s16(0, 0, 1),
+				grid, dest);
+}
+
 static void applyTileColor(PreMeshBuffer &pmb)
 {
 	video::SColor tc = pmb.layer.color;
@@ -1018,8 +1166,8 @@ static void applyTileColor(PreMeshBuffer &pmb)
 
 MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 	m_minimap_mapblock(NULL),
-	m_tsrc(data->m_client->getTextureSource()),
-	m_shdrsrc(data->m_client->getShaderSource()),
+	m_tsrc(data->m_tsrc),
+	m_shdrsrc(data->m_shdrsrc),
 	m_animation_force_timer(0), // force initial animation
 	m_last_crack(-1),
 	m_last_daynight_ratio((u32) -1)
@@ -1053,7 +1201,10 @@ MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 	{
 		// 4-23ms for MAP_BLOCKSIZE=16  (NOTE: probably outdated)
 		//TimeTaker timer2("updateAllFastFaceRows()");
-		updateAllFastFaceRows(data, fastfaces_new);
+		if (data->m_greedy_meshing)
+			updateAllFastFacesGreedy(data, fastfaces_new);
+		else
+			updateAllFastFaceRows(data, fastfaces_new);
 	}
 	// End of slow part
 
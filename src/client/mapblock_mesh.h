@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <map>
 
 class Client;
+class NodeDefManager;
 class IShaderSource;
 
 /*
@@ -42,13 +43,20 @@ struct MeshMakeData
 	v3s16 m_blockpos = v3s16(-1337,-1337,-1337);
 	v3s16 m_crack_pos_relative = v3s16(-1337,-1337,-1337);
 	bool m_smooth_lighting = false;
+	bool m_greedy_meshing = false;
 
-	Client *m_client;
+	const NodeDefManager *m_ndef;
+	ITextureSource *m_tsrc;
+	IShaderSource *m_shdrsrc;
 	bool m_use_shaders;
 	bool m_use_tangent_vertices;
 
 	MeshMakeData(Client *client, bool use_shaders,
 			bool use_tangent_vertices = false);
+	// Allows building meshes without a Client, e.g. for benchmarks
+	MeshMakeData(const NodeDefManager *ndef, ITextureSource *tsrc,
+			IShaderSource *shdrsrc, bool use_shaders,
+			bool use_tangent_vertices = false);
 
 	/*
 		Copy block data manually (to allow optimizations by the caller)
@@ -76,6 +84,11 @@ struct MeshMakeData
 		Enable or disable smooth lighting
 	*/
 	void setSmoothLighting(bool smooth_lighting);
+
+	/*
+		Enable or disable merging of coplanar faces into larger quads
+	*/
+	void setGreedyMeshing(bool greedy_meshing);
 };
 
 /*
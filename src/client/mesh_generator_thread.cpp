@@ -56,6 +56,7 @@ MeshUpdateQueue::MeshUpdateQueue(Client *client):
 		g_settings->getBool("enable_bumpmapping") ||
 		g_settings->getBool("enable_parallax_occlusion"));
 	m_cache_smooth_lighting = g_settings->getBool("smooth_lighting");
+	m_cache_greedy_meshing = g_settings->getBool("greedy_meshing");
 	m_meshgen_block_cache_size = g_settings->getS32("meshgen_block_cache_size");
 }
 
@@ -232,6 +233,7 @@ void MeshUpdateQueue::fillDataFromMapBlockCache(QueuedMeshUpdate *q)
 
 	data->setCrack(q->crack_level, q->crack_pos);
 	data->setSmoothLighting(m_cache_smooth_lighting);
+	data->setGreedyMeshing(m_cache_greedy_meshing);
 }
 
 void MeshUpdateQueue::cleanupCache()
@@ -90,6 +90,7 @@ class MeshUpdateQueue
 	bool m_cache_enable_shaders;
 	bool m_cache_use_tangent_vertices;
 	bool m_cache_smooth_lighting;
+	bool m_cache_greedy_meshing;
 	int m_meshgen_block_cache_size;
 
 	CachedMapBlockData *cacheBlock(Map *map, v3s16 p, UpdateMode mode,
@@ -29,6 +29,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "scripting_server.h"
 #include "genericobject.h"
 #include "settings.h"
+#include "itemgroup.h"
+#include "map.h"
+#include "mapblock.h"
 #include <algorithm>
 #include <cmath>
 
@@ -337,6 +340,15 @@ void LuaEntitySAO::addedToEnvironment(u32 dtime_s)
 		// Activate entity, supplying serialized state
 		m_env->getScriptIface()->
 			luaentity_Activate(m_id, m_init_state, dtime_s);
+
+		// Step builtin items natively, unless a mod overrides on_step
+		if (m_init_name == "__builtin:item" &&
+				m_env->getScriptIface()->luaentity_IsNativeItem(m_id)) {
+			m_native_item = true;
+			m_item.age = m_env->getScriptIface()->luaentity_GetItemAge(m_id);
+			m_item.gravity = g_settings->getFloat("movement_gravity");
+			m_item.time_to_live = g_settings->getFloat("item_entity_ttl");
+		}
 	} else {
 		m_prop.infotext = m_init_name;
 	}
@@ -417,6 +429,11 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 
 	m_last_sent_position_timer += dtime;
 
+	// Nodes around the entity changed, it may have to fall again
+	if (m_sleeping && m_env->isBlockChanged(
+			getNodeBlockPos(floatToInt(m_base_position, BS))))
+		wakeUp();
+
 	// Each frame, parent position is copied if the object is attached, otherwise it's calculated normally
 	// If the object gets detached this comes into effect automatically from the last known origin
 	if(isAttached())
@@ -426,6 +443,10 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 		m_velocity = v3f(0,0,0);
 		m_acceleration = v3f(0,0,0);
 	}
+	else if (m_sleeping || (m_native_item && isNativeItemResting()))
+	{
+		// Resting entities neither move nor turn, skip the collision checks
+	}
 	else
 	{
 		if(m_prop.physical){
@@ -443,9 +464,12 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 					this, m_prop.collideWithObjects);
 
 			// Apply results
+			v3f old_pos = m_base_position;
 			m_base_position = p_pos;
 			m_velocity = p_velocity;
 			m_acceleration = p_acceleration;
+
+			updateSleepState(moveresult, old_pos);
 		} else {
 			m_base_position += dtime * m_velocity + 0.5 * dtime
 					* dtime * m_acceleration;
@@ -470,14 +494,18 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 		}
 	}
 
-	if(m_registered){
+	if (m_native_item) {
+		if (!isGone())
+			stepNativeItem(dtime);
+	} else if (m_registered) {
 		m_env->getScriptIface()->luaentity_Step(m_id, dtime);
 	}
 
 	if (!send_recommended)
 		return;
 
-	if(!isAttached())
+	// The final position was sent when the entity fell asleep
+	if(!isAttached() && !m_sleeping)
 	{
 		// TODO: force send when acceleration changes enough?
 		float minchange = 0.2*BS;
@@ -602,6 +630,7 @@ void LuaEntitySAO::getStaticData(std::string *result) const
 	os<<serializeString(m_init_name);
 	// state
 	if(m_registered){
+		syncNativeItemAge();
 		std::string state = m_env->getScriptIface()->
 			luaentity_GetStaticdata(m_id);
 		os<<serializeLongString(state);
@@ -637,6 +666,7 @@ u16 LuaEntitySAO::punch(v3f dir,
 
 	FATAL_ERROR_IF(!puncher, "Punch action called without SAO");
 
+	wakeUp();
 	s32 old_hp = getHP();
 	ItemStack selected_item, hand_item;
 	ItemStack tool_item = puncher->getWieldedItem(&selected_item, &hand_item);
@@ -647,6 +677,7 @@ u16 LuaEntitySAO::punch(v3f dir,
 			&tool_item,
 			time_from_last_punch);
 
+	syncNativeItemAge();
 	bool damage_handled = m_env->getScriptIface()->luaentity_Punch(m_id, puncher,
 			time_from_last_punch, toolcap, dir, result.did_punch ? result.damage : 0);
 
@@ -683,14 +714,243 @@ void LuaEntitySAO::rightClick(ServerActiveObject *clicker)
 	if (!m_registered)
 		return;
 
+	syncNativeItemAge();
 	m_env->getScriptIface()->luaentity_Rightclick(m_id, clicker);
 }
 
+void LuaEntitySAO::mergeNearbyItems(const std::vector<LuaEntitySAO *> &items)
+{
+	// try_merge_with() tells items apart by their age
+	syncNativeItemAge();
+	std::vector<ServerActiveObject *> objects;
+	objects.reserve(items.size());
+	for (LuaEntitySAO *item : items) {
+		item->syncNativeItemAge();
+		objects.push_back(item);
+	}
+
+	m_env->getScriptIface()->luaentity_MergeItems(m_id, objects);
+
+	// Merging into this item resets its age
+	if (m_native_item)
+		m_item.age = m_env->getScriptIface()->luaentity_GetItemAge(m_id);
+}
+
+/*
+	Native item entity
+*/
+
+// Interval at which resting items check whether they need to fall again
+static const float ITEM_REST_CHECK_INTERVAL = 0.2f;
+
+bool LuaEntitySAO::isNativeItemResting() const
+{
+	return !m_item.moving && m_item.physical &&
+		m_velocity == v3f() && m_acceleration == v3f();
+}
+
+void LuaEntitySAO::syncNativeItemAge() const
+{
+	if (m_native_item)
+		m_env->getScriptIface()->luaentity_SetItemAge(m_id, m_item.age);
+}
+
+void LuaEntitySAO::setNativeItemPhysics(bool enable)
+{
+	if (m_item.physical == enable)
+		return;
+
+	m_item.physical = enable;
+	m_prop.physical = enable;
+	notifyObjectPropertiesModified();
+	m_velocity = v3f();
+	m_acceleration = enable ? v3f(0, -m_item.gravity * BS, 0) : v3f();
+}
+
+void LuaEntitySAO::stepNativeItem(float dtime)
+{
+	m_item.age += dtime;
+	if (m_item.time_to_live > 0 && m_item.age > m_item.time_to_live) {
+		m_pending_removal = true;
+		return;
+	}
+
+	if (isNativeItemResting()) {
+		m_item.sleep_timer += dtime;
+		if (m_item.sleep_timer < ITEM_REST_CHECK_INTERVAL)
+			return;
+	}
+	m_item.sleep_timer = 0.0f;
+
+	Map *map = &m_env->getMap();
+	const NodeDefManager *ndef = m_env->getGameDef()->ndef();
+	const aabb3f &c = m_prop.collisionbox;
+	v3f pos = m_base_position / BS;
+
+	bool below_valid;
+	MapNode below = map->getNode(floatToInt(
+		v3f(pos.X, pos.Y + c.MinEdge.Y - 0.05f, pos.Z), 1.0f), &below_valid);
+	// Delete in 'ignore' nodes
+	if (below_valid && below.getContent() == CONTENT_IGNORE) {
+		m_pending_removal = true;
+		return;
+	}
+
+	bool is_stuck = false;
+	bool node_valid;
+	v3s16 node_pos = floatToInt(pos, 1.0f);
+	MapNode n = map->getNode(node_pos, &node_valid);
+	if (node_valid) {
+		const ContentFeatures &f = ndef->get(n);
+		is_stuck = f.walkable &&
+			f.collision_box.type == NODEBOX_REGULAR &&
+			f.node_box.type == NODEBOX_REGULAR;
+	}
+
+	// Push item out when stuck inside solid node
+	if (is_stuck) {
+		static const v3s16 order[] = {
+			v3s16(1, 0, 0), v3s16(-1, 0, 0),
+			v3s16(0, 0, 1), v3s16(0, 0, -1),
+		};
+
+		// Check which one of the 4 sides is free
+		v3s16 shootdir;
+		bool found = false;
+		for (const v3s16 &dir : order) {
+			MapNode cn = map->getNode(node_pos + dir);
+			if (cn.getContent() != CONTENT_IGNORE && !ndef->get(cn).walkable) {
+				shootdir = dir;
+				found = true;
+				break;
+			}
+		}
+		// If none of the 4 sides is free, check upwards
+		if (!found && map->getNode(node_pos + v3s16(0, 1, 0)).getContent() !=
+				CONTENT_IGNORE) {
+			shootdir = v3s16(0, 1, 0);
+			found = true;
+		}
+
+		if (found) {
+			// Set new item moving speed accordingly
+			v3f newv = intToFloat(shootdir, 1.0f) * 3.0f;
+			setNativeItemPhysics(false);
+			m_velocity = newv * BS;
+
+			m_item.force_out = newv;
+			m_item.force_out_start = node_pos;
+			return;
+		}
+	} else if (m_item.force_out != v3f()) {
+		// Make sure the entity is entirely outside the solid node
+		const v3f s = intToFloat(m_item.force_out_start, 1.0f);
+		const v3f &f = m_item.force_out;
+		bool ok = (f.X > 0 && pos.X + c.MinEdge.X > s.X + 0.5f) ||
+			(f.Y > 0 && pos.Y + c.MinEdge.Y > s.Y + 0.5f) ||
+			(f.Z > 0 && pos.Z + c.MinEdge.Z > s.Z + 0.5f) ||
+			(f.X < 0 && pos.X + c.MaxEdge.X < s.X - 0.5f) ||
+			(f.Z < 0 && pos.Z + c.MaxEdge.Z < s.Z - 0.5f);
+		if (ok) {
+			// Item was successfully forced out
+			m_item.force_out = v3f();
+			setNativeItemPhysics(true);
+		}
+	}
+
+	if (!m_item.physical)
+		return;
+
+	// Slide on slippery nodes
+	v3f vel = m_velocity / BS;
+	const ContentFeatures *def = below_valid ? &ndef->get(below) : nullptr;
+	bool is_moving = (def && !def->walkable) || vel != v3f();
+	bool is_slippery = false;
+
+	if (def && def->walkable) {
+		int slippery = itemgroup_get(def->groups, "slippery");
+		is_slippery = slippery != 0;
+		if (is_slippery && (std::fabs(vel.X) > 0.2f || std::fabs(vel.Z) > 0.2f)) {
+			// Horizontal deceleration
+			float slip_factor = 4.0f / (slippery + 4);
+			m_acceleration = v3f(-vel.X * slip_factor, 0, -vel.Z * slip_factor) * BS;
+		} else if (vel.Y == 0) {
+			is_moving = false;
+		}
+	}
+
+	// Do not update anything until the moving state changes
+	if (m_item.moving == is_moving && m_item.slippery == is_slippery)
+		return;
+
+	m_item.moving = is_moving;
+	m_item.slippery = is_slippery;
+
+	if (is_moving) {
+		m_acceleration = v3f(0, -m_item.gravity * BS, 0);
+		wakeUp();
+		return;
+	}
+
+	m_acceleration = v3f();
+	m_velocity = v3f();
+
+	// Only collect items if not moving, done for all items at once
+	// after the objects have been stepped
+	m_env->queueItemMerge(m_id);
+}
+
+// Number of steps an entity has to rest on the ground before it sleeps
+static const u8 LUAENTITY_SLEEP_STEPS = 3;
+
+void LuaEntitySAO::updateSleepState(const collisionMoveResult &moveresult,
+		const v3f &old_pos)
+{
+	// Objects below may move away, only sleep on nodes
+	bool resting = moveresult.touching_ground &&
+		!moveresult.standing_on_object &&
+		m_velocity == v3f() &&
+		m_acceleration.X == 0.0f && m_acceleration.Z == 0.0f &&
+		m_base_position.getDistanceFromSQ(old_pos) < 0.0001f * BS * BS;
+
+	if (!resting) {
+		m_rest_steps = 0;
+		return;
+	}
+
+	if (++m_rest_steps < LUAENTITY_SLEEP_STEPS)
+		return;
+
+	m_sleeping = true;
+	sendPosition(false, true);
+}
+
+void LuaEntitySAO::setAttachment(int parent_id, const std::string &bone,
+		v3f position, v3f rotation)
+{
+	UnitSAO::setAttachment(parent_id, bone, position, rotation);
+	wakeUp();
+}
+
+void LuaEntitySAO::setRotation(v3f rotation)
+{
+	UnitSAO::setRotation(rotation);
+	wakeUp();
+}
+
+void LuaEntitySAO::notifyObjectPropertiesModified()
+{
+	// The collision box or physical flag may have changed
+	UnitSAO::notifyObjectPropertiesModified();
+	wakeUp();
+}
+
 void LuaEntitySAO::setPos(const v3f &pos)
 {
 	if(isAttached())
 		return;
 	m_base_position = pos;
+	wakeUp();
 	sendPosition(false, true);
 }
 
@@ -699,6 +959,7 @@ void LuaEntitySAO::moveTo(v3f pos, bool continuous)
 	if(isAttached())
 		return;
 	m_base_position = pos;
+	wakeUp();
 	if(!continuous)
 		sendPosition(true, true);
 }
@@ -731,6 +992,9 @@ u16 LuaEntitySAO::getHP() const
 
 void LuaEntitySAO::setVelocity(v3f velocity)
 {
+	// Mods often set the same velocity every step
+	if (velocity != m_velocity)
+		wakeUp();
 	m_velocity = velocity;
 }
 
@@ -741,6 +1005,8 @@ v3f LuaEntitySAO::getVelocity()
 
 void LuaEntitySAO::setAcceleration(v3f acceleration)
 {
+	if (acceleration != m_acceleration)
+		wakeUp();
 	m_acceleration = acceleration;
 }
 
@@ -26,6 +26,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "object_properties.h"
 #include "constants.h"
 
+struct collisionMoveResult;
+
 class UnitSAO: public ServerActiveObject
 {
 public:
@@ -133,12 +135,16 @@ class LuaEntitySAO : public UnitSAO
 	std::string getDescription();
 	void setHP(s32 hp, const PlayerHPChangeReason &reason);
 	u16 getHP() const;
+	void setAttachment(int parent_id, const std::string &bone, v3f position, v3f rotation);
+	void notifyObjectPropertiesModified();
+	void setRotation(v3f rotation);
 
 	/* LuaEntitySAO-specific */
 	void setVelocity(v3f velocity);
 	void addVelocity(v3f velocity)
 	{
 		m_velocity += velocity;
+		wakeUp();
 	}
 	v3f getVelocity();
 	void setAcceleration(v3f acceleration);
@@ -152,9 +158,33 @@ class LuaEntitySAO : public UnitSAO
 	bool getCollisionBox(aabb3f *toset) const;
 	bool getSelectionBox(aabb3f *toset) const;
 	bool collideWithObjects() const;
+
+	// Whether this is a __builtin:item stepped by the engine
+	bool isNativeItem() const { return m_native_item; }
+	// Lets the item merge the stacks of nearby items into its own
+	void mergeNearbyItems(const std::vector<LuaEntitySAO *> &items);
+
+	// Whether the physics of the entity are suspended
+	bool isSleeping() const { return m_sleeping; }
+	void wakeUp()
+	{
+		m_sleeping = false;
+		m_rest_steps = 0;
+	}
 private:
 	std::string getPropertyPacket();
 	void sendPosition(bool do_interpolate, bool is_movement_end);
+	// Puts the entity to sleep once it rested on the ground for a while
+	void updateSleepState(const collisionMoveResult &moveresult,
+			const v3f &old_pos);
+
+	// Native version of the on_step of builtin/game/item_entity.lua
+	void stepNativeItem(float dtime);
+	void setNativeItemPhysics(bool enable);
+	// Whether the item lies still and only needs occasional checks
+	bool isNativeItemResting() const;
+	// Writes the age to the Lua entity before Lua code of it is called
+	void syncNativeItemAge() const;
 
 	std::string m_init_name;
 	std::string m_init_state;
@@ -169,6 +199,28 @@ class LuaEntitySAO : public UnitSAO
 	float m_last_sent_position_timer = 0.0f;
 	float m_last_sent_move_precision = 0.0f;
 	std::string m_current_texture_modifier = "";
+
+	// Sleeping entities skip the collision checks and position updates
+	// until they are moved by the API or the nodes around them change
+	bool m_sleeping = false;
+	u8 m_rest_steps = 0;
+
+	// State of the native item entity, mirrors the fields of the Lua entity
+	struct NativeItemState {
+		float age = 0.0f;
+		bool moving = true;
+		bool slippery = false;
+		bool physical = true;
+		// Push out of a solid node, in nodes per second
+		v3f force_out;
+		v3s16 force_out_start;
+		// Time since the last check while resting
+		float sleep_timer = 0.0f;
+		float gravity = 9.81f;
+		float time_to_live = 900.0f;
+	};
+	bool m_native_item = false;
+	NativeItemState m_item;
 };
 
 /*
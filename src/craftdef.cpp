@@ -31,6 +31,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/numeric.h"
 #include "util/strfnd.h"
 #include "exceptions.h"
+#include "threading/mutex_auto_lock.h"
 
 inline bool isGroupRecipeStr(const std::string &rec_name)
 {
@@ -462,6 +463,11 @@ void CraftDefinitionShaped::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+std::vector<std::string> CraftDefinitionShaped::getRequiredItems() const
+{
+	return recipe_names;
+}
+
 std::string CraftDefinitionShaped::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -581,6 +587,11 @@ void CraftDefinitionShapeless::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+std::vector<std::string> CraftDefinitionShapeless::getRequiredItems() const
+{
+	return recipe_names;
+}
+
 std::string CraftDefinitionShapeless::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -783,6 +794,11 @@ void CraftDefinitionCooking::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+std::vector<std::string> CraftDefinitionCooking::getRequiredItems() const
+{
+	return {recipe_name};
+}
+
 std::string CraftDefinitionCooking::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -885,6 +901,11 @@ void CraftDefinitionFuel::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+std::vector<std::string> CraftDefinitionFuel::getRequiredItems() const
+{
+	return {recipe_name};
+}
+
 std::string CraftDefinitionFuel::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -918,6 +939,20 @@ class CCraftDefManager: public IWritableCraftDefManager
 		if (input.empty())
 			return false;
 
+		// Previews are requested on every change of a craft grid, answer
+		// repeated lookups of the same grid from the cache
+		std::string cache_key;
+		if (!decrementInput) {
+			cache_key = getResultCacheKey(input);
+			MutexAutoLock lock(m_result_cache_mutex);
+			auto it = m_result_cache.find(cache_key);
+			if (it != m_result_cache.end()) {
+				if (it->second.found)
+					output = it->second.output;
+				return it->second.found;
+			}
+		}
+
 		std::vector<std::string> input_names;
 		input_names = craftGetItemNames(input.items, gamedef);
 		std::sort(input_names.begin(), input_names.end());
@@ -940,11 +975,19 @@ class CCraftDefManager: public IWritableCraftDefManager
 				continue;
 
 			const std::vector<CraftDefinition*> &hash_collisions = col_iter->second;
+
+			// Recipes with groups share one bucket per item count, only
+			// check those that have all of their ingredients present
+			std::vector<u32> candidates;
+			bool indexed = type == CRAFT_HASH_TYPE_COUNT &&
+				getGroupRecipeCandidates(hash, input_names, gamedef, candidates);
+			size_t num_defs = indexed ? candidates.size() : hash_collisions.size();
+
 			// Walk crafting definitions from back to front, so that later
 			// definitions can override earlier ones.
-			for (std::vector<CraftDefinition*>::size_type
-					i = hash_collisions.size(); i > 0; i--) {
-				CraftDefinition *def = hash_collisions[i - 1];
+			for (size_t i = num_defs; i > 0; i--) {
+				CraftDefinition *def = indexed ?
+					hash_collisions[candidates[i - 1]] : hash_collisions[i - 1];
 
 				/*errorstream << "Checking " << input.dump() << std::endl
 					<< " against " << def->dump() << std::endl;*/
@@ -968,6 +1011,16 @@ class CCraftDefManager: public IWritableCraftDefManager
 				}
 			}
 		}
+		if (!decrementInput) {
+			MutexAutoLock lock(m_result_cache_mutex);
+			if (m_result_cache.size() >= CRAFT_RESULT_CACHE_SIZE)
+				m_result_cache.clear();
+			CachedResult &cached = m_result_cache[cache_key];
+			cached.found = priority_best != CraftDefinition::PRIORITY_NO_RECIPE;
+			if (cached.found)
+				cached.output = output;
+		}
+
 		if (priority_best == CraftDefinition::PRIORITY_NO_RECIPE)
 			return false;
 		if (decrementInput)
@@ -1002,6 +1055,7 @@ class CCraftDefManager: public IWritableCraftDefManager
 
 	virtual bool clearCraftsByOutput(const CraftOutput &output, IGameDef *gamedef)
 	{
+		clearResultCache();
 		auto to_clear = m_output_craft_definitions.find(output.item);
 
 		if (to_clear == m_output_craft_definitions.end())
@@ -1022,6 +1076,8 @@ class CCraftDefManager: public IWritableCraftDefManager
 		if (input.empty())
 			return false;
 
+		clearResultCache();
+
 		// Recipes are not yet hashed at this point
 		std::vector<CraftDefinition *> &defs = m_craft_defs[(int)CRAFT_HASH_TYPE_UNHASHED][0];
 		std::vector<CraftDefinition *> new_defs;
@@ -1068,6 +1124,7 @@ class CCraftDefManager: public IWritableCraftDefManager
 	{
 		verbosestream << "registerCraft: registering craft definition: "
 				<< def->dump() << std::endl;
+		clearResultCache();
 		m_craft_defs[(int) CRAFT_HASH_TYPE_UNHASHED][0].push_back(def);
 
 		CraftInput input;
@@ -1087,9 +1144,12 @@ class CCraftDefManager: public IWritableCraftDefManager
 			m_craft_defs[type].clear();
 		}
 		m_output_craft_definitions.clear();
+		clearResultCache();
+		clearGroupIndex();
 	}
 	virtual void initHashes(IGameDef *gamedef)
 	{
+		clearResultCache();
 		// Move the CraftDefs from the unhashed layer into layers higher up.
 		std::vector<CraftDefinition *> &unhashed =
 			m_craft_defs[(int) CRAFT_HASH_TYPE_UNHASHED][0];
@@ -1103,12 +1163,177 @@ class CCraftDefManager: public IWritableCraftDefManager
 			m_craft_defs[type][hash].push_back(def);
 		}
 		unhashed.clear();
+
+		buildGroupIndex();
 	}
 private:
+	/*
+		Index of the CRAFT_HASH_TYPE_COUNT layer. Each recipe of a bucket is
+		listed under all of its distinct ingredients; a recipe can only
+		match if every one of them is satisfied by an input item.
+	*/
+	struct GroupRecipeBucket
+	{
+		// Positions in the bucket, by ingredient id
+		std::unordered_map<u32, std::vector<u32> > by_ingredient;
+		// Number of distinct ingredients, by position
+		std::vector<u32> ingredient_count;
+		// Positions of recipes without known ingredients, e.g. tool repair
+		std::vector<u32> unindexed;
+	};
+
+	u32 getIngredientId(const std::string &name)
+	{
+		auto it = m_ingredient_ids.find(name);
+		if (it != m_ingredient_ids.end())
+			return it->second;
+
+		u32 id = m_ingredient_ids.size();
+		m_ingredient_ids[name] = id;
+		if (isGroupRecipeStr(name))
+			m_group_ingredients.emplace_back(id, name);
+		return id;
+	}
+
+	void buildGroupIndex()
+	{
+		clearGroupIndex();
+
+		for (const auto &it : m_craft_defs[(int) CRAFT_HASH_TYPE_COUNT]) {
+			GroupRecipeBucket &bucket = m_group_index[it.first];
+			const std::vector<CraftDefinition *> &defs = it.second;
+			bucket.ingredient_count.resize(defs.size());
+
+			for (u32 i = 0; i < defs.size(); i++) {
+				std::vector<std::string> names = defs[i]->getRequiredItems();
+				names.erase(std::remove(names.begin(), names.end(), ""),
+					names.end());
+				std::sort(names.begin(), names.end());
+				names.erase(std::unique(names.begin(), names.end()), names.end());
+
+				bucket.ingredient_count[i] = names.size();
+				if (names.empty())
+					bucket.unindexed.push_back(i);
+				for (const std::string &name : names)
+					bucket.by_ingredient[getIngredientId(name)].push_back(i);
+			}
+		}
+
+		infostream << "CraftDefManager: Indexed " << m_ingredient_ids.size()
+			<< " ingredients (" << m_group_ingredients.size()
+			<< " groups) of group recipes" << std::endl;
+	}
+
+	void clearGroupIndex()
+	{
+		m_group_index.clear();
+		m_ingredient_ids.clear();
+		m_group_ingredients.clear();
+
+		MutexAutoLock lock(m_item_ingredients_mutex);
+		m_item_ingredients.clear();
+	}
+
+	// Returns the ids of all ingredients an item satisfies
+	std::vector<u32> getItemIngredients(const std::string &name,
+			IItemDefManager *idef) const
+	{
+		MutexAutoLock lock(m_item_ingredients_mutex);
+		auto it = m_item_ingredients.find(name);
+		if (it != m_item_ingredients.end())
+			return it->second;
+
+		std::vector<u32> &ids = m_item_ingredients[name];
+		auto name_it = m_ingredient_ids.find(name);
+		if (name_it != m_ingredient_ids.end())
+			ids.push_back(name_it->second);
+		for (const auto &group : m_group_ingredients) {
+			if (inputItemMatchesRecipe(name, group.second, idef))
+				ids.push_back(group.first);
+		}
+		return ids;
+	}
+
+	// Collects the positions of all recipes in a bucket of the
+	// CRAFT_HASH_TYPE_COUNT layer that may match the sorted input names.
+	// Returns false if the bucket is not indexed.
+	bool getGroupRecipeCandidates(u64 hash,
+			const std::vector<std::string> &input_names, IGameDef *gamedef,
+			std::vector<u32> &candidates) const
+	{
+		auto bucket_it = m_group_index.find(hash);
+		if (bucket_it == m_group_index.end())
+			return false;
+		const GroupRecipeBucket &bucket = bucket_it->second;
+
+		std::vector<u32> satisfied;
+		for (size_t i = 0; i < input_names.size(); i++) {
+			const std::string &name = input_names[i];
+			if (name.empty() || (i > 0 && name == input_names[i - 1]))
+				continue;
+			std::vector<u32> ids = getItemIngredients(name, gamedef->idef());
+			satisfied.insert(satisfied.end(), ids.begin(), ids.end());
+		}
+		std::sort(satisfied.begin(), satisfied.end());
+		satisfied.erase(std::unique(satisfied.begin(), satisfied.end()),
+			satisfied.end());
+
+		std::unordered_map<u32, u32> matched;
+		for (u32 id : satisfied) {
+			auto it = bucket.by_ingredient.find(id);
+			if (it == bucket.by_ingredient.end())
+				continue;
+			for (u32 i : it->second) {
+				if (++matched[i] == bucket.ingredient_count[i])
+					candidates.push_back(i);
+			}
+		}
+		candidates.insert(candidates.end(), bucket.unindexed.begin(),
+			bucket.unindexed.end());
+		std::sort(candidates.begin(), candidates.end());
+		return true;
+	}
+
+	// Maximal number of cached craft results before the cache is reset
+	static const size_t CRAFT_RESULT_CACHE_SIZE = 4096;
+
+	struct CachedResult
+	{
+		bool found = false;
+		CraftOutput output;
+	};
+
+	static std::string getResultCacheKey(const CraftInput &input)
+	{
+		std::ostringstream os(std::ios::binary);
+		os << (int)input.method << ' ' << input.width;
+		for (const ItemStack &item : input.items)
+			os << '\n' << item.getItemString();
+		return os.str();
+	}
+
+	void clearResultCache()
+	{
+		MutexAutoLock lock(m_result_cache_mutex);
+		m_result_cache.clear();
+	}
+
 	std::vector<std::unordered_map<u64, std::vector<CraftDefinition*> > >
 		m_craft_defs;
 	std::unordered_map<std::string, std::vector<CraftDefinition*> >
 		m_output_craft_definitions;
+
+	// Results of lookups without decrementing the input, keyed by the
+	// serialized craft grid
+	mutable std::unordered_map<std::string, CachedResult> m_result_cache;
+	mutable std::mutex m_result_cache_mutex;
+
+	std::unordered_map<u64, GroupRecipeBucket> m_group_index;
+	std::unordered_map<std::string, u32> m_ingredient_ids;
+	std::vector<std::pair<u32, std::string> > m_group_ingredients;
+	// Ingredient ids satisfied by each item, filled on demand
+	mutable std::unordered_map<std::string, std::vector<u32> > m_item_ingredients;
+	mutable std::mutex m_item_ingredients_mutex;
 };
 
 IWritableCraftDefManager* createCraftDefManager()
@@ -182,6 +182,10 @@ class CraftDefinition
 	// to be called after all mods are loaded, so that we catch all aliases
 	virtual void initHash(IGameDef *gamedef) = 0;
 
+	// Item names and groups that must all be present in a matching input,
+	// valid after initHash(). Empty if the recipe can not be indexed.
+	virtual std::vector<std::string> getRequiredItems() const { return {}; }
+
 	virtual std::string dump() const=0;
 
 protected:
@@ -218,6 +222,8 @@ class CraftDefinitionShaped: public CraftDefinition
 
 	virtual void initHash(IGameDef *gamedef);
 
+	virtual std::vector<std::string> getRequiredItems() const;
+
 	virtual std::string dump() const;
 
 private:
@@ -262,6 +268,8 @@ class CraftDefinitionShapeless: public CraftDefinition
 
 	virtual void initHash(IGameDef *gamedef);
 
+	virtual std::vector<std::string> getRequiredItems() const;
+
 	virtual std::string dump() const;
 
 private:
@@ -343,6 +351,8 @@ class CraftDefinitionCooking: public CraftDefinition
 
 	virtual void initHash(IGameDef *gamedef);
 
+	virtual std::vector<std::string> getRequiredItems() const;
+
 	virtual std::string dump() const;
 
 private:
@@ -386,6 +396,8 @@ class CraftDefinitionFuel: public CraftDefinition
 
 	virtual void initHash(IGameDef *gamedef);
 
+	virtual std::vector<std::string> getRequiredItems() const;
+
 	virtual std::string dump() const;
 
 private:
@@ -56,6 +56,7 @@ void sanity_check_fn(const char *assertion, const char *file,
 	errorstream << file << ":" << line << ": " << function
 		<< ": An engine assumption '" << assertion << "' failed." << std::endl;
 
+	g_logger.flush();
 	abort();
 }
 
@@ -71,6 +72,7 @@ void fatal_error_fn(const char *msg, const char *file,
 	errorstream << file << ":" << line << ": " << function
 		<< ": A fatal error occurred: " << msg << std::endl;
 
+	g_logger.flush();
 	abort();
 }
 
@@ -42,6 +42,7 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("enable_mesh_cache", "false");
 	settings->setDefault("mesh_generation_interval", "0");
 	settings->setDefault("meshgen_block_cache_size", "20");
+	settings->setDefault("greedy_meshing", "false");
 	settings->setDefault("enable_vbo", "true");
 	settings->setDefault("free_move", "false");
 	settings->setDefault("pitch_move", "false");
@@ -359,6 +360,7 @@ void set_default_settings(Settings *settings)
 #else
 	settings->setDefault("deprecated_lua_api_handling", "log");
 #endif
+	settings->setDefault("num_async_threads", "0");
 
 	settings->setDefault("kick_msg_shutdown", "Server shutting down.");
 	settings->setDefault("kick_msg_crash", "This server has experienced an internal error. You will now be disconnected.");
@@ -394,10 +396,13 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("remote_media", "");
 	settings->setDefault("debug_log_level", "action");
 	settings->setDefault("debug_log_size_max", "50");
+	settings->setDefault("debug_log_async", "false");
 	settings->setDefault("emergequeue_limit_total", "512");
 	settings->setDefault("emergequeue_limit_diskonly", "64");
 	settings->setDefault("emergequeue_limit_generate", "64");
 	settings->setDefault("num_emerge_threads", "1");
+	settings->setDefault("mapgen_task_threads", "0");
+	settings->setDefault("mapgen_noise_cache_size", "512");
 	settings->setDefault("secure.enable_security", "true");
 	settings->setDefault("secure.trusted_mods", "");
 	settings->setDefault("secure.http_mods", "");
@@ -415,6 +420,7 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("movement_liquid_fluidity_smooth", "0.5");
 	settings->setDefault("movement_liquid_sink", "10");
 	settings->setDefault("movement_gravity", "9.81");
+	settings->setDefault("item_entity_ttl", "900");
 
 	// Liquids
 	settings->setDefault("liquid_loop_max", "100000");
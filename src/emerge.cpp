@@ -27,10 +27,12 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/container.h"
 #include "util/thread.h"
 #include "threading/event.h"
+#include "threading/task_pool.h"
 
 #include "config.h"
 #include "constants.h"
 #include "environment.h"
+#include "filesys.h"
 #include "log.h"
 #include "map.h"
 #include "mapblock.h"
@@ -38,8 +40,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapgen/mg_ore.h"
 #include "mapgen/mg_decoration.h"
 #include "mapgen/mg_schematic.h"
+#include "mapgen/noise_cache.h"
 #include "nodedef.h"
 #include "profiler.h"
+#include "scripting_emerge.h"
 #include "scripting_server.h"
 #include "server.h"
 #include "serverobject.h"
@@ -71,12 +75,15 @@ class EmergeThread : public Thread {
 	ServerMap *m_map;
 	EmergeManager *m_emerge;
 	Mapgen *m_mapgen;
+	EmergeScripting *m_script;
 
 	Event m_queue_event;
 	std::queue<v3s16> m_block_queue;
 
 	bool popBlockEmerge(v3s16 *pos, BlockEmergeData *bedata);
 
+	bool initScripting();
+
 	EmergeAction getBlockOrStartGen(
 		const v3s16 &pos, bool allow_gen, MapBlock **block, BlockMakeData *data);
 	MapBlock *finishGen(v3s16 pos, BlockMakeData *bmdata,
@@ -155,6 +162,15 @@ EmergeManager::EmergeManager(Server *server)
 	for (s16 i = 0; i < nthreads; i++)
 		m_threads.push_back(new EmergeThread(server, i));
 
+	s16 ntasks = 0;
+	g_settings->getS16NoEx("mapgen_task_threads", ntasks);
+	if (ntasks < 0)
+		ntasks = 0;
+	taskpool = new TaskPool("MapgenWorker", ntasks);
+
+	s32 ncached = g_settings->getS32("mapgen_noise_cache_size");
+	noisecache = new NoiseCache(MYMAX(ncached, 0));
+
 	infostream << "EmergeManager: using " << nthreads << " threads" << std::endl;
 }
 
@@ -181,6 +197,8 @@ EmergeManager::~EmergeManager()
 	delete oremgr;
 	delete decomgr;
 	delete schemmgr;
+	delete taskpool;
+	delete noisecache;
 }
 
 
@@ -190,6 +208,9 @@ void EmergeManager::initMapgens(MapgenParams *params)
 
 	mgparams = params;
 
+	// All biomes are registered at this point
+	biomemgr->updateLookup();
+
 	for (u32 i = 0; i != m_threads.size(); i++)
 		m_mapgens.push_back(Mapgen::createMapgen(params->mgtype, params, this));
 }
@@ -314,6 +335,16 @@ v3s16 EmergeManager::getContainingChunk(v3s16 blockpos, s16 chunksize)
 }
 
 
+void EmergeManager::addMapgenScript(const std::string &modname,
+	const std::string &path)
+{
+	FATAL_ERROR_IF(m_threads_active,
+		"Mapgen scripts added while emerge threads are running");
+
+	m_mapgen_scripts.emplace_back(modname, path);
+}
+
+
 int EmergeManager::getSpawnLevelAtPoint(v2s16 p)
 {
 	if (m_mapgens.empty() || !m_mapgens[0]) {
@@ -451,7 +482,8 @@ EmergeThread::EmergeThread(Server *server, int ethreadid) :
 	m_server(server),
 	m_map(NULL),
 	m_emerge(NULL),
-	m_mapgen(NULL)
+	m_mapgen(NULL),
+	m_script(NULL)
 {
 	m_name = "Emerge-" + itos(ethreadid);
 }
@@ -602,6 +634,29 @@ MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
 }
 
 
+bool EmergeThread::initScripting()
+{
+	if (m_emerge->m_mapgen_scripts.empty())
+		return true;
+
+	m_script = new EmergeScripting(m_server);
+
+	try {
+		m_script->loadMod(m_server->getBuiltinLuaPath() +
+			DIR_DELIM "init.lua", BUILTIN_MOD_NAME);
+
+		for (const auto &script : m_emerge->m_mapgen_scripts)
+			m_script->loadMod(script.second, script.first);
+	} catch (const ModError &e) {
+		m_server->setAsyncFatalError("Loading mapgen script failed: " +
+			std::string(e.what()));
+		return false;
+	}
+
+	return true;
+}
+
+
 void *EmergeThread::run()
 {
 	BEGIN_DEBUG_EXCEPTION_HANDLER
@@ -613,6 +668,12 @@ void *EmergeThread::run()
 	m_mapgen = m_emerge->m_mapgens[id];
 	enable_mapgen_debug_info = m_emerge->enable_mapgen_debug_info;
 
+	if (!initScripting()) {
+		delete m_script;
+		m_script = NULL;
+		return NULL;
+	}
+
 	try {
 	while (!stopRequested()) {
 		std::map<v3s16, MapBlock *> modified_blocks;
@@ -641,6 +702,23 @@ void *EmergeThread::run()
 				m_mapgen->makeChunk(&bmdata);
 			}
 
+			// Mapgen scripts run on this thread, without the env lock
+			if (m_script) {
+				ScopeProfiler sp(g_profiler,
+					"EmergeThread: mapgen scripts", SPT_AVG);
+
+				v3s16 minp = bmdata.blockpos_min * MAP_BLOCKSIZE;
+				v3s16 maxp = bmdata.blockpos_max * MAP_BLOCKSIZE +
+					v3s16(1, 1, 1) * (MAP_BLOCKSIZE - 1);
+				try {
+					m_script->on_generated(m_mapgen, minp, maxp,
+						m_mapgen->blockseed);
+				} catch (LuaError &e) {
+					m_server->setAsyncFatalError("Lua: mapgen script " +
+						std::string(e.what()));
+				}
+			}
+
 			block = finishGen(pos, &bmdata, &modified_blocks);
 		}
 
@@ -672,6 +750,9 @@ void *EmergeThread::run()
 		m_server->setAsyncFatalError(err.str());
 	}
 
+	delete m_script;
+	m_script = NULL;
+
 	END_DEBUG_EXCEPTION_HANDLER
 	return NULL;
 }
@@ -36,6 +36,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 }
 
 class EmergeThread;
+class TaskPool;
+class NoiseCache;
 class NodeDefManager;
 class Settings;
 
@@ -112,6 +114,11 @@ class EmergeManager {
 	DecorationManager *decomgr;
 	SchematicManager *schemmgr;
 
+	// Workers shared by all mapgens to split up the generation of a chunk
+	TaskPool *taskpool;
+	// 2D noise maps shared by all mapgens
+	NoiseCache *noisecache;
+
 	// Methods
 	EmergeManager(Server *server);
 	~EmergeManager();
@@ -147,11 +154,18 @@ class EmergeManager {
 
 	static v3s16 getContainingChunk(v3s16 blockpos, s16 chunksize);
 
+	// Scripts run in the Lua mapgen environment of each emerge thread.
+	// Must only be called before the threads are started.
+	void addMapgenScript(const std::string &modname, const std::string &path);
+
 private:
 	std::vector<Mapgen *> m_mapgens;
 	std::vector<EmergeThread *> m_threads;
 	bool m_threads_active = false;
 
+	// Pairs of mod name and script path
+	std::vector<std::pair<std::string, std::string>> m_mapgen_scripts;
+
 	std::mutex m_queue_mutex;
 	std::map<v3s16, BlockEmergeData> m_blocks_enqueued;
 	std::unordered_map<u16, u16> m_peer_queue_count;
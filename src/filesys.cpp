@@ -118,6 +118,17 @@ bool IsDir(const std::string &path)
 			(attr & FILE_ATTRIBUTE_DIRECTORY));
 }
 
+bool GetFileInfo(const std::string &path, u64 *size, u64 *mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data))
+		return false;
+	*size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	*mtime = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) |
+		data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
 bool IsDirDelimiter(char c)
 {
 	return c == '/' || c == '\\';
@@ -282,6 +293,16 @@ bool IsDir(const std::string &path)
 	return ((statbuf.st_mode & S_IFDIR) == S_IFDIR);
 }
 
+bool GetFileInfo(const std::string &path, u64 *size, u64 *mtime)
+{
+	struct stat statbuf{};
+	if (stat(path.c_str(), &statbuf))
+		return false;
+	*size = statbuf.st_size;
+	*mtime = statbuf.st_mtime;
+	return true;
+}
+
 bool IsDirDelimiter(char c)
 {
 	return c == '/';
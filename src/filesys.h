@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <string>
 #include <vector>
 #include "exceptions.h"
+#include "irrlichttypes.h"
 
 #ifdef _WIN32 // WINDOWS
 #define DIR_DELIM "\\"
@@ -56,6 +57,9 @@ bool IsPathAbsolute(const std::string &path);
 
 bool IsDir(const std::string &path);
 
+// Gets the size and the last modification time of a file
+bool GetFileInfo(const std::string &path, u64 *size, u64 *mtime);
+
 bool IsDirDelimiter(char c);
 
 // Only pass full paths to this one. True on success.
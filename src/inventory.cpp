@@ -398,8 +398,9 @@ void InventoryList::setSize(u32 newsize)
 
 void InventoryList::setWidth(u32 newwidth)
 {
+	// The width is always sent, the slots stay untouched
 	m_width = newwidth;
-	setModified();
+	m_dirty = true;
 }
 
 void InventoryList::setName(const std::string &name)
@@ -414,16 +415,17 @@ void InventoryList::serialize(std::ostream &os, bool incremental) const
 
 	os<<"Width "<<m_width<<"\n";
 
-	for (const auto &item : m_items) {
-		if (item.empty()) {
+	for (u32 i = 0; i < m_items.size(); i++) {
+		const ItemStack &item = m_items[i];
+		if (incremental && !m_dirty_slots[i]) {
+			// Unchanged since the last update the client got
+			os<<"Keep";
+		} else if (item.empty()) {
 			os<<"Empty";
 		} else {
 			os<<"Item ";
 			item.serialize(os);
 		}
-		// TODO: Implement this:
-		// if (!incremental || item.checkModified())
-		// os << "Keep";
 		os<<"\n";
 	}
 
@@ -499,7 +501,7 @@ InventoryList & InventoryList::operator = (const InventoryList &other)
 	m_width = other.m_width;
 	m_name = other.m_name;
 	m_itemdef = other.m_itemdef;
-	//setDirty(true);
+	setModified();
 
 	return *this;
 }
@@ -568,7 +570,7 @@ ItemStack InventoryList::changeItem(u32 i, const ItemStack &newitem)
 
 	ItemStack olditem = m_items[i];
 	m_items[i] = newitem;
-	setModified();
+	setSlotModified(i);
 	return olditem;
 }
 
@@ -576,7 +578,7 @@ void InventoryList::deleteItem(u32 i)
 {
 	assert(i < m_items.size()); // Pre-condition
 	m_items[i].clear();
-	setModified();
+	setSlotModified(i);
 }
 
 ItemStack InventoryList::addItem(const ItemStack &newitem_)
@@ -625,7 +627,7 @@ ItemStack InventoryList::addItem(u32 i, const ItemStack &newitem)
 
 	ItemStack leftover = m_items[i].addItem(newitem, m_itemdef);
 	if (leftover != newitem)
-		setModified();
+		setSlotModified(i);
 	return leftover;
 }
 
@@ -680,8 +682,10 @@ ItemStack InventoryList::removeItem(const ItemStack &item)
 	for (auto i = m_items.rbegin(); i != m_items.rend(); ++i) {
 		if (i->name == item.name) {
 			u32 still_to_remove = item.count - removed.count;
-			ItemStack leftover = removed.addItem(i->takeItem(still_to_remove),
-					m_itemdef);
+			ItemStack taken = i->takeItem(still_to_remove);
+			if (!taken.empty())
+				setSlotModified(m_items.rend() - i - 1);
+			ItemStack leftover = removed.addItem(taken, m_itemdef);
 			// Allow oversized stacks
 			removed.count += leftover.count;
 
@@ -689,8 +693,6 @@ ItemStack InventoryList::removeItem(const ItemStack &item)
 				break;
 		}
 	}
-	if (!removed.empty())
-		setModified();
 	return removed;
 }
 
@@ -701,7 +703,7 @@ ItemStack InventoryList::takeItem(u32 i, u32 takecount)
 
 	ItemStack taken = m_items[i].takeItem(takecount);
 	if (!taken.empty())
-		setModified();
+		setSlotModified(i);
 	return taken;
 }
 
@@ -266,15 +266,28 @@ class InventoryList
 	void moveItemSomewhere(u32 i, InventoryList *dest, u32 count);
 
 	inline bool checkModified() const { return m_dirty; }
-	inline void setModified(bool dirty = true) { m_dirty = dirty; }
+	// Marking the list as modified marks all of its slots as well
+	inline void setModified(bool dirty = true)
+	{
+		m_dirty = dirty;
+		m_dirty_slots.assign(m_items.size(), dirty);
+	}
 
 private:
+	inline void setSlotModified(u32 i)
+	{
+		m_dirty = true;
+		m_dirty_slots[i] = true;
+	}
+
 	std::vector<ItemStack> m_items;
 	std::string m_name;
 	u32 m_size;
 	u32 m_width = 0;
 	IItemDefManager *m_itemdef;
 	bool m_dirty = true;
+	// Slots changed since the last incremental serialization
+	std::vector<bool> m_dirty_slots;
 };
 
 class Inventory
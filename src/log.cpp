@@ -20,6 +20,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "log.h"
 
 #include "threading/mutex_auto_lock.h"
+#include "threading/semaphore.h"
+#include "threading/thread.h"
 #include "debug.h"
 #include "gettime.h"
 #include "porting.h"
@@ -36,6 +38,107 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 const int BUFFER_LENGTH = 256;
 
+// Records per thread queue in asynchronous mode. Together with the line
+// length limit of the stream buffers this bounds the queued memory.
+const u32 LOG_QUEUE_SIZE = 1024;
+
+struct LogRecord {
+	LogLevel lev;
+	bool raw;
+	std::string combined;
+	std::string time;
+	std::string thread_name;
+	std::string payload_text;
+};
+
+/*
+	Fixed size ring buffer with one producer (the thread owning it) and one
+	consumer (whoever holds Logger::m_drain_mutex). Neither side locks.
+*/
+class LogRecordQueue {
+public:
+	bool push(LogRecord &&record)
+	{
+		u32 tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) >= LOG_QUEUE_SIZE)
+			return false;
+		m_records[tail % LOG_QUEUE_SIZE] = std::move(record);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(LogRecord &record)
+	{
+		u32 head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return false;
+		record = std::move(m_records[head % LOG_QUEUE_SIZE]);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Set once the producing thread exited, the queue is then removed
+	// after it has been drained
+	std::atomic<bool> orphaned { false };
+
+private:
+	LogRecord m_records[LOG_QUEUE_SIZE];
+	std::atomic<u32> m_head { 0 };
+	std::atomic<u32> m_tail { 0 };
+};
+
+// Per-thread handle to the queue of the logger in asynchronous mode
+struct LogQueueHandle {
+	~LogQueueHandle()
+	{
+		if (queue)
+			queue->orphaned = true;
+	}
+
+	const Logger *owner = nullptr;
+	std::shared_ptr<LogRecordQueue> queue;
+};
+
+static thread_local LogQueueHandle t_log_queue;
+
+class LogWriterThread : public Thread {
+public:
+	LogWriterThread(Logger *logger) :
+		Thread("LogWriter"),
+		m_logger(logger)
+	{}
+
+	void wake()
+	{
+		if (!m_wake_pending.exchange(true))
+			m_signal.post();
+	}
+
+	void stopAndWait()
+	{
+		stop();
+		m_signal.post();
+		wait();
+	}
+
+protected:
+	void *run()
+	{
+		while (!stopRequested()) {
+			// Timeout so that drop reports are not held back indefinitely
+			m_signal.wait(500);
+			m_wake_pending = false;
+			m_logger->flush();
+		}
+		return nullptr;
+	}
+
+private:
+	Logger *m_logger;
+	Semaphore m_signal;
+	std::atomic<bool> m_wake_pending { false };
+};
+
 class StringBuffer : public std::streambuf {
 public:
 	StringBuffer() {
@@ -158,6 +261,22 @@ AndroidSystemLogOutput g_android_log_output;
 //// Logger
 ////
 
+Logger::Logger() :
+	m_trace_enabled(false),
+	m_async(false),
+	m_dropped(0),
+	m_dropped_total(0)
+{
+	for (volatile bool &silenced : m_silenced_levels)
+		silenced = false;
+}
+
+Logger::~Logger()
+{
+	setAsync(false);
+	delete m_writer;
+}
+
 LogLevel Logger::stringToLevel(const std::string &name)
 {
 	if (name == "none")
@@ -278,6 +397,10 @@ void Logger::log(LogLevel lev, const std::string &text)
 	std::ostringstream os(std::ios_base::binary);
 	os << timestamp << ": " << label << "[" << thread_name << "]: " << text;
 
+	if (m_async && pushRecord(lev, false, os.str(), timestamp,
+			thread_name, text))
+		return;
+
 	logToOutputs(lev, os.str(), timestamp, thread_name, text);
 }
 
@@ -286,9 +409,115 @@ void Logger::logRaw(LogLevel lev, const std::string &text)
 	if (m_silenced_levels[lev])
 		return;
 
+	if (m_async && pushRecord(lev, true, text, "", "", ""))
+		return;
+
 	logToOutputsRaw(lev, text);
 }
 
+void Logger::setAsync(bool async)
+{
+	MutexAutoLock lock(m_async_mutex);
+	if (async == m_async)
+		return;
+
+	if (async) {
+		// Kept until the logger is destroyed, producers wake it unlocked
+		if (!m_writer)
+			m_writer = new LogWriterThread(this);
+		m_async = true;
+		m_writer->start();
+		return;
+	}
+
+	m_async = false;
+	m_writer->stopAndWait();
+	flush();
+}
+
+std::shared_ptr<LogRecordQueue> Logger::getThreadQueue()
+{
+	if (t_log_queue.owner == this)
+		return t_log_queue.queue;
+
+	if (t_log_queue.queue)
+		t_log_queue.queue->orphaned = true;
+
+	t_log_queue.owner = this;
+	t_log_queue.queue = std::make_shared<LogRecordQueue>();
+
+	MutexAutoLock lock(m_queues_mutex);
+	m_queues.push_back(t_log_queue.queue);
+	return t_log_queue.queue;
+}
+
+bool Logger::pushRecord(LogLevel lev, bool raw, const std::string &combined,
+	const std::string &time, const std::string &thread_name,
+	const std::string &payload_text)
+{
+	// Errors may be followed by a crash, write them (and everything queued
+	// before them) right away
+	if (lev <= LL_ERROR) {
+		flush();
+		return false;
+	}
+
+	LogRecord record = { lev, raw, combined, time, thread_name, payload_text };
+	if (!getThreadQueue()->push(std::move(record))) {
+		m_dropped++;
+		m_dropped_total++;
+		return true;
+	}
+
+	m_writer->wake();
+	// Asynchronous mode may have been disabled after the check in log()
+	if (!m_async)
+		flush();
+	return true;
+}
+
+void Logger::flush()
+{
+	MutexAutoLock drain_lock(m_drain_mutex);
+
+	std::vector<std::shared_ptr<LogRecordQueue>> queues;
+	{
+		MutexAutoLock lock(m_queues_mutex);
+		queues = m_queues;
+	}
+
+	LogRecord record;
+	for (const std::shared_ptr<LogRecordQueue> &queue : queues) {
+		// Check before popping, a record pushed after the last pop of an
+		// orphaned queue cannot exist
+		bool orphaned = queue->orphaned;
+		while (queue->pop(record)) {
+			if (record.raw)
+				logToOutputsRaw(record.lev, record.combined);
+			else
+				logToOutputs(record.lev, record.combined, record.time,
+					record.thread_name, record.payload_text);
+		}
+
+		if (orphaned) {
+			MutexAutoLock lock(m_queues_mutex);
+			m_queues.erase(std::find(m_queues.begin(), m_queues.end(), queue));
+		}
+	}
+
+	u32 dropped = m_dropped.exchange(0);
+	if (dropped > 0) {
+		const std::string thread_name = getThreadName();
+		const std::string timestamp = getTimestamp();
+		const std::string text = std::to_string(dropped) +
+			" log messages were dropped, the log queue was full";
+		std::ostringstream os(std::ios_base::binary);
+		os << timestamp << ": " << getLevelLabel(LL_WARNING) << "["
+			<< thread_name << "]: " << text;
+		logToOutputs(LL_WARNING, os.str(), timestamp, thread_name, text);
+	}
+}
+
 void Logger::logToOutputsRaw(LogLevel lev, const std::string &line)
 {
 	MutexAutoLock lock(m_mutex);
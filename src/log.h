@@ -19,7 +19,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <queue>
 #include <string>
 #include <fstream>
@@ -31,6 +33,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irrlichttypes.h"
 
 class ILogOutput;
+class LogRecordQueue;
+class LogWriterThread;
 
 enum LogLevel {
 	LL_NONE, // Special level that is always printed
@@ -53,6 +57,9 @@ typedef u8 LogLevelMask;
 
 class Logger {
 public:
+	Logger();
+	~Logger();
+
 	void addOutput(ILogOutput *out);
 	void addOutput(ILogOutput *out, LogLevel lev);
 	void addOutputMasked(ILogOutput *out, LogLevelMask mask);
@@ -67,6 +74,21 @@ class Logger {
 	// Logs without a prefix
 	void logRaw(LogLevel lev, const std::string &text);
 
+	/*
+		In asynchronous mode, log() and logRaw() format the record on the
+		calling thread and push it into a bounded queue owned by that thread.
+		A writer thread drains the queues into the outputs. Records that do
+		not fit into a full queue are dropped and counted.
+		Errors and LL_NONE records are still written synchronously, after
+		flushing everything queued before them.
+	*/
+	void setAsync(bool async);
+	bool isAsync() const { return m_async; }
+	// Writes all queued records on the calling thread
+	void flush();
+	// Total number of records dropped because a queue was full
+	u64 getDroppedCount() const { return m_dropped_total; }
+
 	void setTraceEnabled(bool enable) { m_trace_enabled = enable; }
 	bool getTraceEnabled() { return m_trace_enabled; }
 
@@ -83,6 +105,12 @@ class Logger {
 
 	const std::string getThreadName();
 
+	// Returns false if the record has to be written synchronously
+	bool pushRecord(LogLevel lev, bool raw, const std::string &combined,
+		const std::string &time, const std::string &thread_name,
+		const std::string &payload_text);
+	std::shared_ptr<LogRecordQueue> getThreadQueue();
+
 	std::vector<ILogOutput *> m_outputs[LL_MAX];
 
 	// Should implement atomic loads and stores (even though it's only
@@ -92,6 +120,17 @@ class Logger {
 	std::map<std::thread::id, std::string> m_thread_names;
 	mutable std::mutex m_mutex;
 	bool m_trace_enabled;
+
+	std::atomic<bool> m_async;
+	LogWriterThread *m_writer = nullptr;
+	// Serializes setAsync()
+	std::mutex m_async_mutex;
+	// Held while draining, the queues have a single consumer
+	std::mutex m_drain_mutex;
+	std::mutex m_queues_mutex;
+	std::vector<std::shared_ptr<LogRecordQueue>> m_queues;
+	std::atomic<u32> m_dropped;
+	std::atomic<u64> m_dropped_total;
 };
 
 class ILogOutput {
@@ -189,19 +228,23 @@ class LogOutputBuffer : public ICombinedLogOutput {
 		m_logger.removeOutput(this);
 	}
 
+	// Locked, lines may arrive from the asynchronous log writer thread
 	void logRaw(LogLevel lev, const std::string &line)
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_buffer.push(line);
 	}
 
 	bool empty()
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 		return m_buffer.empty();
 	}
 
 	std::string get()
 	{
-		if (empty())
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_buffer.empty())
 			return "";
 		std::string s = m_buffer.front();
 		m_buffer.pop();
@@ -210,6 +253,7 @@ class LogOutputBuffer : public ICombinedLogOutput {
 
 private:
 	std::queue<std::string> m_buffer;
+	std::mutex m_mutex;
 	Logger &m_logger;
 };
 
@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "chat_interface.h"
 #include "debug.h"
 #include "unittest/test.h"
+#include "benchmark/benchmark.h"
 #include "server.h"
 #include "filesys.h"
 #include "version.h"
@@ -108,6 +109,12 @@ static bool migrate_map_database(const GameParams &game_params, const Settings &
 
 FileLogOutput file_log_output;
 
+// Declared after file_log_output so that the asynchronous log writer is
+// stopped and drained before the file is closed, on every exit path
+static struct AsyncLogShutdown {
+	~AsyncLogShutdown() { g_logger.setAsync(false); }
+} async_log_shutdown;
+
 static OptionList allowed_options;
 
 int main(int argc, char *argv[])
@@ -189,6 +196,11 @@ int main(int argc, char *argv[])
 	if (cmd_args.getFlag("run-unittests")) {
 		return run_tests();
 	}
+
+	// Run benchmarks
+	if (cmd_args.getFlag("run-benchmarks")) {
+		return run_benchmarks();
+	}
 #endif
 
 	GameParams game_params;
@@ -261,6 +273,8 @@ static void set_allowed_options(OptionList *allowed_options)
 			_("Set network port (UDP)"))));
 	allowed_options->insert(std::make_pair("run-unittests", ValueSpec(VALUETYPE_FLAG,
 			_("Run the unit tests and exit"))));
+	allowed_options->insert(std::make_pair("run-benchmarks", ValueSpec(VALUETYPE_FLAG,
+			_("Run the benchmarks and exit"))));
 	allowed_options->insert(std::make_pair("map-dir", ValueSpec(VALUETYPE_STRING,
 			_("Same as --world (deprecated)"))));
 	allowed_options->insert(std::make_pair("world", ValueSpec(VALUETYPE_STRING,
@@ -555,6 +569,8 @@ static void init_log_streams(const Settings &cmd_args)
 		log_filename = cmd_args.get("logfile");
 
 	g_logger.removeOutput(&file_log_output);
+	g_logger.setAsync(g_settings->getBool("debug_log_async"));
+
 	std::string conf_loglev = g_settings->get("debug_log_level");
 
 	// Old integer format
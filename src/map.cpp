@@ -2070,6 +2070,24 @@ MMVManip::MMVManip(Map *map):
 {
 }
 
+MMVManip *MMVManip::clone() const
+{
+	MMVManip *ret = new MMVManip(nullptr);
+
+	const s32 size = m_area.getVolume();
+	if (size > 0) {
+		ret->m_area = m_area;
+		ret->m_data = new MapNode[size];
+		memcpy(ret->m_data, m_data, size * sizeof(MapNode));
+		ret->m_flags = new u8[size];
+		memcpy(ret->m_flags, m_flags, size * sizeof(u8));
+	}
+
+	ret->m_is_dirty = false;
+
+	return ret;
+}
+
 void MMVManip::initialEmerge(v3s16 blockpos_min, v3s16 blockpos_max,
 	bool load_if_inexistent)
 {
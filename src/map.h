@@ -473,6 +473,12 @@ class MMVManip : public VoxelManipulator
 	void blitBackAll(std::map<v3s16, MapBlock*> * modified_blocks,
 		bool overwrite_generated = true);
 
+	/*
+		Creates a copy of the loaded data that is not attached to any map.
+		initialEmerge() and blitBackAll() must not be called on it.
+	*/
+	MMVManip *clone() const;
+
 	bool m_is_dirty = false;
 
 protected:
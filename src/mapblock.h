@@ -520,6 +520,11 @@ class MapBlock
 
 #ifndef SERVER // Only on client
 	MapBlockMesh *mesh = nullptr;
+
+	// Cached occlusion culling result, valid while occlusion_stamp matches
+	// the one of the ClientMap
+	u32 occlusion_stamp = 0;
+	bool occluded = false;
 #endif
 
 	NodeMetadataList m_node_metadata;
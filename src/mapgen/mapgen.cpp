@@ -42,6 +42,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/directiontables.h"
 #include "filesys.h"
 #include "log.h"
+#include "threading/task_pool.h"
+#include "noise_cache.h"
 #include "mapgen_carpathian.h"
 #include "mapgen_flat.h"
 #include "mapgen_fractal.h"
@@ -605,6 +607,7 @@ MapgenBasic::MapgenBasic(int mapgenid, MapgenParams *params, EmergeManager *emer
 
 	//// Initialize biome generator
 	biomegen = m_bmgr->createBiomeGen(BIOMEGEN_ORIGINAL, params->bparams, csize);
+	biomegen->setNoiseCache(emerge->noisecache);
 	biomemap = biomegen->biomemap;
 
 	//// Look up some commonly used content
@@ -628,18 +631,59 @@ MapgenBasic::~MapgenBasic()
 }
 
 
+void MapgenBasic::runTasks(const std::vector<std::function<void()>> &tasks)
+{
+	m_emerge->taskpool->run(tasks);
+}
+
+
+u32 MapgenBasic::getNumSlabs() const
+{
+	return MYMAX(csize.Z / MAP_BLOCKSIZE, 1);
+}
+
+
+void MapgenBasic::forEachSlab(const std::function<void(u32, s16, s16)> &fn)
+{
+	u32 num_slabs = getNumSlabs();
+	s16 depth = csize.Z / num_slabs;
+
+	m_emerge->taskpool->run(num_slabs, [&] (u32 slab) {
+		s16 z_min = node_min.Z + slab * depth;
+		s16 z_max = (slab == num_slabs - 1) ? node_max.Z : z_min + depth - 1;
+		fn(slab, z_min, z_max);
+	});
+}
+
+
+void MapgenBasic::calcNoiseMap2D(Noise *noise, Noise *persist_noise)
+{
+	m_emerge->noisecache->perlinMap2D(noise, node_min.X, node_min.Z,
+		persist_noise);
+}
+
+
 void MapgenBasic::generateBiomes()
 {
 	// can't generate biomes without a biome generator!
 	assert(biomegen);
 	assert(biomemap);
 
-	const v3s16 &em = vm->m_area.getExtent();
-	u32 index = 0;
+	calcNoiseMap2D(noise_filler_depth);
 
-	noise_filler_depth->perlinMap2D(node_min.X, node_min.Z);
+	// Columns are independent of each other
+	forEachSlab([this] (u32 slab, s16 z_min, s16 z_max) {
+		generateBiomesSlab(z_min, z_max);
+	});
+}
 
-	for (s16 z = node_min.Z; z <= node_max.Z; z++)
+
+void MapgenBasic::generateBiomesSlab(s16 z_min, s16 z_max)
+{
+	const v3s16 &em = vm->m_area.getExtent();
+	u32 index = (z_min - node_min.Z) * csize.X;
+
+	for (s16 z = z_min; z <= z_max; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index++) {
 		Biome *biome = NULL;
 		biome_t water_biome_index = 0;
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #pragma once
 
+#include <functional>
 #include "noise.h"
 #include "nodedef.h"
 #include "util/string.h"
@@ -249,6 +250,19 @@ class MapgenBasic : public Mapgen {
 	virtual void generateDungeons(s16 max_stone_y);
 
 protected:
+	// Runs independent tasks, possibly in parallel on the emerge workers
+	void runTasks(const std::vector<std::function<void()>> &tasks);
+	// Splits the mapchunk columns into slabs of one mapblock along Z and
+	// calls fn(slab, z_min, z_max) for each, possibly in parallel.
+	// The split does not depend on the number of workers.
+	u32 getNumSlabs() const;
+	void forEachSlab(const std::function<void(u32, s16, s16)> &fn);
+	// Calculates a 2D noise map at node_min, reusing the maps of other
+	// mapchunks in the same column
+	void calcNoiseMap2D(Noise *noise, Noise *persist_noise = nullptr);
+
+	void generateBiomesSlab(s16 z_min, s16 z_max);
+
 	EmergeManager *m_emerge;
 	BiomeManager *m_bmgr;
 
@@ -427,33 +427,52 @@ int MapgenCarpathian::getSpawnLevelAtPoint(v2s16 p)
 
 
 int MapgenCarpathian::generateTerrain()
+{
+	// Calculate noise for terrain generation, the noises are independent
+	std::vector<Noise *> noises_2d = {
+		noise_height1, noise_height2, noise_height3, noise_height4,
+		noise_hills_terrain, noise_ridge_terrain, noise_step_terrain,
+		noise_hills, noise_ridge_mnt, noise_step_mnt,
+	};
+	if (spflags & MGCARPATHIAN_RIVERS)
+		noises_2d.push_back(noise_rivers);
+
+	std::vector<std::function<void()>> tasks;
+	tasks.emplace_back([this] () {
+		noise_mnt_var->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
+	});
+	for (Noise *noise : noises_2d) {
+		tasks.emplace_back([this, noise] () {
+			calcNoiseMap2D(noise);
+		});
+	}
+	runTasks(tasks);
+
+	//// Place nodes
+	std::vector<s16> slab_max_y(getNumSlabs());
+	forEachSlab([&] (u32 slab, s16 z_min, s16 z_max) {
+		slab_max_y[slab] = generateTerrainSlab(z_min, z_max);
+	});
+
+	s16 stone_surface_max_y = -MAX_MAP_GENERATION_LIMIT;
+	for (s16 max_y : slab_max_y)
+		stone_surface_max_y = MYMAX(stone_surface_max_y, max_y);
+
+	return stone_surface_max_y;
+}
+
+
+int MapgenCarpathian::generateTerrainSlab(s16 z_min, s16 z_max)
 {
 	MapNode mn_air(CONTENT_AIR);
 	MapNode mn_stone(c_stone);
 	MapNode mn_water(c_water_source);
 
-	// Calculate noise for terrain generation
-	noise_height1->perlinMap2D(node_min.X, node_min.Z);
-	noise_height2->perlinMap2D(node_min.X, node_min.Z);
-	noise_height3->perlinMap2D(node_min.X, node_min.Z);
-	noise_height4->perlinMap2D(node_min.X, node_min.Z);
-	noise_hills_terrain->perlinMap2D(node_min.X, node_min.Z);
-	noise_ridge_terrain->perlinMap2D(node_min.X, node_min.Z);
-	noise_step_terrain->perlinMap2D(node_min.X, node_min.Z);
-	noise_hills->perlinMap2D(node_min.X, node_min.Z);
-	noise_ridge_mnt->perlinMap2D(node_min.X, node_min.Z);
-	noise_step_mnt->perlinMap2D(node_min.X, node_min.Z);
-	noise_mnt_var->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-
-	if (spflags & MGCARPATHIAN_RIVERS)
-		noise_rivers->perlinMap2D(node_min.X, node_min.Z);
-
-	//// Place nodes
 	const v3s16 &em = vm->m_area.getExtent();
 	s16 stone_surface_max_y = -MAX_MAP_GENERATION_LIMIT;
-	u32 index2d = 0;
+	u32 index2d = (z_min - node_min.Z) * csize.X;
 
-	for (s16 z = node_min.Z; z <= node_max.Z; z++)
+	for (s16 z = z_min; z <= z_max; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index2d++) {
 		// Hill/Mountain height (hilliness)
 		float height1 = noise_height1->result[index2d];
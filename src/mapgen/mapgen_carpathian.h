@@ -111,4 +111,5 @@ class MapgenCarpathian : public MapgenBasic
 	float getSteps(float noise);
 	inline float getLerp(float noise1, float noise2, float mod);
 	int generateTerrain();
+	int generateTerrainSlab(s16 z_min, s16 z_max);
 };
@@ -496,37 +496,74 @@ void MapgenV7::floatBaseExtentFromMap(s16 *float_base_min, s16 *float_base_max,
 
 int MapgenV7::generateTerrain()
 {
-	MapNode n_air(CONTENT_AIR);
-	MapNode n_stone(c_stone);
-	MapNode n_water(c_water_source);
-
 	//// Calculate noise for terrain generation
-	noise_terrain_persist->perlinMap2D(node_min.X, node_min.Z);
-	float *persistmap = noise_terrain_persist->result;
+	// Noises are independent of each other except for the persistence map
+	std::vector<std::function<void()>> tasks;
 
-	noise_terrain_base->perlinMap2D(node_min.X, node_min.Z, persistmap);
-	noise_terrain_alt->perlinMap2D(node_min.X, node_min.Z, persistmap);
-	noise_height_select->perlinMap2D(node_min.X, node_min.Z);
+	tasks.emplace_back([this] () {
+		calcNoiseMap2D(noise_terrain_persist);
+	});
+	tasks.emplace_back([this] () {
+		calcNoiseMap2D(noise_height_select);
+	});
 
 	if ((spflags & MGV7_MOUNTAINS) || (spflags & MGV7_FLOATLANDS)) {
-		noise_mountain->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
+		tasks.emplace_back([this] () {
+			noise_mountain->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
+		});
 	}
 
 	if (spflags & MGV7_MOUNTAINS) {
-		noise_mount_height->perlinMap2D(node_min.X, node_min.Z);
+		tasks.emplace_back([this] () {
+			calcNoiseMap2D(noise_mount_height);
+		});
 	}
 
 	if (spflags & MGV7_FLOATLANDS) {
-		noise_floatland_base->perlinMap2D(node_min.X, node_min.Z);
-		noise_float_base_height->perlinMap2D(node_min.X, node_min.Z);
+		tasks.emplace_back([this] () {
+			calcNoiseMap2D(noise_floatland_base);
+		});
+		tasks.emplace_back([this] () {
+			calcNoiseMap2D(noise_float_base_height);
+		});
 	}
 
+	runTasks(tasks);
+
+	runTasks({
+		[this] () {
+			calcNoiseMap2D(noise_terrain_base, noise_terrain_persist);
+		},
+		[this] () {
+			calcNoiseMap2D(noise_terrain_alt, noise_terrain_persist);
+		},
+	});
+
 	//// Place nodes
+	std::vector<s16> slab_max_y(getNumSlabs());
+	forEachSlab([&] (u32 slab, s16 z_min, s16 z_max) {
+		slab_max_y[slab] = generateTerrainSlab(z_min, z_max);
+	});
+
+	s16 stone_surface_max_y = -MAX_MAP_GENERATION_LIMIT;
+	for (s16 max_y : slab_max_y)
+		stone_surface_max_y = MYMAX(stone_surface_max_y, max_y);
+
+	return stone_surface_max_y;
+}
+
+
+int MapgenV7::generateTerrainSlab(s16 z_min, s16 z_max)
+{
+	MapNode n_air(CONTENT_AIR);
+	MapNode n_stone(c_stone);
+	MapNode n_water(c_water_source);
+
 	const v3s16 &em = vm->m_area.getExtent();
 	s16 stone_surface_max_y = -MAX_MAP_GENERATION_LIMIT;
-	u32 index2d = 0;
+	u32 index2d = (z_min - node_min.Z) * csize.X;
 
-	for (s16 z = node_min.Z; z <= node_max.Z; z++)
+	for (s16 z = z_min; z <= z_max; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index2d++) {
 		s16 surface_y = baseTerrainLevelFromMap(index2d);
 		if (surface_y > stone_surface_max_y)
@@ -582,15 +619,29 @@ void MapgenV7::generateRidgeTerrain()
 			((spflags & MGV7_FLOATLANDS) && node_max.Y > shadow_limit))
 		return;
 
-	noise_ridge->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-	noise_ridge_uwater->perlinMap2D(node_min.X, node_min.Z);
+	runTasks({
+		[this] () {
+			noise_ridge->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
+		},
+		[this] () {
+			calcNoiseMap2D(noise_ridge_uwater);
+		},
+	});
+
+	forEachSlab([this] (u32 slab, s16 z_min, s16 z_max) {
+		generateRidgeTerrainSlab(z_min, z_max);
+	});
+}
 
+
+void MapgenV7::generateRidgeTerrainSlab(s16 z_min, s16 z_max)
+{
 	MapNode n_water(c_water_source);
 	MapNode n_air(CONTENT_AIR);
-	u32 index3d = 0;
+	u32 index3d = (z_min - node_min.Z) * zstride_1u1d;
 	float width = 0.2f;
 
-	for (s16 z = node_min.Z; z <= node_max.Z; z++)
+	for (s16 z = z_min; z <= z_max; z++)
 	for (s16 y = node_min.Y - 1; y <= node_max.Y + 1; y++) {
 		u32 vi = vm->m_area.index(node_min.X, y, z);
 		for (s16 x = node_min.X; x <= node_max.X; x++, index3d++, vi++) {
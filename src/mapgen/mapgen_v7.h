@@ -94,7 +94,9 @@ class MapgenV7 : public MapgenBasic {
 	void floatBaseExtentFromMap(s16 *float_base_min, s16 *float_base_max, int idx_xz);
 
 	int generateTerrain();
+	int generateTerrainSlab(s16 z_min, s16 z_max);
 	void generateRidgeTerrain();
+	void generateRidgeTerrainSlab(s16 z_min, s16 z_max);
 
 private:
 	s16 mount_zero_level;
@@ -325,25 +325,46 @@ int MapgenValleys::getSpawnLevelAtPoint(v2s16 p)
 
 
 int MapgenValleys::generateTerrain()
+{
+	// The noises are independent of each other
+	std::vector<std::function<void()>> tasks;
+	tasks.emplace_back([this] () {
+		noise_inter_valley_fill->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
+	});
+	for (Noise *noise : {noise_inter_valley_slope, noise_rivers,
+			noise_terrain_height, noise_valley_depth, noise_valley_profile}) {
+		tasks.emplace_back([this, noise] () {
+			calcNoiseMap2D(noise);
+		});
+	}
+	runTasks(tasks);
+
+	// Columns only modify their own heat and humidity values
+	std::vector<s16> slab_max_y(getNumSlabs());
+	forEachSlab([&] (u32 slab, s16 z_min, s16 z_max) {
+		slab_max_y[slab] = generateTerrainSlab(z_min, z_max);
+	});
+
+	s16 surface_max_y = -MAX_MAP_GENERATION_LIMIT;
+	for (s16 max_y : slab_max_y)
+		surface_max_y = MYMAX(surface_max_y, max_y);
+
+	return surface_max_y;
+}
+
+
+int MapgenValleys::generateTerrainSlab(s16 z_min, s16 z_max)
 {
 	MapNode n_air(CONTENT_AIR);
 	MapNode n_river_water(c_river_water_source);
 	MapNode n_stone(c_stone);
 	MapNode n_water(c_water_source);
 
-	noise_inter_valley_slope->perlinMap2D(node_min.X, node_min.Z);
-	noise_rivers->perlinMap2D(node_min.X, node_min.Z);
-	noise_terrain_height->perlinMap2D(node_min.X, node_min.Z);
-	noise_valley_depth->perlinMap2D(node_min.X, node_min.Z);
-	noise_valley_profile->perlinMap2D(node_min.X, node_min.Z);
-
-	noise_inter_valley_fill->perlinMap3D(node_min.X, node_min.Y - 1, node_min.Z);
-
 	const v3s16 &em = vm->m_area.getExtent();
 	s16 surface_max_y = -MAX_MAP_GENERATION_LIMIT;
-	u32 index_2d = 0;
+	u32 index_2d = (z_min - node_min.Z) * csize.X;
 
-	for (s16 z = node_min.Z; z <= node_max.Z; z++)
+	for (s16 z = z_min; z <= z_max; z++)
 	for (s16 x = node_min.X; x <= node_max.X; x++, index_2d++) {
 		float n_slope          = noise_inter_valley_slope->result[index_2d];
 		float n_rivers         = noise_rivers->result[index_2d];
@@ -108,4 +108,5 @@ class MapgenValleys : public MapgenBasic {
 	Noise *noise_valley_profile;
 
 	virtual int generateTerrain();
+	int generateTerrainSlab(s16 z_min, s16 z_max);
 };
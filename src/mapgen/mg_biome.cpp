@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "mg_biome.h"
 #include "mg_decoration.h"
+#include "noise_cache.h"
 #include "emerge.h"
 #include "server.h"
 #include "nodedef.h"
@@ -27,6 +28,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/numeric.h"
 #include "porting.h"
 #include "settings.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -67,7 +72,8 @@ BiomeManager::BiomeManager(Server *server) :
 	b->m_nodenames.emplace_back("ignore");
 	b->m_nodenames.emplace_back("ignore");
 	b->m_nodenames.emplace_back("ignore");
-	m_ndef->pendNodeResolve(b);
+	if (m_ndef)
+		m_ndef->pendNodeResolve(b);
 
 	add(b);
 }
@@ -89,6 +95,7 @@ void BiomeManager::clear()
 		delete (Biome *)m_objects[i];
 
 	m_objects.resize(1);
+	m_lookup.reset();
 }
 
 
@@ -112,44 +119,271 @@ float BiomeManager::getHumidityAtPosOriginal(v3s16 pos, NoiseParams &np_humidity
 }
 
 
-// For BiomeGen type 'BiomeGenOriginal'
-Biome *BiomeManager::getBiomeFromNoiseOriginal(float heat, float humidity, v3s16 pos)
-{
-	Biome *biome_closest = nullptr;
-	Biome *biome_closest_blend = nullptr;
+// Closest biomes found so far, for BiomeGen type 'BiomeGenOriginal'
+struct BiomeSearch {
+	Biome *closest = nullptr;
+	Biome *closest_blend = nullptr;
 	float dist_min = FLT_MAX;
 	float dist_min_blend = FLT_MAX;
+};
+
+
+static inline bool biomeContainsXZ(const Biome *b, v3s16 pos)
+{
+	return pos.X >= b->min_pos.X && pos.X <= b->max_pos.X &&
+		pos.Z >= b->min_pos.Z && pos.Z <= b->max_pos.Z;
+}
+
+
+static inline float biomeDistance(const Biome *b, float heat, float humidity)
+{
+	float d_heat = heat - b->heat_point;
+	float d_humidity = humidity - b->humidity_point;
+	return (d_heat * d_heat) + (d_humidity * d_humidity);
+}
+
+
+static Biome *selectBiome(const BiomeSearch &search, float heat, float humidity,
+	v3s16 pos, Biome *biome_none)
+{
+	// Carefully tune pseudorandom seed variation to avoid single node dither
+	// and create larger scale blending patterns similar to horizontal biome
+	// blend.
+	// A local generator is used as biomes of a mapchunk may be calculated
+	// by several threads at once.
+	PcgRandom pr((unsigned int)(pos.Y + (heat + humidity) * 0.9f));
+
+	if (search.closest_blend && search.dist_min_blend <= search.dist_min &&
+			pr.range(0, search.closest_blend->vertical_blend) >=
+			pos.Y - search.closest_blend->max_pos.Y)
+		return search.closest_blend;
+
+	return (search.closest) ? search.closest : biome_none;
+}
+
+
+// For BiomeGen type 'BiomeGenOriginal'
+Biome *BiomeManager::getBiomeFromNoiseOriginal(float heat, float humidity,
+	v3s16 pos) const
+{
+	if (m_lookup && m_lookup->getNumBiomes() == getNumObjects())
+		return m_lookup->get(heat, humidity, pos);
+
+	return getBiomeFromNoiseLinear(heat, humidity, pos);
+}
+
+
+Biome *BiomeManager::getBiomeFromNoiseLinear(float heat, float humidity,
+	v3s16 pos) const
+{
+	BiomeSearch search;
 
 	for (size_t i = 1; i < getNumObjects(); i++) {
 		Biome *b = (Biome *)getRaw(i);
 		if (!b ||
 				pos.Y < b->min_pos.Y || pos.Y > b->max_pos.Y + b->vertical_blend ||
-				pos.X < b->min_pos.X || pos.X > b->max_pos.X ||
-				pos.Z < b->min_pos.Z || pos.Z > b->max_pos.Z)
+				!biomeContainsXZ(b, pos))
 			continue;
 
-		float d_heat = heat - b->heat_point;
-		float d_humidity = humidity - b->humidity_point;
-		float dist = (d_heat * d_heat) + (d_humidity * d_humidity);
+		float dist = biomeDistance(b, heat, humidity);
 
 		if (pos.Y <= b->max_pos.Y) { // Within y limits of biome b
-			if (dist < dist_min) {
-				dist_min = dist;
-				biome_closest = b;
+			if (dist < search.dist_min) {
+				search.dist_min = dist;
+				search.closest = b;
 			}
-		} else if (dist < dist_min_blend) { // Blend area above biome b
-			dist_min_blend = dist;
-			biome_closest_blend = b;
+		} else if (dist < search.dist_min_blend) { // Blend area above biome b
+			search.dist_min_blend = dist;
+			search.closest_blend = b;
+		}
+	}
+
+	return selectBiome(search, heat, humidity, pos, (Biome *)getRaw(BIOME_NONE));
+}
+
+
+void BiomeManager::updateLookup()
+{
+	m_lookup.reset(new BiomeLookup(this));
+
+	infostream << "BiomeManager: " << getNumObjects() - 1 << " biomes in "
+		<< m_lookup->getNumBands() << " Y bands" << std::endl;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+BiomeLookup::BiomeLookup(const BiomeManager *bmgr)
+{
+	m_num_biomes = bmgr->getNumObjects();
+	m_biome_none = (Biome *)bmgr->getRaw(BIOME_NONE);
+
+	std::vector<Biome *> biomes;
+	for (size_t i = 1; i < bmgr->getNumObjects(); i++) {
+		Biome *b = (Biome *)bmgr->getRaw(i);
+		if (b)
+			biomes.push_back(b);
+	}
+
+	// Find the X/Z limits most biomes share, usually the default ones
+	std::map<std::vector<s16>, u32> limits_count;
+	u32 limits_count_max = 0;
+	m_min_x = m_max_x = m_min_z = m_max_z = 0;
+	for (const Biome *b : biomes) {
+		std::vector<s16> limits = {b->min_pos.X, b->max_pos.X,
+			b->min_pos.Z, b->max_pos.Z};
+		u32 count = ++limits_count[limits];
+		if (count > limits_count_max) {
+			limits_count_max = count;
+			m_min_x = limits[0];
+			m_max_x = limits[1];
+			m_min_z = limits[2];
+			m_max_z = limits[3];
 		}
 	}
 
-	mysrand(pos.Y + (heat + humidity) * 0.9f);
-	if (biome_closest_blend && dist_min_blend <= dist_min &&
-			myrand_range(0, biome_closest_blend->vertical_blend) >=
-			pos.Y - biome_closest_blend->max_pos.Y)
-		return biome_closest_blend;
+	// The grid covers all biome points with a wide margin, noise values
+	// outside of it are looked up without the grid
+	float heat_min = 0.0f, heat_max = 0.0f;
+	float humidity_min = 0.0f, humidity_max = 0.0f;
+	for (size_t i = 0; i < biomes.size(); i++) {
+		const Biome *b = biomes[i];
+		if (i == 0 || b->heat_point < heat_min)
+			heat_min = b->heat_point;
+		if (i == 0 || b->heat_point > heat_max)
+			heat_max = b->heat_point;
+		if (i == 0 || b->humidity_point < humidity_min)
+			humidity_min = b->humidity_point;
+		if (i == 0 || b->humidity_point > humidity_max)
+			humidity_max = b->humidity_point;
+	}
+	const float margin = 100.0f;
+	m_heat_min = heat_min - margin;
+	m_humidity_min = humidity_min - margin;
+	m_cell_size = (MYMAX(heat_max - heat_min, humidity_max - humidity_min) +
+		2.0f * margin) / GRID_SIZE;
+
+	// The set of biomes in range only changes at these Y coordinates
+	for (const Biome *b : biomes) {
+		m_band_start.push_back(b->min_pos.Y);
+		m_band_start.push_back((s32)b->max_pos.Y + 1);
+		m_band_start.push_back((s32)b->max_pos.Y + b->vertical_blend + 1);
+	}
+	std::sort(m_band_start.begin(), m_band_start.end());
+	m_band_start.erase(std::unique(m_band_start.begin(), m_band_start.end()),
+		m_band_start.end());
+
+	m_bands.resize(m_band_start.size());
+	for (size_t i = 0; i < m_band_start.size(); i++) {
+		s32 y = m_band_start[i];
+		Band &band = m_bands[i];
+		for (Biome *b : biomes) {
+			if (y < b->min_pos.Y || y > (s32)b->max_pos.Y + b->vertical_blend)
+				continue;
+			if (y <= b->max_pos.Y)
+				band.inside.all.push_back(b);
+			else
+				band.blend.all.push_back(b);
+		}
+		buildGrid(band.inside);
+		buildGrid(band.blend);
+	}
+}
+
+
+bool BiomeLookup::hasCommonLimits(const Biome *b) const
+{
+	return b->min_pos.X == m_min_x && b->max_pos.X == m_max_x &&
+		b->min_pos.Z == m_min_z && b->max_pos.Z == m_max_z;
+}
+
+
+void BiomeLookup::buildGrid(Candidates &candidates) const
+{
+	candidates.cell_start.reserve(GRID_SIZE * GRID_SIZE + 1);
+
+	for (u32 z = 0; z < GRID_SIZE; z++)
+	for (u32 x = 0; x < GRID_SIZE; x++) {
+		double heat0 = m_heat_min + x * m_cell_size;
+		double heat1 = heat0 + m_cell_size;
+		double humidity0 = m_humidity_min + z * m_cell_size;
+		double humidity1 = humidity0 + m_cell_size;
+
+		// Every point of the cell is at most this far from the closest of
+		// the biomes that apply wherever the common limits do
+		double bound = DBL_MAX;
+		for (const Biome *b : candidates.all) {
+			if (!hasCommonLimits(b))
+				continue;
+			double d_heat = MYMAX(std::fabs(b->heat_point - heat0),
+				std::fabs(b->heat_point - heat1));
+			double d_humidity = MYMAX(std::fabs(b->humidity_point - humidity0),
+				std::fabs(b->humidity_point - humidity1));
+			bound = MYMIN(bound, d_heat * d_heat + d_humidity * d_humidity);
+		}
+		// Leave room for float rounding of the distances at lookup
+		if (bound != DBL_MAX)
+			bound = bound * 1.0001 + 0.001;
+
+		// Biomes that are further away from every point of the cell can
+		// neither be closest nor tie with the closest biome
+		candidates.cell_start.push_back(candidates.cell_biomes.size());
+		for (Biome *b : candidates.all) {
+			double d_heat = MYMAX(0.0, MYMAX(heat0 - b->heat_point,
+				b->heat_point - heat1));
+			double d_humidity = MYMAX(0.0, MYMAX(humidity0 - b->humidity_point,
+				b->humidity_point - humidity1));
+			if (!hasCommonLimits(b) ||
+					d_heat * d_heat + d_humidity * d_humidity <= bound)
+				candidates.cell_biomes.push_back(b);
+		}
+	}
+	candidates.cell_start.push_back(candidates.cell_biomes.size());
+}
+
+
+Biome *BiomeLookup::get(float heat, float humidity, v3s16 pos) const
+{
+	BiomeSearch search;
+
+	auto band_it = std::upper_bound(m_band_start.begin(), m_band_start.end(),
+		(s32)pos.Y);
+	if (band_it == m_band_start.begin())
+		return selectBiome(search, heat, humidity, pos, m_biome_none);
+	const Band &band = m_bands[band_it - m_band_start.begin() - 1];
+
+	// The grid only applies where the common X/Z limits include the position
+	float x = (heat - m_heat_min) / m_cell_size;
+	float z = (humidity - m_humidity_min) / m_cell_size;
+	bool use_grid = x >= 0.0f && x < GRID_SIZE && z >= 0.0f && z < GRID_SIZE &&
+		pos.X >= m_min_x && pos.X <= m_max_x &&
+		pos.Z >= m_min_z && pos.Z <= m_max_z;
+	u32 cell = use_grid ? (u32)z * GRID_SIZE + (u32)x : 0;
+
+	// Same comparisons as the linear scan, in the same order
+	auto scan = [&] (const Candidates &candidates, Biome **closest,
+			float *dist_min) {
+		Biome *const *begin = candidates.all.data();
+		Biome *const *end = begin + candidates.all.size();
+		if (use_grid) {
+			begin = candidates.cell_biomes.data() + candidates.cell_start[cell];
+			end = candidates.cell_biomes.data() + candidates.cell_start[cell + 1];
+		}
+		for (Biome *const *it = begin; it != end; ++it) {
+			Biome *b = *it;
+			if (!biomeContainsXZ(b, pos))
+				continue;
+			float dist = biomeDistance(b, heat, humidity);
+			if (dist < *dist_min) {
+				*dist_min = dist;
+				*closest = b;
+			}
+		}
+	};
+	scan(band.inside, &search.closest, &search.dist_min);
+	scan(band.blend, &search.closest_blend, &search.dist_min_blend);
 
-	return (biome_closest) ? biome_closest : (Biome *)getRaw(BIOME_NONE);
+	return selectBiome(search, heat, humidity, pos, m_biome_none);
 }
 
 
@@ -229,10 +463,10 @@ void BiomeGenOriginal::calcBiomeNoise(v3s16 pmin)
 {
 	m_pmin = pmin;
 
-	noise_heat->perlinMap2D(pmin.X, pmin.Z);
-	noise_humidity->perlinMap2D(pmin.X, pmin.Z);
-	noise_heat_blend->perlinMap2D(pmin.X, pmin.Z);
-	noise_humidity_blend->perlinMap2D(pmin.X, pmin.Z);
+	NoiseCache::perlinMap2D(m_noise_cache, noise_heat, pmin.X, pmin.Z);
+	NoiseCache::perlinMap2D(m_noise_cache, noise_humidity, pmin.X, pmin.Z);
+	NoiseCache::perlinMap2D(m_noise_cache, noise_heat_blend, pmin.X, pmin.Z);
+	NoiseCache::perlinMap2D(m_noise_cache, noise_humidity_blend, pmin.X, pmin.Z);
 
 	for (s32 i = 0; i < m_csize.X * m_csize.Z; i++) {
 		noise_heat->result[i]     += noise_heat_blend->result[i];
@@ -277,45 +511,7 @@ Biome *BiomeGenOriginal::getBiomeAtIndex(size_t index, v3s16 pos) const
 
 Biome *BiomeGenOriginal::calcBiomeFromNoise(float heat, float humidity, v3s16 pos) const
 {
-	Biome *biome_closest = nullptr;
-	Biome *biome_closest_blend = nullptr;
-	float dist_min = FLT_MAX;
-	float dist_min_blend = FLT_MAX;
-
-	for (size_t i = 1; i < m_bmgr->getNumObjects(); i++) {
-		Biome *b = (Biome *)m_bmgr->getRaw(i);
-		if (!b ||
-				pos.Y < b->min_pos.Y || pos.Y > b->max_pos.Y + b->vertical_blend ||
-				pos.X < b->min_pos.X || pos.X > b->max_pos.X ||
-				pos.Z < b->min_pos.Z || pos.Z > b->max_pos.Z)
-			continue;
-
-		float d_heat = heat - b->heat_point;
-		float d_humidity = humidity - b->humidity_point;
-		float dist = (d_heat * d_heat) + (d_humidity * d_humidity);
-
-		if (pos.Y <= b->max_pos.Y) { // Within y limits of biome b
-			if (dist < dist_min) {
-				dist_min = dist;
-				biome_closest = b;
-			}
-		} else if (dist < dist_min_blend) { // Blend area above biome b
-			dist_min_blend = dist;
-			biome_closest_blend = b;
-		}
-	}
-
-	// Carefully tune pseudorandom seed variation to avoid single node dither
-	// and create larger scale blending patterns similar to horizontal biome
-	// blend.
-	mysrand(pos.Y + (heat + humidity) * 0.9f);
-
-	if (biome_closest_blend && dist_min_blend <= dist_min &&
-			myrand_range(0, biome_closest_blend->vertical_blend) >=
-			pos.Y - biome_closest_blend->max_pos.Y)
-		return biome_closest_blend;
-
-	return (biome_closest) ? biome_closest : (Biome *)m_bmgr->getRaw(BIOME_NONE);	
+	return m_bmgr->getBiomeFromNoiseOriginal(heat, humidity, pos);
 }
 
 
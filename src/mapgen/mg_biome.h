@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #pragma once
 
+#include <memory>
 #include "objdef.h"
 #include "nodedef.h"
 #include "noise.h"
@@ -27,6 +28,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 class Server;
 class Settings;
 class BiomeManager;
+class NoiseCache;
 
 ////
 //// Biome
@@ -116,11 +118,15 @@ class BiomeGen {
 	// Same as above, but uses a raw numeric index correlating to the (x,z) position.
 	virtual Biome *getBiomeAtIndex(size_t index, v3s16 pos) const = 0;
 
+	// Reuse noise maps of other mapchunks in the same column, optional
+	void setNoiseCache(NoiseCache *cache) { m_noise_cache = cache; }
+
 	// Result of calcBiomes bulk computation.
 	biome_t *biomemap = nullptr;
 
 protected:
 	BiomeManager *m_bmgr = nullptr;
+	NoiseCache *m_noise_cache = nullptr;
 	v3s16 m_pmin;
 	v3s16 m_csize;
 };
@@ -182,6 +188,65 @@ class BiomeGenOriginal : public BiomeGen {
 };
 
 
+////
+//// BiomeLookup
+////
+
+/*
+	Acceleration structure for BiomeManager::getBiomeFromNoiseOriginal.
+	Returns exactly the biome the linear scan over all biomes would.
+
+	The Y axis is split into bands in which the set of biomes in range
+	stays the same. Within a band, a grid over heat and humidity lists the
+	biomes that can be closest to any point of each cell. Biomes whose X/Z
+	limits differ from the common ones are always checked.
+*/
+class BiomeLookup {
+public:
+	BiomeLookup(const BiomeManager *bmgr);
+
+	Biome *get(float heat, float humidity, v3s16 pos) const;
+
+	size_t getNumBiomes() const { return m_num_biomes; }
+	size_t getNumBands() const { return m_bands.size(); }
+
+private:
+	static const u32 GRID_SIZE = 16;
+
+	struct Candidates {
+		// Biomes in range, in the order of their index
+		std::vector<Biome *> all;
+		// Biomes that can be closest within each cell, by cell
+		std::vector<u32> cell_start;
+		std::vector<Biome *> cell_biomes;
+	};
+
+	struct Band {
+		// Biomes within their Y limits
+		Candidates inside;
+		// Biomes in their vertical blend area above the Y limits
+		Candidates blend;
+	};
+
+	void buildGrid(Candidates &candidates) const;
+	bool hasCommonLimits(const Biome *b) const;
+
+	size_t m_num_biomes;
+	Biome *m_biome_none;
+
+	// Lowest Y of each band, ascending
+	std::vector<s32> m_band_start;
+	std::vector<Band> m_bands;
+
+	// X/Z limits shared by most biomes
+	s16 m_min_x, m_max_x, m_min_z, m_max_z;
+
+	// Extent of the heat/humidity grid
+	float m_heat_min, m_humidity_min;
+	float m_cell_size;
+};
+
+
 ////
 //// BiomeManager
 ////
@@ -229,9 +294,16 @@ class BiomeManager : public ObjDefManager {
 		NoiseParams &np_heat_blend, u64 seed);
 	float getHumidityAtPosOriginal(v3s16 pos, NoiseParams &np_humidity,
 		NoiseParams &np_humidity_blend, u64 seed);
-	Biome *getBiomeFromNoiseOriginal(float heat, float humidity, v3s16 pos);
+	Biome *getBiomeFromNoiseOriginal(float heat, float humidity, v3s16 pos) const;
+	// Reference implementation of the above that scans all biomes
+	Biome *getBiomeFromNoiseLinear(float heat, float humidity, v3s16 pos) const;
+
+	// Builds the biome lookup structure. To be called once all biomes are
+	// registered; biomes added later are found by the linear scan.
+	void updateLookup();
 
 private:
 	Server *m_server;
 
+	std::unique_ptr<BiomeLookup> m_lookup;
 };
@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "log.h"
 #include "util/numeric.h"
 #include <algorithm>
+#include <bitset>
 #include <vector>
 
 
@@ -41,6 +42,60 @@ FlagDesc flagdesc_deco[] = {
 };
 
 
+/*
+	State shared by all decorations placed into one mapchunk.
+
+	Surface searches are cached per column. Whenever a decoration is placed,
+	the cache is dropped for every column it may have written to, so each
+	decoration sees exactly the terrain it would see in a separate pass.
+*/
+struct DecoPlacementContext {
+	DecoPlacementContext(Mapgen *mg_, v3s16 nmin_, v3s16 nmax_);
+
+	// Whether the decoration cannot place anything in this chunk
+	bool canSkip(const Decoration *deco) const;
+
+	// Noise values for each part of the division, shared by decorations
+	// with the same noise parameters and part size
+	const float *getNoise(const Decoration *deco, s16 sidelen);
+
+	s16 getGroundLevel(int mapindex, s16 x, s16 z);
+	s16 getLiquidSurface(int mapindex, s16 x, s16 z);
+	void getSurfaces(int mapindex, s16 x, s16 z,
+		const std::vector<s16> **floors_out,
+		const std::vector<s16> **ceilings_out);
+
+	void invalidate(s16 x, s16 z, s16 reach);
+
+	Mapgen *mg;
+	v3s16 nmin;
+	v3s16 nmax;
+	int carea_size;
+
+private:
+	enum {
+		CACHED_GROUND   = 0x01,
+		CACHED_LIQUID   = 0x02,
+		CACHED_SURFACES = 0x04,
+	};
+
+	struct NoiseGroup {
+		NoiseParams np;
+		int mapseed;
+		s16 sidelen;
+		std::vector<float> values;
+	};
+
+	std::vector<u8> column_flags;
+	std::vector<s16> ground_level;
+	std::vector<s16> liquid_surface;
+	std::vector<std::vector<s16>> floors;
+	std::vector<std::vector<s16>> ceilings;
+	std::vector<NoiseGroup> noise_groups;
+	std::bitset<256> present_biomes;
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -54,13 +109,20 @@ size_t DecorationManager::placeAllDecos(Mapgen *mg, u32 blockseed,
 	v3s16 nmin, v3s16 nmax)
 {
 	size_t nplaced = 0;
+	DecoPlacementContext ctx(mg, nmin, nmax);
 
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Decoration *deco = (Decoration *)m_objects[i];
 		if (!deco)
 			continue;
 
-		nplaced += deco->placeDeco(mg, blockseed, nmin, nmax);
+		// Every decoration keeps its own seed, even if it is skipped
+		if (ctx.canSkip(deco)) {
+			blockseed++;
+			continue;
+		}
+
+		nplaced += deco->placeDeco(&ctx, blockseed);
 		blockseed++;
 	}
 
@@ -71,6 +133,136 @@ size_t DecorationManager::placeAllDecos(Mapgen *mg, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
+DecoPlacementContext::DecoPlacementContext(Mapgen *mg_, v3s16 nmin_,
+	v3s16 nmax_) :
+	mg(mg_), nmin(nmin_), nmax(nmax_),
+	carea_size(nmax_.X - nmin_.X + 1)
+{
+	u32 ncolumns = carea_size * carea_size;
+	column_flags.resize(ncolumns, 0);
+
+	if (!mg->biomemap)
+		return;
+
+	u32 nbiomemap = carea_size * (nmax.Z - nmin.Z + 1);
+	for (u32 i = 0; i != nbiomemap; i++)
+		present_biomes.set(mg->biomemap[i]);
+}
+
+
+bool DecoPlacementContext::canSkip(const Decoration *deco) const
+{
+	// All placement positions are limited to the chunk in Y
+	if (deco->y_max < nmin.Y || deco->y_min > nmax.Y)
+		return true;
+
+	if (!mg->biomemap || deco->biomes.empty())
+		return false;
+
+	for (u8 biome : deco->biomes) {
+		if (present_biomes.test(biome))
+			return false;
+	}
+	return true;
+}
+
+
+const float *DecoPlacementContext::getNoise(const Decoration *deco,
+	s16 sidelen)
+{
+	for (const NoiseGroup &group : noise_groups) {
+		if (group.sidelen == sidelen && group.mapseed == deco->mapseed &&
+				group.np == deco->np)
+			return &group.values[0];
+	}
+
+	s16 divlen = carea_size / sidelen;
+	noise_groups.emplace_back();
+	NoiseGroup &group = noise_groups.back();
+	group.np = deco->np;
+	group.mapseed = deco->mapseed;
+	group.sidelen = sidelen;
+	group.values.reserve(divlen * divlen);
+
+	for (s16 z0 = 0; z0 < divlen; z0++)
+	for (s16 x0 = 0; x0 < divlen; x0++) {
+		group.values.push_back(NoisePerlin2D(&group.np,
+			nmin.X + sidelen / 2 + sidelen * x0,
+			nmin.Z + sidelen / 2 + sidelen * z0, group.mapseed));
+	}
+
+	return &group.values[0];
+}
+
+
+s16 DecoPlacementContext::getGroundLevel(int mapindex, s16 x, s16 z)
+{
+	if (ground_level.empty())
+		ground_level.resize(column_flags.size());
+
+	if (!(column_flags[mapindex] & CACHED_GROUND)) {
+		ground_level[mapindex] =
+			mg->findGroundLevel(v2s16(x, z), nmin.Y, nmax.Y);
+		column_flags[mapindex] |= CACHED_GROUND;
+	}
+	return ground_level[mapindex];
+}
+
+
+s16 DecoPlacementContext::getLiquidSurface(int mapindex, s16 x, s16 z)
+{
+	if (liquid_surface.empty())
+		liquid_surface.resize(column_flags.size());
+
+	if (!(column_flags[mapindex] & CACHED_LIQUID)) {
+		liquid_surface[mapindex] =
+			mg->findLiquidSurface(v2s16(x, z), nmin.Y, nmax.Y);
+		column_flags[mapindex] |= CACHED_LIQUID;
+	}
+	return liquid_surface[mapindex];
+}
+
+
+void DecoPlacementContext::getSurfaces(int mapindex, s16 x, s16 z,
+	const std::vector<s16> **floors_out, const std::vector<s16> **ceilings_out)
+{
+	if (floors.empty()) {
+		floors.resize(column_flags.size());
+		ceilings.resize(column_flags.size());
+	}
+
+	std::vector<s16> &col_floors = floors[mapindex];
+	std::vector<s16> &col_ceilings = ceilings[mapindex];
+	if (!(column_flags[mapindex] & CACHED_SURFACES)) {
+		col_floors.clear();
+		col_ceilings.clear();
+		mg->getSurfaces(v2s16(x, z), nmin.Y, nmax.Y, col_floors, col_ceilings);
+		column_flags[mapindex] |= CACHED_SURFACES;
+	}
+
+	*floors_out = &col_floors;
+	*ceilings_out = &col_ceilings;
+}
+
+
+void DecoPlacementContext::invalidate(s16 x, s16 z, s16 reach)
+{
+	s16 x_min = MYMAX(x - reach, nmin.X);
+	s16 x_max = MYMIN(x + reach, nmin.X + carea_size - 1);
+	s16 z_min = MYMAX(z - reach, nmin.Z);
+	s16 z_max = MYMIN(z + reach, nmin.Z + carea_size - 1);
+
+	for (s16 cz = z_min; cz <= z_max; cz++) {
+		u32 i = carea_size * (cz - nmin.Z) + (x_min - nmin.X);
+		for (s16 cx = x_min; cx <= x_max; cx++, i++)
+			column_flags[i] = 0;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+
 void Decoration::resolveNodeNames()
 {
 	getIdsFromNrBacklog(&c_place_on);
@@ -127,39 +319,38 @@ bool Decoration::canPlaceDecoration(MMVManip *vm, v3s16 p)
 }
 
 
-size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+size_t Decoration::placeDeco(DecoPlacementContext *ctx, u32 blockseed)
 {
+	Mapgen *mg = ctx->mg;
+	const v3s16 &nmin = ctx->nmin;
+	const v3s16 &nmax = ctx->nmax;
 	PcgRandom ps(blockseed + 53);
-	int carea_size = nmax.X - nmin.X + 1;
+	int carea_size = ctx->carea_size;
 
 	// Divide area into parts
 	// If chunksize is changed it may no longer be divisable by sidelen
-	if (carea_size % sidelen)
-		sidelen = carea_size;
+	s16 part_len = (carea_size % sidelen) ? carea_size : sidelen;
 
-	s16 divlen = carea_size / sidelen;
-	int area = sidelen * sidelen;
+	s16 divlen = carea_size / part_len;
+	int area = part_len * part_len;
+	const float *noise = (flags & DECO_USE_NOISE) ?
+		ctx->getNoise(this, part_len) : nullptr;
+	s16 reach = getHorizontalReach();
 
 	for (s16 z0 = 0; z0 < divlen; z0++)
 	for (s16 x0 = 0; x0 < divlen; x0++) {
-		v2s16 p2d_center( // Center position of part of division
-			nmin.X + sidelen / 2 + sidelen * x0,
-			nmin.Z + sidelen / 2 + sidelen * z0
-		);
 		v2s16 p2d_min( // Minimum edge of part of division
-			nmin.X + sidelen * x0,
-			nmin.Z + sidelen * z0
+			nmin.X + part_len * x0,
+			nmin.Z + part_len * z0
 		);
 		v2s16 p2d_max( // Maximum edge of part of division
-			nmin.X + sidelen + sidelen * x0 - 1,
-			nmin.Z + sidelen + sidelen * z0 - 1
+			nmin.X + part_len + part_len * x0 - 1,
+			nmin.Z + part_len + part_len * z0 - 1
 		);
 
 		bool cover = false;
 		// Amount of decorations
-		float nval = (flags & DECO_USE_NOISE) ?
-			NoisePerlin2D(&np, p2d_center.X, p2d_center.Y, mapseed) :
-			fill_ratio;
+		float nval = noise ? noise[z0 * divlen + x0] : fill_ratio;
 		u32 deco_count = 0;
 
 		if (nval >= 10.0f) {
@@ -206,13 +397,12 @@ size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 				}
 
 				// Get all floors and ceilings in node column
-				u16 size = (nmax.Y - nmin.Y + 1) / 2;
-				std::vector<s16> floors;
-				std::vector<s16> ceilings;
-				floors.reserve(size);
-				ceilings.reserve(size);
-
-				mg->getSurfaces(v2s16(x, z), nmin.Y, nmax.Y, floors, ceilings);
+				// Placing invalidates the cached surfaces, so copy them
+				const std::vector<s16> *cached_floors;
+				const std::vector<s16> *cached_ceilings;
+				ctx->getSurfaces(mapindex, x, z, &cached_floors, &cached_ceilings);
+				std::vector<s16> floors = *cached_floors;
+				std::vector<s16> ceilings = *cached_ceilings;
 
 				if (flags & DECO_ALL_FLOORS) {
 					// Floor decorations
@@ -221,9 +411,11 @@ size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 							continue;
 
 						v3s16 pos(x, y, z);
-						if (generate(mg->vm, &ps, pos, false))
+						if (generate(mg->vm, &ps, pos, false)) {
 							mg->gennotify.addEvent(
 									GENNOTIFY_DECORATION, pos, index);
+							ctx->invalidate(x, z, reach);
+						}
 					}
 				}
 
@@ -234,19 +426,21 @@ size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 							continue;
 
 						v3s16 pos(x, y, z);
-						if (generate(mg->vm, &ps, pos, true))
+						if (generate(mg->vm, &ps, pos, true)) {
 							mg->gennotify.addEvent(
 									GENNOTIFY_DECORATION, pos, index);
+							ctx->invalidate(x, z, reach);
+						}
 					}
 				}
 			} else { // Heightmap decorations
 				s16 y = -MAX_MAP_GENERATION_LIMIT;
 				if (flags & DECO_LIQUID_SURFACE)
-					y = mg->findLiquidSurface(v2s16(x, z), nmin.Y, nmax.Y);
+					y = ctx->getLiquidSurface(mapindex, x, z);
 				else if (mg->heightmap)
 					y = mg->heightmap[mapindex];
 				else
-					y = mg->findGroundLevel(v2s16(x, z), nmin.Y, nmax.Y);
+					y = ctx->getGroundLevel(mapindex, x, z);
 
 				if (y < y_min || y > y_max || y < nmin.Y || y > nmax.Y)
 					continue;
@@ -259,8 +453,10 @@ size_t Decoration::placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 				}
 
 				v3s16 pos(x, y, z);
-				if (generate(mg->vm, &ps, pos, false))
+				if (generate(mg->vm, &ps, pos, false)) {
 					mg->gennotify.addEvent(GENNOTIFY_DECORATION, pos, index);
+					ctx->invalidate(x, z, reach);
+				}
 			}
 		}
 	}
@@ -402,3 +598,13 @@ size_t DecoSchematic::generate(MMVManip *vm, PcgRandom *pr, v3s16 p, bool ceilin
 
 	return 1;
 }
+
+
+s16 DecoSchematic::getHorizontalReach() const
+{
+	if (schematic == NULL)
+		return 0;
+
+	// Covers any rotation and centering
+	return MYMAX(schematic->size.X, schematic->size.Z);
+}
@@ -29,6 +29,7 @@ class Mapgen;
 class MMVManip;
 class PcgRandom;
 class Schematic;
+struct DecoPlacementContext;
 
 enum DecorationType {
 	DECO_SIMPLE,
@@ -56,10 +57,14 @@ class Decoration : public ObjDef, public NodeResolver {
 	virtual void resolveNodeNames();
 
 	bool canPlaceDecoration(MMVManip *vm, v3s16 p);
-	size_t placeDeco(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
+	size_t placeDeco(DecoPlacementContext *ctx, u32 blockseed);
 
 	virtual size_t generate(MMVManip *vm, PcgRandom *pr, v3s16 p, bool ceiling) = 0;
 
+	// Maximum horizontal distance from the placement position that
+	// generate() may write nodes to
+	virtual s16 getHorizontalReach() const { return 0; }
+
 	u32 flags = 0;
 	int mapseed = 0;
 	std::vector<content_t> c_place_on;
@@ -94,6 +99,7 @@ class DecoSchematic : public Decoration {
 	DecoSchematic() = default;
 
 	virtual size_t generate(MMVManip *vm, PcgRandom *pr, v3s16 p, bool ceiling);
+	virtual s16 getHorizontalReach() const;
 
 	Rotation rotation;
 	Schematic *schematic = nullptr;
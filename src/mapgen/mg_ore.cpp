@@ -26,6 +26,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/numeric.h"
 #include <cmath>
 #include <algorithm>
+#include <bitset>
+#include <map>
+#include <memory>
 
 
 FlagDesc flagdesc_ore[] = {
@@ -36,6 +39,220 @@ FlagDesc flagdesc_ore[] = {
 };
 
 
+/*
+	Noise objects of ores. Every emerge thread generates a different mapchunk
+	at the same time, so these are kept per thread and reused for all the
+	chunks it generates.
+*/
+class OreNoiseCache {
+public:
+	Noise *get(const Ore *ore, int slot, const NoiseParams &np, s32 seed,
+		u32 sx, u32 sy, u32 sz = 1)
+	{
+		std::unique_ptr<Noise> &noise = m_noises[std::make_pair(ore, slot)];
+		if (!noise || !(noise->np == np) ||
+				noise->sx != sx || noise->sy != sy || noise->sz != sz) {
+			NoiseParams params = np;
+			noise.reset(new Noise(&params, seed, sx, sy, sz));
+		}
+		noise->seed = seed;
+		return noise.get();
+	}
+
+private:
+	std::map<std::pair<const Ore *, int>, std::unique_ptr<Noise>> m_noises;
+};
+
+static thread_local OreNoiseCache g_ore_noise_cache;
+
+
+/*
+	State shared by all ores placed into one mapchunk.
+
+	Ores with the same c_wherein share a lookup table for it, and the number
+	of matching nodes in every mapblock of the chunk. The counts are updated
+	whenever an ore replaces a node, so ores can skip regions where nothing
+	could be replaced without changing the result.
+*/
+struct OrePlacementContext {
+	OrePlacementContext(Mapgen *mg_, v3s16 nmin_, v3s16 nmax_);
+
+	// Whether the ore cannot place anything in this chunk
+	bool canSkip(const Ore *ore, v3s16 pmin, v3s16 pmax);
+
+	// Selects the c_wherein of the ore for the functions below
+	void setOre(const Ore *ore);
+
+	inline bool isWherein(content_t c) const
+	{
+		return c < m_wherein->lookup.size() && m_wherein->lookup[c];
+	}
+
+	// Whether any node of the area may be replaced
+	bool mayContainWherein(v3s16 pmin, v3s16 pmax);
+
+	// Whether any node of the mapblock containing p may be replaced
+	inline bool blockMayContainWherein(s16 x, s16 y, s16 z) const
+	{
+		return m_wherein->counts[blockIndex(x, y, z)] != 0;
+	}
+
+	void placeNode(u32 vi, s16 x, s16 y, s16 z, const MapNode &n);
+
+	Noise *getNoise(const Ore *ore, int slot, const NoiseParams &np,
+		s32 seed, u32 sx, u32 sy, u32 sz = 1)
+	{
+		return g_ore_noise_cache.get(ore, slot, np, seed, sx, sy, sz);
+	}
+
+	Mapgen *mg;
+	MMVManip *vm;
+	v3s16 nmin;
+	v3s16 nmax;
+
+private:
+	struct WhereinGroup {
+		std::vector<content_t> contents;
+		std::vector<bool> lookup;
+		// Matching nodes per mapblock, only inside of nmin..nmax
+		std::vector<u32> counts;
+	};
+
+	inline u32 blockIndex(s16 x, s16 y, s16 z) const
+	{
+		return ((getContainerPos(z, MAP_BLOCKSIZE) - m_bmin.Z) * m_bsize.Y +
+			(getContainerPos(y, MAP_BLOCKSIZE) - m_bmin.Y)) * m_bsize.X +
+			(getContainerPos(x, MAP_BLOCKSIZE) - m_bmin.X);
+	}
+
+	std::vector<std::unique_ptr<WhereinGroup>> m_groups;
+	WhereinGroup *m_wherein = nullptr;
+	v3s16 m_bmin;
+	v3s16 m_bsize;
+	std::bitset<256> m_present_biomes;
+};
+
+
+OrePlacementContext::OrePlacementContext(Mapgen *mg_, v3s16 nmin_,
+	v3s16 nmax_) :
+	mg(mg_), vm(mg_->vm), nmin(nmin_), nmax(nmax_)
+{
+	m_bmin = getContainerPos(nmin, MAP_BLOCKSIZE);
+	m_bsize = getContainerPos(nmax, MAP_BLOCKSIZE) - m_bmin + v3s16(1, 1, 1);
+
+	if (!mg->biomemap)
+		return;
+
+	u32 nbiomemap = (nmax.X - nmin.X + 1) * (nmax.Z - nmin.Z + 1);
+	for (u32 i = 0; i != nbiomemap; i++)
+		m_present_biomes.set(mg->biomemap[i]);
+}
+
+
+bool OrePlacementContext::canSkip(const Ore *ore, v3s16 pmin, v3s16 pmax)
+{
+	if (mg->biomemap && !ore->biomes.empty()) {
+		bool biome_found = false;
+		for (u8 biome : ore->biomes) {
+			if (m_present_biomes.test(biome)) {
+				biome_found = true;
+				break;
+			}
+		}
+		if (!biome_found)
+			return true;
+	}
+
+	if (ore->canPlaceOutside())
+		return false;
+
+	setOre(ore);
+	return !mayContainWherein(pmin, pmax);
+}
+
+
+void OrePlacementContext::setOre(const Ore *ore)
+{
+	std::vector<content_t> contents = ore->c_wherein;
+	std::sort(contents.begin(), contents.end());
+	contents.erase(std::unique(contents.begin(), contents.end()),
+		contents.end());
+
+	for (const std::unique_ptr<WhereinGroup> &group : m_groups) {
+		if (group->contents == contents) {
+			m_wherein = group.get();
+			return;
+		}
+	}
+
+	// New c_wherein: build its lookup table and count matching nodes
+	WhereinGroup *group = new WhereinGroup;
+	m_groups.emplace_back(group);
+	m_wherein = group;
+
+	group->contents = contents;
+	if (!contents.empty())
+		group->lookup.resize(contents.back() + 1, false);
+	for (content_t c : contents)
+		group->lookup[c] = true;
+
+	group->counts.resize(m_bsize.X * m_bsize.Y * m_bsize.Z, 0);
+	for (s16 z = nmin.Z; z <= nmax.Z; z++)
+	for (s16 y = nmin.Y; y <= nmax.Y; y++) {
+		u32 vi = vm->m_area.index(nmin.X, y, z);
+		for (s16 x = nmin.X; x <= nmax.X; x++, vi++) {
+			if (isWherein(vm->m_data[vi].getContent()))
+				group->counts[blockIndex(x, y, z)]++;
+		}
+	}
+}
+
+
+bool OrePlacementContext::mayContainWherein(v3s16 pmin, v3s16 pmax)
+{
+	pmin.X = MYMAX(pmin.X, nmin.X);
+	pmin.Y = MYMAX(pmin.Y, nmin.Y);
+	pmin.Z = MYMAX(pmin.Z, nmin.Z);
+	pmax.X = MYMIN(pmax.X, nmax.X);
+	pmax.Y = MYMIN(pmax.Y, nmax.Y);
+	pmax.Z = MYMIN(pmax.Z, nmax.Z);
+
+	v3s16 bpmin = getContainerPos(pmin, MAP_BLOCKSIZE);
+	v3s16 bpmax = getContainerPos(pmax, MAP_BLOCKSIZE);
+	for (s16 z = bpmin.Z; z <= bpmax.Z; z++)
+	for (s16 y = bpmin.Y; y <= bpmax.Y; y++)
+	for (s16 x = bpmin.X; x <= bpmax.X; x++) {
+		u32 i = ((z - m_bmin.Z) * m_bsize.Y + (y - m_bmin.Y)) * m_bsize.X +
+			(x - m_bmin.X);
+		if (m_wherein->counts[i] != 0)
+			return true;
+	}
+	return false;
+}
+
+
+void OrePlacementContext::placeNode(u32 vi, s16 x, s16 y, s16 z,
+	const MapNode &n)
+{
+	content_t c_old = vm->m_data[vi].getContent();
+	content_t c_new = n.getContent();
+	vm->m_data[vi] = n;
+
+	if (c_old == c_new || x < nmin.X || x > nmax.X || y < nmin.Y ||
+			y > nmax.Y || z < nmin.Z || z > nmax.Z)
+		return;
+
+	u32 bi = blockIndex(x, y, z);
+	for (const std::unique_ptr<WhereinGroup> &group : m_groups) {
+		const std::vector<bool> &lookup = group->lookup;
+		if (c_old < lookup.size() && lookup[c_old])
+			group->counts[bi]--;
+		if (c_new < lookup.size() && lookup[c_new])
+			group->counts[bi]++;
+	}
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -48,13 +265,14 @@ OreManager::OreManager(IGameDef *gamedef) :
 size_t OreManager::placeAllOres(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 {
 	size_t nplaced = 0;
+	OrePlacementContext ctx(mg, nmin, nmax);
 
 	for (size_t i = 0; i != m_objects.size(); i++) {
 		Ore *ore = (Ore *)m_objects[i];
 		if (!ore)
 			continue;
 
-		nplaced += ore->placeOre(mg, blockseed, nmin, nmax);
+		nplaced += ore->placeOre(&ctx, blockseed);
 		blockseed++;
 	}
 
@@ -75,12 +293,6 @@ void OreManager::clear()
 ///////////////////////////////////////////////////////////////////////////////
 
 
-Ore::~Ore()
-{
-	delete noise;
-}
-
-
 void Ore::resolveNodeNames()
 {
 	getIdFromNrBacklog(&c_ore, "", CONTENT_AIR);
@@ -88,8 +300,10 @@ void Ore::resolveNodeNames()
 }
 
 
-size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
+size_t Ore::placeOre(OrePlacementContext *ctx, u32 blockseed)
 {
+	v3s16 nmin = ctx->nmin;
+	v3s16 nmax = ctx->nmax;
 	if (nmin.Y > y_max || nmax.Y < y_min)
 		return 0;
 
@@ -100,7 +314,11 @@ size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 
 	nmin.Y = actual_ymin;
 	nmax.Y = actual_ymax;
-	generate(mg->vm, mg->seed, blockseed, nmin, nmax, mg->biomemap);
+	if (ctx->canSkip(this, nmin, nmax))
+		return 0;
+
+	ctx->setOre(this);
+	generate(ctx, ctx->mg->seed, blockseed, nmin, nmax, ctx->mg->biomemap);
 
 	return 1;
 }
@@ -109,9 +327,10 @@ size_t Ore::placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax)
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OreScatter::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
@@ -139,17 +358,22 @@ void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
 				continue;
 		}
 
+		// The random numbers are still drawn for clusters that are entirely
+		// in air, so that the following clusters stay the same
+		bool may_place = ctx->mayContainWherein(v3s16(x0, y0, z0),
+			v3s16(x0 + csize - 1, y0 + csize - 1, z0 + csize - 1));
+
 		for (u32 z1 = 0; z1 != csize; z1++)
 		for (u32 y1 = 0; y1 != csize; y1++)
 		for (u32 x1 = 0; x1 != csize; x1++) {
-			if (pr.range(1, cvolume) > clust_num_ores)
+			if (pr.range(1, cvolume) > clust_num_ores || !may_place)
 				continue;
 
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!ctx->isWherein(vm->m_data[i].getContent()))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			ctx->placeNode(i, x0 + x1, y0 + y1, z0 + z1, n_ore);
 		}
 	}
 }
@@ -158,9 +382,10 @@ void OreScatter::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OreSheet::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed + 4234);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
@@ -172,12 +397,9 @@ void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		pr.range(y_start_min, y_start_max) :
 		(y_start_min + y_start_max) / 2;
 
-	if (!noise) {
-		int sx = nmax.X - nmin.X + 1;
-		int sz = nmax.Z - nmin.Z + 1;
-		noise = new Noise(&np, 0, sx, sz);
-	}
-	noise->seed = mapseed + y_start;
+	int sx = nmax.X - nmin.X + 1;
+	int sz = nmax.Z - nmin.Z + 1;
+	Noise *noise = ctx->getNoise(this, 0, np, mapseed + y_start, sx, sz);
 	noise->perlinMap2D(nmin.X, nmin.Z);
 
 	size_t index = 0;
@@ -202,10 +424,10 @@ void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!ctx->isWherein(vm->m_data[i].getContent()))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			ctx->placeNode(i, x, y, z, n_ore);
 		}
 	}
 }
@@ -214,30 +436,21 @@ void OreSheet::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-OrePuff::~OrePuff()
-{
-	delete noise_puff_top;
-	delete noise_puff_bottom;
-}
-
-
-void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OrePuff::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed + 4234);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
 	int y_start = pr.range(nmin.Y, nmax.Y);
 
-	if (!noise) {
-		int sx = nmax.X - nmin.X + 1;
-		int sz = nmax.Z - nmin.Z + 1;
-		noise = new Noise(&np, 0, sx, sz);
-		noise_puff_top = new Noise(&np_puff_top, 0, sx, sz);
-		noise_puff_bottom = new Noise(&np_puff_bottom, 0, sx, sz);
-	}
+	int sx = nmax.X - nmin.X + 1;
+	int sz = nmax.Z - nmin.Z + 1;
+	Noise *noise = ctx->getNoise(this, 0, np, mapseed + y_start, sx, sz);
+	Noise *noise_puff_top = nullptr;
+	Noise *noise_puff_bottom = nullptr;
 
-	noise->seed = mapseed + y_start;
 	noise->perlinMap2D(nmin.X, nmin.Z);
 	bool noise_generated = false;
 
@@ -256,6 +469,8 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 
 		if (!noise_generated) {
 			noise_generated = true;
+			noise_puff_top = ctx->getNoise(this, 1, np_puff_top, 0, sx, sz);
+			noise_puff_bottom = ctx->getNoise(this, 2, np_puff_bottom, 0, sx, sz);
 			noise_puff_top->perlinMap2D(nmin.X, nmin.Z);
 			noise_puff_bottom->perlinMap2D(nmin.X, nmin.Z);
 		}
@@ -282,10 +497,10 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!ctx->isWherein(vm->m_data[i].getContent()))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			ctx->placeNode(i, x, y, z, n_ore);
 		}
 	}
 }
@@ -294,9 +509,10 @@ void OrePuff::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OreBlob::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed + 2404);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
@@ -307,8 +523,7 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 	u32 csize  = clust_size;
 	u32 nblobs = volume / clust_scarcity;
 
-	if (!noise)
-		noise = new Noise(&np, mapseed, csize, csize, csize);
+	Noise *noise = ctx->getNoise(this, 0, np, mapseed, csize, csize, csize);
 
 	for (u32 i = 0; i != nblobs; i++) {
 		int x0 = pr.range(nmin.X, nmax.X - csize + 1);
@@ -322,6 +537,11 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 				continue;
 		}
 
+		// No random numbers are drawn below, blobs in air can be skipped
+		if (!ctx->mayContainWherein(v3s16(x0, y0, z0),
+				v3s16(x0 + csize - 1, y0 + csize - 1, z0 + csize - 1)))
+			continue;
+
 		bool noise_generated = false;
 		noise->seed = blockseed + i;
 
@@ -330,7 +550,7 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		for (u32 y1 = 0; y1 != csize; y1++)
 		for (u32 x1 = 0; x1 != csize; x1++, index++) {
 			u32 i = vm->m_area.index(x0 + x1, y0 + y1, z0 + z1);
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!ctx->isWherein(vm->m_data[i].getContent()))
 				continue;
 
 			// Lazily generate noise only if there's a chance of ore being placed
@@ -351,7 +571,7 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			if (noiseval < nthresh)
 				continue;
 
-			vm->m_data[i] = n_ore;
+			ctx->placeNode(i, x0 + x1, y0 + y1, z0 + z1, n_ore);
 		}
 	}
 }
@@ -360,43 +580,41 @@ void OreBlob::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-OreVein::~OreVein()
-{
-	delete noise2;
-}
-
-
-void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OreVein::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed + 520);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
+	// Because this ore uses 3D noise the perlinmap Y size can be different in
+	// different mapchunks due to ore Y limits, the cached noise objects are
+	// recreated if the size has changed.
 	int sizex = nmax.X - nmin.X + 1;
 	int sizey = nmax.Y - nmin.Y + 1;
-	// Because this ore uses 3D noise the perlinmap Y size can be different in
-	// different mapchunks due to ore Y limits. So recreate the noise objects
-	// if Y size has changed.
-	// Because these noise objects are created multiple times for this ore type
-	// it is necessary to 'delete' them here.
-	if (!noise || sizey != sizey_prev) {
-		delete noise;
-		delete noise2;
-		int sizez = nmax.Z - nmin.Z + 1;
-		noise  = new Noise(&np, mapseed, sizex, sizey, sizez);
-		noise2 = new Noise(&np, mapseed + 436, sizex, sizey, sizez);
-		sizey_prev = sizey;
-	}
+	int sizez = nmax.Z - nmin.Z + 1;
+	Noise *noise  = ctx->getNoise(this, 0, np, mapseed, sizex, sizey, sizez);
+	Noise *noise2 = ctx->getNoise(this, 1, np, mapseed + 436, sizex, sizey, sizez);
 
 	bool noise_generated = false;
 	size_t index = 0;
 	for (int z = nmin.Z; z <= nmax.Z; z++)
 	for (int y = nmin.Y; y <= nmax.Y; y++)
 	for (int x = nmin.X; x <= nmax.X; x++, index++) {
+		// Skip the rest of the row within mapblocks without replaceable nodes
+		if (!ctx->blockMayContainWherein(x, y, z)) {
+			s16 skip = MYMIN(nmax.X - x,
+				MAP_BLOCKSIZE - 1 - (x - getContainerPos(x, MAP_BLOCKSIZE) *
+				MAP_BLOCKSIZE));
+			x += skip;
+			index += skip;
+			continue;
+		}
+
 		u32 i = vm->m_area.index(x, y, z);
 		if (!vm->m_area.contains(i))
 			continue;
-		if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+		if (!ctx->isWherein(vm->m_data[i].getContent()))
 			continue;
 
 		if (biomemap && !biomes.empty()) {
@@ -420,7 +638,7 @@ void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
 		if (noiseval * noiseval2 + randval * random_factor < nthresh)
 			continue;
 
-		vm->m_data[i] = n_ore;
+		ctx->placeNode(i, x, y, z, n_ore);
 	}
 }
 
@@ -428,33 +646,26 @@ void OreVein::generate(MMVManip *vm, int mapseed, u32 blockseed,
 ///////////////////////////////////////////////////////////////////////////////
 
 
-OreStratum::~OreStratum()
-{
-	delete noise_stratum_thickness;
-}
-
-
-void OreStratum::generate(MMVManip *vm, int mapseed, u32 blockseed,
+void OreStratum::generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 	v3s16 nmin, v3s16 nmax, u8 *biomemap)
 {
+	MMVManip *vm = ctx->vm;
 	PcgRandom pr(blockseed + 4234);
 	MapNode n_ore(c_ore, 0, ore_param2);
 
+	int sx = nmax.X - nmin.X + 1;
+	int sz = nmax.Z - nmin.Z + 1;
+	Noise *noise = nullptr;
+	Noise *noise_stratum_thickness = nullptr;
+
 	if (flags & OREFLAG_USE_NOISE) {
-		if (!noise) {
-			int sx = nmax.X - nmin.X + 1;
-			int sz = nmax.Z - nmin.Z + 1;
-			noise = new Noise(&np, 0, sx, sz);
-		}
+		noise = ctx->getNoise(this, 0, np, 0, sx, sz);
 		noise->perlinMap2D(nmin.X, nmin.Z);
 	}
 
 	if (flags & OREFLAG_USE_NOISE2) {
-		if (!noise_stratum_thickness) {
-			int sx = nmax.X - nmin.X + 1;
-			int sz = nmax.Z - nmin.Z + 1;
-			noise_stratum_thickness = new Noise(&np_stratum_thickness, 0, sx, sz);
-		}
+		noise_stratum_thickness = ctx->getNoise(this, 1,
+			np_stratum_thickness, 0, sx, sz);
 		noise_stratum_thickness->perlinMap2D(nmin.X, nmin.Z);
 	}
 
@@ -490,10 +701,10 @@ void OreStratum::generate(MMVManip *vm, int mapseed, u32 blockseed,
 			u32 i = vm->m_area.index(x, y, z);
 			if (!vm->m_area.contains(i))
 				continue;
-			if (!CONTAINS(c_wherein, vm->m_data[i].getContent()))
+			if (!ctx->isWherein(vm->m_data[i].getContent()))
 				continue;
 
-			vm->m_data[i] = n_ore;
+			ctx->placeNode(i, x, y, z, n_ore);
 		}
 	}
 }
@@ -28,6 +28,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 class Noise;
 class Mapgen;
 class MMVManip;
+struct OrePlacementContext;
 
 /////////////////// Ore generation flags
 
@@ -63,16 +64,19 @@ class Ore : public ObjDef, public NodeResolver {
 	u32 flags = 0;          // attributes for this ore
 	float nthresh;      // threshold for noise at which an ore is placed
 	NoiseParams np;     // noise for distribution of clusters (NULL for uniform scattering)
-	Noise *noise = nullptr;
 	std::unordered_set<u8> biomes;
 
-	Ore() = default;;
-	virtual ~Ore();
+	Ore() = default;
+	virtual ~Ore() = default;
 
 	virtual void resolveNodeNames();
 
-	size_t placeOre(Mapgen *mg, u32 blockseed, v3s16 nmin, v3s16 nmax);
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	size_t placeOre(OrePlacementContext *ctx, u32 blockseed);
+
+	// Whether the ore may place nodes outside of the given area
+	virtual bool canPlaceOutside() const { return false; }
+
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap) = 0;
 };
 
@@ -80,7 +84,7 @@ class OreScatter : public Ore {
 public:
 	static const bool NEEDS_NOISE = false;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
@@ -92,7 +96,7 @@ class OreSheet : public Ore {
 	u16 column_height_max;
 	float column_midpoint_factor;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
@@ -102,13 +106,12 @@ class OrePuff : public Ore {
 
 	NoiseParams np_puff_top;
 	NoiseParams np_puff_bottom;
-	Noise *noise_puff_top = nullptr;
-	Noise *noise_puff_bottom = nullptr;
 
 	OrePuff() = default;
-	virtual ~OrePuff();
+	virtual ~OrePuff() = default;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual bool canPlaceOutside() const { return true; }
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
@@ -116,7 +119,7 @@ class OreBlob : public Ore {
 public:
 	static const bool NEEDS_NOISE = true;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
@@ -125,13 +128,11 @@ class OreVein : public Ore {
 	static const bool NEEDS_NOISE = true;
 
 	float random_factor;
-	Noise *noise2 = nullptr;
-	int sizey_prev = 0;
 
 	OreVein() = default;
-	virtual ~OreVein();
+	virtual ~OreVein() = default;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
@@ -140,13 +141,12 @@ class OreStratum : public Ore {
 	static const bool NEEDS_NOISE = false;
 
 	NoiseParams np_stratum_thickness;
-	Noise *noise_stratum_thickness = nullptr;
 	u16 stratum_thickness;
 
 	OreStratum() = default;
-	virtual ~OreStratum();
+	virtual ~OreStratum() = default;
 
-	virtual void generate(MMVManip *vm, int mapseed, u32 blockseed,
+	virtual void generate(OrePlacementContext *ctx, int mapseed, u32 blockseed,
 		v3s16 nmin, v3s16 nmax, u8 *biomemap);
 };
 
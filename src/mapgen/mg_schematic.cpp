@@ -18,9 +18,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <algorithm>
 #include <fstream>
 #include <typeinfo>
 #include "mg_schematic.h"
+#include "placement_batch.h"
 #include "server.h"
 #include "mapgen.h"
 #include "emerge.h"
@@ -31,7 +33,6 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/serialize.h"
 #include "serialization.h"
 #include "filesys.h"
-#include "voxelalgorithms.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -88,22 +89,22 @@ void Schematic::resolveNodeNames()
 		content_t c_new = c_nodes[c_original];
 		schemdata[i].setContent(c_new);
 	}
+
+	compile();
 }
 
 
-void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+// Returns the index of the first node and the index steps along the
+// rotated X and Z axes, and swaps sx and sz if the rotation requires it
+static void get_rotation_steps(v3s16 size, Rotation rot, s16 &sx, s16 &sz,
+	int &i_start, int &i_step_x, int &i_step_z)
 {
-	sanity_check(m_ndef != NULL);
-
 	int xstride = 1;
-	int ystride = size.X;
 	int zstride = size.X * size.Y;
 
-	s16 sx = size.X;
-	s16 sy = size.Y;
-	s16 sz = size.Z;
+	sx = size.X;
+	sz = size.Z;
 
-	int i_start, i_step_x, i_step_z;
 	switch (rot) {
 		case ROTATE_90:
 			i_start  = sx - 1;
@@ -127,6 +128,147 @@ void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_pla
 			i_step_x = xstride;
 			i_step_z = zstride;
 	}
+}
+
+
+void Schematic::compile()
+{
+	m_compiled.clear();
+	if (!schemdata || !slice_probs || !m_ndef)
+		return;
+
+	int ystride = size.X;
+
+	m_compiled.resize(ROTATE_270 + 1);
+	for (int r = ROTATE_0; r <= ROTATE_270; r++) {
+		Rotation rot = (Rotation)r;
+		CompiledRotation &cr = m_compiled[r];
+
+		s16 sx, sz;
+		int i_start, i_step_x, i_step_z;
+		get_rotation_steps(size, rot, sx, sz, i_start, i_step_x, i_step_z);
+		cr.size = v3s16(sx, size.Y, sz);
+		cr.slice_runs.reserve(size.Y + 1);
+
+		for (s16 y = 0; y != size.Y; y++) {
+			cr.slice_runs.push_back(cr.runs.size());
+
+			for (s16 z = 0; z != sz; z++) {
+				u32 i = z * i_step_z + y * ystride + i_start;
+				CompiledRun *run = nullptr;
+
+				for (s16 x = 0; x != sx; x++, i += i_step_x) {
+					const MapNode &n = schemdata[i];
+					u8 placement_prob = n.param1 & MTSCHEM_PROB_MASK;
+
+					// Nodes that are never placed split the row
+					if (n.getContent() == CONTENT_IGNORE ||
+							placement_prob == MTSCHEM_PROB_NEVER) {
+						run = nullptr;
+						continue;
+					}
+
+					if (!run) {
+						cr.runs.push_back({(u32)cr.nodes.size(), x, z, 0,
+							false, true});
+						run = &cr.runs.back();
+					}
+
+					MapNode placed = n;
+					placed.param1 = 0;
+					if (rot)
+						placed.rotateAlongYAxis(m_ndef, rot);
+
+					cr.nodes.push_back(placed);
+					cr.node_flags.push_back(n.param1);
+					run->length++;
+					if (placement_prob != MTSCHEM_PROB_ALWAYS)
+						run->has_prob = true;
+					if (!(n.param1 & MTSCHEM_FORCE_PLACE))
+						run->all_force = false;
+				}
+			}
+		}
+		cr.slice_runs.push_back(cr.runs.size());
+	}
+}
+
+
+void Schematic::blitCompiled(MMVManip *vm, v3s16 p, Rotation rot,
+	bool force_place)
+{
+	const CompiledRotation &cr = m_compiled[rot];
+	const VoxelArea &area = vm->m_area;
+
+	// Slices that are skipped don't leave a gap
+	s16 y_map = p.Y - 1;
+	for (s16 y = 0; y != size.Y; y++) {
+		if ((slice_probs[y] != MTSCHEM_PROB_ALWAYS) &&
+			(slice_probs[y] <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
+			continue;
+
+		y_map++;
+		if (y_map < area.MinEdge.Y || y_map > area.MaxEdge.Y)
+			continue;
+
+		for (u32 r = cr.slice_runs[y]; r != cr.slice_runs[y + 1]; r++) {
+			const CompiledRun &run = cr.runs[r];
+			s16 z_map = p.Z + run.z;
+			if (z_map < area.MinEdge.Z || z_map > area.MaxEdge.Z)
+				continue;
+
+			// Clip the run to the voxel area
+			s16 x_first = p.X + run.x;
+			s16 x_start = MYMAX(x_first, area.MinEdge.X);
+			s16 x_end = MYMIN(x_first + run.length - 1, area.MaxEdge.X);
+			if (x_start > x_end)
+				continue;
+
+			u32 i = run.offset + (x_start - x_first);
+			u32 vi = area.index(x_start, y_map, z_map);
+			u32 count = x_end - x_start + 1;
+
+			if (!run.has_prob && (force_place || run.all_force)) {
+				std::copy(&cr.nodes[i], &cr.nodes[i] + count, &vm->m_data[vi]);
+				continue;
+			}
+
+			for (u32 k = 0; k != count; k++, i++, vi++) {
+				u8 placement_prob = cr.node_flags[i] & MTSCHEM_PROB_MASK;
+				bool force_place_node = cr.node_flags[i] & MTSCHEM_FORCE_PLACE;
+
+				if (!force_place && !force_place_node) {
+					content_t c = vm->m_data[vi].getContent();
+					if (c != CONTENT_AIR && c != CONTENT_IGNORE)
+						continue;
+				}
+
+				if ((placement_prob != MTSCHEM_PROB_ALWAYS) &&
+					(placement_prob <= myrand_range(1, MTSCHEM_PROB_ALWAYS)))
+					continue;
+
+				vm->m_data[vi] = cr.nodes[i];
+			}
+		}
+	}
+}
+
+
+void Schematic::blitToVManip(MMVManip *vm, v3s16 p, Rotation rot, bool force_place)
+{
+	sanity_check(m_ndef != NULL);
+
+	if (isCompiled() && rot <= ROTATE_270) {
+		blitCompiled(vm, p, rot, force_place);
+		return;
+	}
+
+	int ystride = size.X;
+
+	s16 sx, sz;
+	int i_start, i_step_x, i_step_z;
+	get_rotation_steps(size, rot, sx, sz, i_start, i_step_x, i_step_z);
+	s16 sy = size.Y;
 
 	s16 y_map = p.Y;
 	for (s16 y = 0; y != sy; y++) {
@@ -203,50 +345,13 @@ bool Schematic::placeOnVManip(MMVManip *vm, v3s16 p, u32 flags,
 void Schematic::placeOnMap(ServerMap *map, v3s16 p, u32 flags,
 	Rotation rot, bool force_place)
 {
-	std::map<v3s16, MapBlock *> lighting_modified_blocks;
-	std::map<v3s16, MapBlock *> modified_blocks;
-	std::map<v3s16, MapBlock *>::iterator it;
-
 	assert(map != NULL);
 	assert(schemdata != NULL);
 	sanity_check(m_ndef != NULL);
 
-	//// Determine effective rotation and effective schematic dimensions
-	if (rot == ROTATE_RAND)
-		rot = (Rotation)myrand_range(ROTATE_0, ROTATE_270);
-
-	v3s16 s = (rot == ROTATE_90 || rot == ROTATE_270) ?
-			v3s16(size.Z, size.Y, size.X) : size;
-
-	//// Adjust placement position if necessary
-	if (flags & DECO_PLACE_CENTER_X)
-		p.X -= (s.X - 1) / 2;
-	if (flags & DECO_PLACE_CENTER_Y)
-		p.Y -= (s.Y - 1) / 2;
-	if (flags & DECO_PLACE_CENTER_Z)
-		p.Z -= (s.Z - 1) / 2;
-
-	//// Create VManip for effected area, emerge our area, modify area
-	//// inside VManip, then blit back.
-	v3s16 bp1 = getNodeBlockPos(p);
-	v3s16 bp2 = getNodeBlockPos(p + s - v3s16(1, 1, 1));
-
-	MMVManip vm(map);
-	vm.initialEmerge(bp1, bp2);
-
-	blitToVManip(&vm, p, rot, force_place);
-
-	voxalgo::blit_back_with_light(map, &vm, &modified_blocks);
-
-	//// Carry out post-map-modification actions
-
-	//// Create & dispatch map modification events to observers
-	MapEditEvent event;
-	event.type = MEET_OTHER;
-	for (it = modified_blocks.begin(); it != modified_blocks.end(); ++it)
-		event.modified_blocks.insert(it->first);
-
-	map->dispatchEvent(event);
+	PlacementBatch batch(map);
+	batch.addSchematic(this, p, flags, rot, force_place);
+	batch.commit();
 }
 
 
@@ -257,6 +362,8 @@ bool Schematic::deserializeFromMts(std::istream *is,
 	content_t cignore = CONTENT_IGNORE;
 	bool have_cignore = false;
 
+	m_compiled.clear();
+
 	//// Read signature
 	u32 signature = readU32(ss);
 	if (signature != MTSCHEM_FILE_SIGNATURE) {
@@ -507,6 +614,7 @@ bool Schematic::getSchematicFromMap(Map *map, v3s16 p1, v3s16 p2)
 	v3s16 bp2 = getNodeBlockPos(p2);
 	vm->initialEmerge(bp1, bp2);
 
+	m_compiled.clear();
 	size = p2 - p1 + 1;
 
 	slice_probs = new u8[size.Y];
@@ -534,6 +642,8 @@ void Schematic::applyProbabilities(v3s16 p0,
 	std::vector<std::pair<v3s16, u8> > *plist,
 	std::vector<std::pair<s16, u8> > *splist)
 {
+	m_compiled.clear();
+
 	for (size_t i = 0; i != plist->size(); i++) {
 		v3s16 p = (*plist)[i].first - p0;
 		int index = p.Z * (size.Y * size.X) + p.Y * size.X + p.X;
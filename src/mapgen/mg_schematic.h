@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #pragma once
 
 #include <map>
+#include <vector>
 #include "mg_decoration.h"
 #include "util/string.h"
 
@@ -116,11 +117,43 @@ class Schematic : public ObjDef, public NodeResolver {
 		std::vector<std::pair<v3s16, u8> > *plist,
 		std::vector<std::pair<s16, u8> > *splist);
 
+	// Prepares the node data for fast placement in every rotation.
+	// Must be called again whenever the node data changes.
+	void compile();
+	bool isCompiled() const { return !m_compiled.empty(); }
+
 	std::vector<content_t> c_nodes;
 	u32 flags = 0;
 	v3s16 size;
 	MapNode *schemdata = nullptr;
 	u8 *slice_probs = nullptr;
+
+private:
+	// Consecutive nodes of one row that may be placed, in the rotated
+	// schematic's coordinates
+	struct CompiledRun {
+		u32 offset; // Index of the first node in CompiledRotation::nodes
+		s16 x;
+		s16 z;
+		u16 length;
+		bool has_prob;  // Some nodes have a placement probability
+		bool all_force; // All nodes have the force placement bit set
+	};
+
+	struct CompiledRotation {
+		v3s16 size;
+		// Rotated nodes with param1 cleared, as they are placed
+		std::vector<MapNode> nodes;
+		// Placement probability and force placement bit of each node
+		std::vector<u8> node_flags;
+		std::vector<CompiledRun> runs;
+		// Index of the first run of each Y slice, plus the end of the last
+		std::vector<u32> slice_runs;
+	};
+
+	void blitCompiled(MMVManip *vm, v3s16 p, Rotation rot, bool force_place);
+
+	std::vector<CompiledRotation> m_compiled;
 };
 
 class SchematicManager : public ObjDefManager {
@@ -0,0 +1,114 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "noise_cache.h"
+#include <algorithm>
+#include <functional>
+
+static inline void hash_combine(size_t &seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool NoiseCache::Key::operator==(const Key &other) const
+{
+	return seed == other.seed && x == other.x && z == other.z &&
+		sx == other.sx && sy == other.sy &&
+		np == other.np &&
+		has_persist == other.has_persist &&
+		(!has_persist || persist_np == other.persist_np);
+}
+
+size_t NoiseCache::KeyHash::operator()(const Key &key) const
+{
+	// Maps at different positions are the most common difference
+	size_t h = std::hash<float>()(key.x);
+	hash_combine(h, std::hash<float>()(key.z));
+	hash_combine(h, std::hash<s32>()(key.seed + key.np.seed));
+	hash_combine(h, std::hash<float>()(key.np.offset));
+	hash_combine(h, std::hash<float>()(key.np.scale));
+	hash_combine(h, std::hash<float>()(key.np.spread.X));
+	return h;
+}
+
+NoiseCache::NoiseCache(size_t max_maps) :
+	m_max_maps(max_maps)
+{
+}
+
+void NoiseCache::perlinMap2D(NoiseCache *cache, Noise *noise, float x, float z,
+	Noise *persist_noise)
+{
+	if (cache) {
+		cache->perlinMap2D(noise, x, z, persist_noise);
+		return;
+	}
+
+	noise->perlinMap2D(x, z, persist_noise ? persist_noise->result : nullptr);
+}
+
+void NoiseCache::perlinMap2D(Noise *noise, float x, float z,
+	Noise *persist_noise)
+{
+	float *persistence_map = persist_noise ? persist_noise->result : nullptr;
+	if (m_max_maps == 0) {
+		noise->perlinMap2D(x, z, persistence_map);
+		return;
+	}
+
+	Key key;
+	key.np = noise->np;
+	key.seed = noise->seed;
+	key.x = x;
+	key.z = z;
+	key.sx = noise->sx;
+	key.sy = noise->sy;
+	key.has_persist = persist_noise != nullptr;
+	if (persist_noise)
+		key.persist_np = persist_noise->np;
+
+	size_t size = noise->sx * noise->sy;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end()) {
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			std::copy(it->second->result.begin(), it->second->result.end(),
+				noise->result);
+			return;
+		}
+	}
+
+	// Calculate without holding the lock, other mapgens may use the cache
+	// meanwhile. If two threads miss the same map, both calculate it.
+	noise->perlinMap2D(x, z, persistence_map);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_index.find(key) != m_index.end())
+		return;
+
+	m_entries.push_front(Entry{key, std::vector<float>(noise->result,
+		noise->result + size)});
+	m_index[key] = m_entries.begin();
+
+	while (m_entries.size() > m_max_maps) {
+		m_index.erase(m_entries.back().key);
+		m_entries.pop_back();
+	}
+}
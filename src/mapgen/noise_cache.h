@@ -0,0 +1,83 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "noise.h"
+#include "util/basic_macros.h"
+
+/*
+	Least recently used cache of 2D noise maps, shared by all mapgens.
+
+	2D noise only depends on the X and Z coordinates, so mapchunks stacked
+	in the same column calculate exactly the same maps. Results are keyed
+	by everything they depend on, cached maps are therefore identical to
+	freshly calculated ones.
+*/
+class NoiseCache
+{
+public:
+	// A max_maps of 0 disables caching
+	NoiseCache(size_t max_maps);
+	DISABLE_CLASS_COPY(NoiseCache);
+
+	// Fills noise->result as noise->perlinMap2D(x, z) would. If persist_noise
+	// is given, its result must hold its own map at the same coordinates and
+	// is used as persistence map.
+	void perlinMap2D(Noise *noise, float x, float z,
+			Noise *persist_noise = nullptr);
+
+	// Same as above, calculates the map directly if cache is nullptr
+	static void perlinMap2D(NoiseCache *cache, Noise *noise, float x, float z,
+			Noise *persist_noise = nullptr);
+
+private:
+	struct Key
+	{
+		NoiseParams np;
+		NoiseParams persist_np;
+		s32 seed;
+		float x, z;
+		u32 sx, sy;
+		bool has_persist;
+
+		bool operator==(const Key &other) const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry
+	{
+		Key key;
+		std::vector<float> result;
+	};
+
+	size_t m_max_maps;
+	std::mutex m_mutex;
+	// Most recently used maps first
+	std::list<Entry> m_entries;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+};
@@ -0,0 +1,173 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "placement_batch.h"
+#include <map>
+#include <memory>
+#include "map.h"
+#include "mapblock.h"
+#include "mg_schematic.h"
+#include "voxelalgorithms.h"
+
+
+// Whether the block ranges overlap or are adjacent
+static bool blocks_touch(v3s16 min_a, v3s16 max_a, v3s16 min_b, v3s16 max_b)
+{
+	return min_a.X <= max_b.X + 1 && min_b.X <= max_a.X + 1 &&
+		min_a.Y <= max_b.Y + 1 && min_b.Y <= max_a.Y + 1 &&
+		min_a.Z <= max_b.Z + 1 && min_b.Z <= max_a.Z + 1;
+}
+
+
+void PlacementBatch::addSchematic(Schematic *schem, v3s16 p, u32 flags,
+	Rotation rot, bool force_place)
+{
+	// Effective dimensions, covering both orientations if the rotation
+	// is only chosen on placement
+	v3s16 s = schem->size;
+	if (rot == ROTATE_90 || rot == ROTATE_270) {
+		s = v3s16(s.Z, s.Y, s.X);
+	} else if (rot == ROTATE_RAND) {
+		s.X = MYMAX(s.X, s.Z);
+		s.Z = s.X;
+	}
+
+	v3s16 pmin = p;
+	if (flags & DECO_PLACE_CENTER_X)
+		pmin.X -= (s.X - 1) / 2;
+	if (flags & DECO_PLACE_CENTER_Y)
+		pmin.Y -= (s.Y - 1) / 2;
+	if (flags & DECO_PLACE_CENTER_Z)
+		pmin.Z -= (s.Z - 1) / 2;
+
+	Placement placement;
+	placement.p = p;
+	placement.blockpos_min = getNodeBlockPos(pmin);
+	placement.blockpos_max = getNodeBlockPos(pmin + s - v3s16(1, 1, 1));
+	placement.schem = schem;
+	placement.flags = flags;
+	placement.rot = rot;
+	placement.force_place = force_place;
+	m_placements.push_back(placement);
+}
+
+
+void PlacementBatch::addTree(v3s16 p0, const treegen::TreeDef &tree_def)
+{
+	// Same area as treegen::spawn_ltree
+	v3s16 tree_blockp = getNodeBlockPos(p0);
+
+	Placement placement;
+	placement.p = p0;
+	placement.blockpos_min = tree_blockp - v3s16(1, 1, 1);
+	placement.blockpos_max = tree_blockp + v3s16(1, 3, 1);
+	placement.tree_def = tree_def;
+	m_placements.push_back(placement);
+}
+
+
+treegen::error PlacementBatch::commit()
+{
+	struct Cluster {
+		v3s16 blockpos_min;
+		v3s16 blockpos_max;
+		std::unique_ptr<MMVManip> vm;
+	};
+
+	// Group placements whose areas overlap or touch, growing the groups
+	// until none of them touch each other
+	std::vector<Cluster> clusters;
+	std::vector<size_t> cluster_of(m_placements.size());
+	for (size_t i = 0; i != m_placements.size(); i++) {
+		clusters.emplace_back();
+		clusters.back().blockpos_min = m_placements[i].blockpos_min;
+		clusters.back().blockpos_max = m_placements[i].blockpos_max;
+		cluster_of[i] = i;
+	}
+
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t a = 0; a < clusters.size() && !merged; a++)
+		for (size_t b = a + 1; b < clusters.size() && !merged; b++) {
+			Cluster &ca = clusters[a];
+			const Cluster &cb = clusters[b];
+			if (!blocks_touch(ca.blockpos_min, ca.blockpos_max,
+					cb.blockpos_min, cb.blockpos_max))
+				continue;
+
+			ca.blockpos_min.X = MYMIN(ca.blockpos_min.X, cb.blockpos_min.X);
+			ca.blockpos_min.Y = MYMIN(ca.blockpos_min.Y, cb.blockpos_min.Y);
+			ca.blockpos_min.Z = MYMIN(ca.blockpos_min.Z, cb.blockpos_min.Z);
+			ca.blockpos_max.X = MYMAX(ca.blockpos_max.X, cb.blockpos_max.X);
+			ca.blockpos_max.Y = MYMAX(ca.blockpos_max.Y, cb.blockpos_max.Y);
+			ca.blockpos_max.Z = MYMAX(ca.blockpos_max.Z, cb.blockpos_max.Z);
+
+			// Move the last cluster into the place of the removed one
+			size_t last = clusters.size() - 1;
+			for (size_t &c : cluster_of) {
+				if (c == b)
+					c = a;
+				else if (c == last)
+					c = b;
+			}
+			clusters[b] = std::move(clusters[last]);
+			clusters.pop_back();
+			merged = true;
+		}
+	}
+
+	for (Cluster &cluster : clusters) {
+		cluster.vm.reset(new MMVManip(m_map));
+		cluster.vm->initialEmerge(cluster.blockpos_min, cluster.blockpos_max);
+	}
+
+	const NodeDefManager *ndef = m_map->getNodeDefManager();
+	for (size_t i = 0; i != m_placements.size(); i++) {
+		Placement &placement = m_placements[i];
+		MMVManip *vm = clusters[cluster_of[i]].vm.get();
+
+		if (placement.schem) {
+			placement.schem->placeOnVManip(vm, placement.p, placement.flags,
+				placement.rot, placement.force_place);
+			continue;
+		}
+
+		treegen::error e = treegen::make_ltree(*vm, placement.p, ndef,
+			placement.tree_def);
+		if (e != treegen::SUCCESS) {
+			m_placements.clear();
+			return e;
+		}
+	}
+	m_placements.clear();
+
+	std::map<v3s16, MapBlock *> modified_blocks;
+	for (Cluster &cluster : clusters)
+		voxalgo::blit_back_with_light(m_map, cluster.vm.get(), &modified_blocks);
+
+	// Send a single MEET_OTHER event
+	MapEditEvent event;
+	event.type = MEET_OTHER;
+	for (auto &modified_block : modified_blocks)
+		event.modified_blocks.insert(modified_block.first);
+	m_map->dispatchEvent(event);
+
+	return treegen::SUCCESS;
+}
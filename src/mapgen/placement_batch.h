@@ -0,0 +1,70 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <vector>
+#include "irr_v3d.h"
+#include "mapnode.h"
+#include "treegen.h"
+
+class Schematic;
+class ServerMap;
+
+/*
+	Places schematics and L-system trees on the map together.
+
+	Placements close to each other share one MMVManip, which is emerged
+	once, relit once and written back once. A single map edit event is
+	sent for everything that was placed. Placements are applied in the
+	order they were added.
+*/
+class PlacementBatch
+{
+public:
+	PlacementBatch(ServerMap *map) : m_map(map) {}
+
+	void addSchematic(Schematic *schem, v3s16 p, u32 flags, Rotation rot,
+		bool force_place);
+	void addTree(v3s16 p0, const treegen::TreeDef &tree_def);
+
+	bool empty() const { return m_placements.empty(); }
+
+	// Places everything and clears the batch. If a tree definition is
+	// invalid, nothing at all is placed.
+	treegen::error commit();
+
+private:
+	struct Placement {
+		v3s16 p;
+		// Blocks that have to be emerged
+		v3s16 blockpos_min;
+		v3s16 blockpos_max;
+
+		Schematic *schem = nullptr;
+		u32 flags = 0;
+		Rotation rot = ROTATE_0;
+		bool force_place = false;
+
+		treegen::TreeDef tree_def;
+	};
+
+	ServerMap *m_map;
+	std::vector<Placement> m_placements;
+};
@@ -27,8 +27,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapblock.h"
 #include "serverenvironment.h"
 #include "nodedef.h"
+#include "placement_batch.h"
 #include "treegen.h"
-#include "voxelalgorithms.h"
 
 namespace treegen
 {
@@ -117,26 +117,9 @@ void make_tree(MMVManip &vmanip, v3s16 p0, bool is_apple_tree,
 treegen::error spawn_ltree(ServerEnvironment *env, v3s16 p0,
 	const NodeDefManager *ndef, const TreeDef &tree_definition)
 {
-	ServerMap *map = &env->getServerMap();
-	std::map<v3s16, MapBlock*> modified_blocks;
-	MMVManip vmanip(map);
-	v3s16 tree_blockp = getNodeBlockPos(p0);
-	treegen::error e;
-
-	vmanip.initialEmerge(tree_blockp - v3s16(1, 1, 1), tree_blockp + v3s16(1, 3, 1));
-	e = make_ltree(vmanip, p0, ndef, tree_definition);
-	if (e != SUCCESS)
-		return e;
-
-	voxalgo::blit_back_with_light(map, &vmanip, &modified_blocks);
-
-	// Send a MEET_OTHER event
-	MapEditEvent event;
-	event.type = MEET_OTHER;
-	for (auto &modified_block : modified_blocks)
-		event.modified_blocks.insert(modified_block.first);
-	map->dispatchEvent(event);
-	return SUCCESS;
+	PlacementBatch batch(&env->getServerMap());
+	batch.addTree(p0, tree_definition);
+	return batch.commit();
 }
 
 
@@ -22,6 +22,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "serialization.h"
 #include "util/serialize.h"
 #include "constants.h" // MAP_BLOCKSIZE
+#include <algorithm>
+#include <cassert>
 
 /*
 	NodeTimer
@@ -63,7 +65,7 @@ void NodeTimerList::serialize(std::ostream &os, u8 map_format_version) const
 	for (const auto &timer : m_timers) {
 		NodeTimer t = timer.second;
 		NodeTimer nt = NodeTimer(t.timeout,
-			t.timeout - (f32)(timer.first - m_time), t.position);
+			t.timeout - (f32)(timer.first - getTime()), t.position);
 		v3s16 p = t.position;
 
 		u16 p16 = p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
@@ -127,16 +129,69 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 
 std::vector<NodeTimer> NodeTimerList::step(float dtime)
 {
+	// The time of attached lists is advanced by the scheduler
+	assert(!m_scheduler);
+
 	std::vector<NodeTimer> elapsed_timers;
 	m_time += dtime;
-	if (m_next_trigger_time == -1. || m_time < m_next_trigger_time) {
-		return elapsed_timers;
+	collectElapsed(elapsed_timers);
+	return elapsed_timers;
+}
+
+void NodeTimerList::attach(NodeTimerScheduler *scheduler, v3s16 blockpos)
+{
+	detach();
+
+	// Move the trigger times to the time of the scheduler
+	double offset = scheduler->getTime() - m_time;
+	if (offset != 0.0 && !m_timers.empty()) {
+		std::multimap<double, NodeTimer> timers;
+		m_iterators.clear();
+		for (const auto &timer : m_timers) {
+			auto it = timers.emplace_hint(timers.end(),
+				timer.first + offset, timer.second);
+			m_iterators.emplace(timer.second.position, it);
+		}
+		m_timers.swap(timers);
+		m_next_trigger_time = m_timers.begin()->first;
 	}
+
+	m_scheduler = scheduler;
+	m_blockpos = blockpos;
+	if (m_next_trigger_time != -1.)
+		m_scheduler->schedule(m_blockpos, m_next_trigger_time);
+}
+
+void NodeTimerList::detach()
+{
+	if (!m_scheduler)
+		return;
+
+	m_time = m_scheduler->getTime();
+	m_scheduler = nullptr;
+}
+
+void NodeTimerList::popElapsed(std::vector<NodeTimer> &elapsed_timers)
+{
+	assert(m_scheduler);
+
+	collectElapsed(elapsed_timers);
+	// The timers that are left need another visit
+	if (m_next_trigger_time != -1.)
+		m_scheduler->schedule(m_blockpos, m_next_trigger_time);
+}
+
+void NodeTimerList::collectElapsed(std::vector<NodeTimer> &elapsed_timers)
+{
+	double time = getTime();
+	if (m_next_trigger_time == -1. || time < m_next_trigger_time)
+		return;
+
 	std::multimap<double, NodeTimer>::iterator i = m_timers.begin();
 	// Process timers
-	for (; i != m_timers.end() && i->first <= m_time; ++i) {
+	for (; i != m_timers.end() && i->first <= time; ++i) {
 		NodeTimer t = i->second;
-		t.elapsed = t.timeout + (f32)(m_time - i->first);
+		t.elapsed = t.timeout + (f32)(time - i->first);
 		elapsed_timers.push_back(t);
 		m_iterators.erase(t.position);
 	}
@@ -146,5 +201,21 @@ std::vector<NodeTimer> NodeTimerList::step(float dtime)
 		m_next_trigger_time = -1.;
 	else
 		m_next_trigger_time = m_timers.begin()->first;
-	return elapsed_timers;
+}
+
+/*
+	NodeTimerScheduler
+*/
+
+void NodeTimerScheduler::popDueBlocks(std::vector<v3s16> &blocks)
+{
+	size_t first = blocks.size();
+	while (!m_queue.empty() && m_queue.top().trigger_time <= m_time) {
+		blocks.push_back(m_queue.top().blockpos);
+		m_queue.pop();
+	}
+
+	// A block can have several entries
+	std::sort(blocks.begin() + first, blocks.end());
+	blocks.erase(std::unique(blocks.begin() + first, blocks.end()), blocks.end());
 }
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irr_v3d.h"
 #include <iostream>
 #include <map>
+#include <queue>
 #include <vector>
 
 /*
@@ -50,6 +51,50 @@ class NodeTimer
 	v3s16 position;
 };
 
+/*
+	Server-wide schedule of the blocks with pending node timers.
+
+	The timer lists of active blocks follow the time of the scheduler,
+	which keeps one entry per armed timer keyed by the absolute trigger
+	time. This way only blocks with elapsed timers have to be visited.
+	Entries can be stale, visiting a block too early does no harm.
+*/
+
+class NodeTimerScheduler
+{
+public:
+	NodeTimerScheduler() = default;
+	~NodeTimerScheduler() = default;
+
+	double getTime() const { return m_time; }
+	void step(float dtime) { m_time += dtime; }
+
+	// Remembers that a timer of the block triggers at the given time
+	void schedule(v3s16 blockpos, double trigger_time)
+	{
+		m_queue.push(Entry{trigger_time, blockpos});
+	}
+	// Removes the blocks with timers due by now, each block only once
+	void popDueBlocks(std::vector<v3s16> &blocks);
+
+	size_t size() const { return m_queue.size(); }
+
+private:
+	struct Entry {
+		double trigger_time;
+		v3s16 blockpos;
+
+		// Earliest trigger time first
+		bool operator<(const Entry &other) const
+		{
+			return trigger_time > other.trigger_time;
+		}
+	};
+
+	std::priority_queue<Entry> m_queue;
+	double m_time = 0.0;
+};
+
 /*
 	List of timers of all the nodes of a block
 */
@@ -70,7 +115,7 @@ class NodeTimerList
 		if (n == m_iterators.end())
 			return NodeTimer();
 		NodeTimer t = n->second->second;
-		t.elapsed = t.timeout - (n->second->first - m_time);
+		t.elapsed = t.timeout - (n->second->first - getTime());
 		return t;
 	}
 	// Deletes timer
@@ -95,15 +140,18 @@ class NodeTimerList
 	// Undefined behaviour if there already is a timer
 	void insert(NodeTimer timer) {
 		v3s16 p = timer.position;
-		double trigger_time = m_time + (double)(timer.timeout - timer.elapsed);
+		double trigger_time = getTime() + (double)(timer.timeout - timer.elapsed);
 		std::multimap<double, NodeTimer>::iterator it =
 			m_timers.insert(std::pair<double, NodeTimer>(
 				trigger_time, timer
 			));
 		m_iterators.insert(
 			std::pair<v3s16, std::multimap<double, NodeTimer>::iterator>(p, it));
-		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time)
+		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time) {
 			m_next_trigger_time = trigger_time;
+			if (m_scheduler)
+				m_scheduler->schedule(m_blockpos, trigger_time);
+		}
 	}
 	// Deletes old timer and sets a new one
 	inline void set(const NodeTimer &timer) {
@@ -120,9 +168,26 @@ class NodeTimerList
 	// Move forward in time, returns elapsed timers
 	std::vector<NodeTimer> step(float dtime);
 
+	// Lets the time of the list follow the scheduler, used for active blocks
+	void attach(NodeTimerScheduler *scheduler, v3s16 blockpos);
+	// Stops the time of the list
+	void detach();
+	bool isAttached() const { return m_scheduler != nullptr; }
+	// Removes the timers elapsed by the time of the scheduler
+	void popElapsed(std::vector<NodeTimer> &elapsed_timers);
+
 private:
+	double getTime() const
+	{
+		return m_scheduler ? m_scheduler->getTime() : m_time;
+	}
+	void collectElapsed(std::vector<NodeTimer> &elapsed_timers);
+
 	std::multimap<double, NodeTimer> m_timers;
 	std::map<v3s16, std::multimap<double, NodeTimer>::iterator> m_iterators;
 	double m_next_trigger_time = -1.0;
 	double m_time = 0.0;
+
+	NodeTimerScheduler *m_scheduler = nullptr;
+	v3s16 m_blockpos;
 };
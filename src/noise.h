@@ -125,6 +125,14 @@ struct NoiseParams {
 		lacunarity = lacunarity_;
 		flags      = flags_;
 	}
+
+	bool operator==(const NoiseParams &other) const
+	{
+		return offset == other.offset && scale == other.scale &&
+			spread == other.spread && seed == other.seed &&
+			octaves == other.octaves && persist == other.persist &&
+			lacunarity == other.lacunarity && flags == other.flags;
+	}
 };
 
 class Noise {
@@ -22,13 +22,18 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include "irr_v3d.h"
+#include "map.h"
+#include "util/numeric.h"
 
 /******************************************************************************/
 /* Forward declarations                                                       */
 /******************************************************************************/
 
+class NodeDefManager;
 class ServerEnvironment;
 
 /******************************************************************************/
@@ -46,9 +51,55 @@ typedef enum {
 typedef enum {
 	PA_DIJKSTRA,           /**< Dijkstra shortest path algorithm             */
 	PA_PLAIN,            /**< A* algorithm using heuristics to find a path */
-	PA_PLAIN_NP          /**< A* algorithm without prefetching of map data */
+	PA_PLAIN_NP          /**< same as PA_PLAIN, kept for compatibility     */
 } PathAlgorithm;
 
+/** traversability flags of a node */
+enum PathNodeFlags : u8 {
+	PATHNODE_WALKABLE = 0x01,   /**< node is walkable                      */
+	PATHNODE_IGNORE   = 0x02,   /**< node is not loaded                    */
+};
+
+/******************************************************************************/
+/* Class definitions                                                          */
+/******************************************************************************/
+
+/**
+ * Traversability flags of mapblocks, shared by all path searches.
+ * Blocks are invalidated when the map reports changes to them and the whole
+ * cache is dropped at every server step.
+ */
+class PathfinderCache : public MapEventReceiver {
+public:
+	PathfinderCache(const NodeDefManager *ndef);
+	virtual ~PathfinderCache() = default;
+
+	/**
+	 * get flags of all nodes of a mapblock, ordered like MapBlock data
+	 * @param map map to read the block from if it isn't cached
+	 * @param blockpos position of the block
+	 * @param storage used for blocks that can't be cached
+	 * @return pointer to MAP_BLOCKSIZE^3 flags
+	 */
+	const u8 *getBlock(Map *map, v3s16 blockpos, std::unique_ptr<u8[]> &storage);
+
+	/** drop all cached blocks */
+	void clear();
+
+	virtual void onMapEditEvent(const MapEditEvent &event);
+
+private:
+	/**
+	 * fill flags of a mapblock from the map
+	 * @return false if the block isn't loaded
+	 */
+	bool fillBlock(Map *map, v3s16 blockpos, u8 *flags);
+
+	const NodeDefManager *m_ndef;
+	std::vector<u8> m_content_flags;   /**< flags by content id, 0xff if unknown */
+	std::unordered_map<v3s16, std::unique_ptr<u8[]>, BlockPosHash> m_blocks;
+};
+
 /******************************************************************************/
 /* declarations                                                               */
 /******************************************************************************/
@@ -61,3 +112,14 @@ std::vector<v3s16> get_path(ServerEnvironment *env,
 							unsigned int max_jump,
 							unsigned int max_drop,
 							PathAlgorithm algo);
+
+/** same as above, cache may be nullptr */
+std::vector<v3s16> get_path(Map *map,
+							const NodeDefManager *ndef,
+							PathfinderCache *cache,
+							v3s16 source,
+							v3s16 destination,
+							unsigned int searchdistance,
+							unsigned int max_jump,
+							unsigned int max_drop,
+							PathAlgorithm algo);
@@ -31,9 +31,40 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "inventorymanager.h" // deserializing InventoryLocations
 #include "sqlite3.h"
 #include "filesys.h"
+#include "constants.h"
+#include "database/database.h"
+#include "threading/mutex_auto_lock.h"
+#include "threading/semaphore.h"
+#include "threading/thread.h"
+#include <algorithm>
 
 #define POINTS_PER_NODE (16.0)
 
+// Queued actions that wake the writer thread early
+#define ACTION_BATCH_SIZE 500
+// Interval at which the writer thread writes whatever is queued
+#define WRITE_INTERVAL_MS 2000
+// Age of the oldest actions getSuspect() looks at
+#define SUSPECT_MAX_AGE 100
+// Above this number of block rows, range queries use one wide block range
+#define RANGE_QUERY_MAX_ROWS 256
+
+// Block key in the `blockpos` column, MapDatabase::getBlockAsInteger() of
+// the block containing the node
+#define SQL_BLOCKPOS(x, y, z) \
+	"((" z " >> 4) * 16777216 + (" y " >> 4) * 4096 + (" x " >> 4))"
+
+static const char *index_sql =
+	"CREATE INDEX IF NOT EXISTS `actionBlockIndex` ON `action`(`blockpos`,`timestamp`);\n"
+	"CREATE INDEX IF NOT EXISTS `actionTimeIndex` ON `action`(`timestamp`);\n"
+	"CREATE INDEX IF NOT EXISTS `actionActorIndex` ON `action`(`actor`,`timestamp`);\n";
+
+static s64 get_action_blockpos(int x, int y, int z)
+{
+	return MapDatabase::getBlockAsInteger(getContainerPos(
+		v3s16(x, y, z), MAP_BLOCKSIZE));
+}
+
 #define SQLRES(f, good) \
 	if ((f) != (good)) {\
 		throw FileNotGoodException(std::string("RollbackManager: " \
@@ -88,6 +119,50 @@ struct Entity {
 };
 
 
+/*
+	Writes the queued actions to the database, every WRITE_INTERVAL_MS or
+	when ACTION_BATCH_SIZE actions are queued, so that the server thread
+	does not wait for SQLite.
+*/
+class RollbackWriterThread : public Thread {
+public:
+	RollbackWriterThread(RollbackManager *manager) :
+		Thread("RollbackWriter"),
+		m_manager(manager)
+	{}
+
+	void wake()
+	{
+		m_signal.post();
+	}
+
+	void stopAndWait()
+	{
+		stop();
+		m_signal.post();
+		wait();
+	}
+
+protected:
+	void *run()
+	{
+		while (!stopRequested()) {
+			m_signal.wait(WRITE_INTERVAL_MS);
+			try {
+				m_manager->flush();
+			} catch (BaseException &e) {
+				errorstream << "RollbackWriterThread: " << e.what() << std::endl;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	RollbackManager *m_manager;
+	Semaphore m_signal;
+};
+
+
 
 RollbackManager::RollbackManager(const std::string & world_path,
 		IGameDef * gamedef_) :
@@ -109,13 +184,22 @@ RollbackManager::RollbackManager(const std::string & world_path,
 		migrate(txt_filename);
 		fs::DeleteSingleFileOrEmptyDirectory(migrating_flag);
 	}
+
+	m_writer = new RollbackWriterThread(this);
+	m_writer->start();
 }
 
 
 RollbackManager::~RollbackManager()
 {
+	m_writer->stopAndWait();
+	delete m_writer;
+
 	flush();
 
+	FINALIZE_STATEMENT(stmt_begin);
+	FINALIZE_STATEMENT(stmt_commit);
+	FINALIZE_STATEMENT(stmt_rollback);
 	FINALIZE_STATEMENT(stmt_insert);
 	FINALIZE_STATEMENT(stmt_replace);
 	FINALIZE_STATEMENT(stmt_select);
@@ -244,6 +328,7 @@ bool RollbackManager::createTables()
 		"	`newParam2` INTEGER,\n"
 		"	`newMeta` TEXT,\n"
 		"	`guessedActor` INTEGER,\n"
+		"	`blockpos` INTEGER,\n"
 		"	FOREIGN KEY (`actor`) REFERENCES `actor`(`id`),\n"
 		"	FOREIGN KEY (`stackNode`) REFERENCES `node`(`id`),\n"
 		"	FOREIGN KEY (`oldNode`)   REFERENCES `node`(`id`),\n"
@@ -251,12 +336,37 @@ bool RollbackManager::createTables()
 		");\n"
 		"CREATE INDEX IF NOT EXISTS `actionIndex` ON `action`(`x`,`y`,`z`,`timestamp`,`actor`);\n",
 		NULL, NULL, NULL));
+	SQLOK(sqlite3_exec(db, index_sql, NULL, NULL, NULL));
 	verbosestream << "SQL Rollback: SQLite3 database structure was created" << std::endl;
 
 	return true;
 }
 
 
+void RollbackManager::upgradeTables()
+{
+	// Databases created before the `blockpos` column existed
+	sqlite3_stmt *stmt_check;
+	if (sqlite3_prepare_v2(db, "SELECT `blockpos` FROM `action` LIMIT 0",
+			-1, &stmt_check, NULL) == SQLITE_OK) {
+		FINALIZE_STATEMENT(stmt_check);
+	} else {
+		actionstream << "RollbackManager: Adding block index to "
+			<< database_path << ", this may take a while" << std::endl;
+		SQLOK(sqlite3_exec(db,
+			"BEGIN;\n"
+			"ALTER TABLE `action` ADD COLUMN `blockpos` INTEGER;\n"
+			"UPDATE `action` SET `blockpos` = "
+				SQL_BLOCKPOS("`x`", "`y`", "`z`") "\n"
+			"	WHERE `x` IS NOT NULL AND `y` IS NOT NULL AND `z` IS NOT NULL;\n"
+			"COMMIT;\n",
+			NULL, NULL, NULL));
+	}
+
+	SQLOK(sqlite3_exec(db, index_sql, NULL, NULL, NULL));
+}
+
+
 bool RollbackManager::initDatabase()
 {
 	verbosestream << "RollbackManager: Database connection setup" << std::endl;
@@ -267,8 +377,14 @@ bool RollbackManager::initDatabase()
 
 	if (needs_create) {
 		createTables();
+	} else {
+		upgradeTables();
 	}
 
+	SQLOK(sqlite3_prepare_v2(db, "BEGIN", -1, &stmt_begin, NULL));
+	SQLOK(sqlite3_prepare_v2(db, "COMMIT", -1, &stmt_commit, NULL));
+	SQLOK(sqlite3_prepare_v2(db, "ROLLBACK", -1, &stmt_rollback, NULL));
+
 	SQLOK(sqlite3_prepare_v2(db,
 		"INSERT INTO `action` (\n"
 		"	`actor`, `timestamp`, `type`,\n"
@@ -276,14 +392,14 @@ bool RollbackManager::initDatabase()
 		"	`x`, `y`, `z`,\n"
 		"	`oldNode`, `oldParam1`, `oldParam2`, `oldMeta`,\n"
 		"	`newNode`, `newParam1`, `newParam2`, `newMeta`,\n"
-		"	`guessedActor`\n"
+		"	`guessedActor`, `blockpos`\n"
 		") VALUES (\n"
 		"	?, ?, ?,\n"
 		"	?, ?, ?, ?, ?, ?,\n"
 		"	?, ?, ?,\n"
 		"	?, ?, ?, ?,\n"
 		"	?, ?, ?, ?,\n"
-		"	?"
+		"	?, ?"
 		");",
 		-1, &stmt_insert, NULL));
 
@@ -294,14 +410,14 @@ bool RollbackManager::initDatabase()
 		"	`x`, `y`, `z`,\n"
 		"	`oldNode`, `oldParam1`, `oldParam2`, `oldMeta`,\n"
 		"	`newNode`, `newParam1`, `newParam2`, `newMeta`,\n"
-		"	`guessedActor`, `id`\n"
+		"	`guessedActor`, `blockpos`, `id`\n"
 		") VALUES (\n"
 		"	?, ?, ?,\n"
 		"	?, ?, ?, ?, ?, ?,\n"
 		"	?, ?, ?,\n"
 		"	?, ?, ?, ?,\n"
 		"	?, ?, ?, ?,\n"
-		"	?, ?\n"
+		"	?, ?, ?\n"
 		");",
 		-1, &stmt_replace, NULL));
 
@@ -312,7 +428,7 @@ bool RollbackManager::initDatabase()
 		"	`x`, `y`, `z`,\n"
 		"	`oldNode`, `oldParam1`, `oldParam2`, `oldMeta`,\n"
 		"	`newNode`, `newParam1`, `newParam2`, `newMeta`,\n"
-		"	`guessedActor`\n"
+		"	`guessedActor`, `id`\n"
 		" FROM `action`\n"
 		" WHERE `timestamp` >= ?\n"
 		" ORDER BY `timestamp` DESC, `id` DESC",
@@ -325,12 +441,10 @@ bool RollbackManager::initDatabase()
 		"	`x`, `y`, `z`,\n"
 		"	`oldNode`, `oldParam1`, `oldParam2`, `oldMeta`,\n"
 		"	`newNode`, `newParam1`, `newParam2`, `newMeta`,\n"
-		"	`guessedActor`\n"
-		"FROM `action`\n"
-		"WHERE `timestamp` >= ?\n"
-		"	AND `x` IS NOT NULL\n"
-		"	AND `y` IS NOT NULL\n"
-		"	AND `z` IS NOT NULL\n"
+		"	`guessedActor`, `id`\n"
+		"FROM `action` INDEXED BY `actionBlockIndex`\n"
+		"WHERE `blockpos` BETWEEN ? AND ?\n"
+		"	AND `timestamp` >= ?\n"
 		"	AND `x` BETWEEN ? AND ?\n"
 		"	AND `y` BETWEEN ? AND ?\n"
 		"	AND `z` BETWEEN ? AND ?\n"
@@ -345,7 +459,7 @@ bool RollbackManager::initDatabase()
 		"	`x`, `y`, `z`,\n"
 		"	`oldNode`, `oldParam1`, `oldParam2`, `oldMeta`,\n"
 		"	`newNode`, `newParam1`, `newParam2`, `newMeta`,\n"
-		"	`guessedActor`\n"
+		"	`guessedActor`, `id`\n"
 		"FROM `action`\n"
 		"WHERE `timestamp` >= ?\n"
 		"	AND `actor` = ?\n"
@@ -416,9 +530,12 @@ bool RollbackManager::registerRow(const ActionRow & row)
 			p2 = loc.find(',', p1);
 			std::string y = loc.substr(p1, p2 - p1);
 			std::string z = loc.substr(p2 + 1);
-			SQLOK(sqlite3_bind_int(stmt_do, 10, atoi(x.c_str())));
-			SQLOK(sqlite3_bind_int(stmt_do, 11, atoi(y.c_str())));
-			SQLOK(sqlite3_bind_int(stmt_do, 12, atoi(z.c_str())));
+			int px = atoi(x.c_str()), py = atoi(y.c_str()), pz = atoi(z.c_str());
+			SQLOK(sqlite3_bind_int  (stmt_do, 10, px));
+			SQLOK(sqlite3_bind_int  (stmt_do, 11, py));
+			SQLOK(sqlite3_bind_int  (stmt_do, 12, pz));
+			SQLOK(sqlite3_bind_int64(stmt_do, 22,
+				get_action_blockpos(px, py, pz)));
 		}
 	} else {
 		SQLOK(sqlite3_bind_null(stmt_do, 4));
@@ -442,11 +559,14 @@ bool RollbackManager::registerRow(const ActionRow & row)
 		SQLOK(sqlite3_bind_int (stmt_do, 19, row.newParam2));
 		SQLOK(sqlite3_bind_text(stmt_do, 20, row.newMeta.c_str(), row.newMeta.size(), NULL));
 		SQLOK(sqlite3_bind_int (stmt_do, 21, row.guessed ? 1 : 0));
+		SQLOK(sqlite3_bind_int64(stmt_do, 22,
+			get_action_blockpos(row.x, row.y, row.z)));
 	} else {
 		if (!nodeMeta) {
 			SQLOK(sqlite3_bind_null(stmt_do, 10));
 			SQLOK(sqlite3_bind_null(stmt_do, 11));
 			SQLOK(sqlite3_bind_null(stmt_do, 12));
+			SQLOK(sqlite3_bind_null(stmt_do, 22));
 		}
 		SQLOK(sqlite3_bind_null(stmt_do, 13));
 		SQLOK(sqlite3_bind_null(stmt_do, 14));
@@ -460,7 +580,7 @@ bool RollbackManager::registerRow(const ActionRow & row)
 	}
 
 	if (row.id) {
-		SQLOK(sqlite3_bind_int(stmt_do, 22, row.id));
+		SQLOK(sqlite3_bind_int(stmt_do, 23, row.id));
 	}
 
 	int written = sqlite3_step(stmt_do);
@@ -471,7 +591,7 @@ bool RollbackManager::registerRow(const ActionRow & row)
 }
 
 
-const std::list<ActionRow> RollbackManager::actionRowsFromSelect(sqlite3_stmt* stmt)
+std::list<ActionRow> RollbackManager::actionRowsFromSelect(sqlite3_stmt* stmt)
 {
 	std::list<ActionRow> rows;
 	const unsigned char * text;
@@ -480,6 +600,7 @@ const std::list<ActionRow> RollbackManager::actionRowsFromSelect(sqlite3_stmt* s
 	while (sqlite3_step(stmt) == SQLITE_ROW) {
 		ActionRow row;
 
+		row.id        = sqlite3_column_int  (stmt, 21);
 		row.actor     = sqlite3_column_int  (stmt, 0);
 		row.timestamp = sqlite3_column_int64(stmt, 1);
 		row.type      = sqlite3_column_int  (stmt, 2);
@@ -638,18 +759,55 @@ const std::list<ActionRow> RollbackManager::getRowsSince(time_t firstTime, const
 const std::list<ActionRow> RollbackManager::getRowsSince_range(
 		time_t start_time, v3s16 p, int range, int limit)
 {
+	v3s16 minp(
+		rangelim(p.X - range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT),
+		rangelim(p.Y - range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT),
+		rangelim(p.Z - range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT));
+	v3s16 maxp(
+		rangelim(p.X + range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT),
+		rangelim(p.Y + range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT),
+		rangelim(p.Z + range, -MAX_MAP_GENERATION_LIMIT, MAX_MAP_GENERATION_LIMIT));
+	v3s16 bmin = getContainerPos(minp, MAP_BLOCKSIZE);
+	v3s16 bmax = getContainerPos(maxp, MAP_BLOCKSIZE);
+
+	sqlite3_bind_int64(stmt_select_range, 3, start_time);
+	sqlite3_bind_int  (stmt_select_range, 4, static_cast<int>(minp.X));
+	sqlite3_bind_int  (stmt_select_range, 5, static_cast<int>(maxp.X));
+	sqlite3_bind_int  (stmt_select_range, 6, static_cast<int>(minp.Y));
+	sqlite3_bind_int  (stmt_select_range, 7, static_cast<int>(maxp.Y));
+	sqlite3_bind_int  (stmt_select_range, 8, static_cast<int>(minp.Z));
+	sqlite3_bind_int  (stmt_select_range, 9, static_cast<int>(maxp.Z));
+	sqlite3_bind_int  (stmt_select_range, 10, limit);
+
+	// The blocks along X of one Y/Z row have consecutive keys, query each
+	// row on its own. For big ranges, query the whole key range once, the
+	// position conditions filter out the rows that are not in range.
+	s32 num_rows = (s32)(bmax.Y - bmin.Y + 1) * (bmax.Z - bmin.Z + 1);
+	if (num_rows > RANGE_QUERY_MAX_ROWS) {
+		sqlite3_bind_int64(stmt_select_range, 1,
+			MapDatabase::getBlockAsInteger(bmin));
+		sqlite3_bind_int64(stmt_select_range, 2,
+			MapDatabase::getBlockAsInteger(bmax));
+		return actionRowsFromSelect(stmt_select_range);
+	}
 
-	sqlite3_bind_int64(stmt_select_range, 1, start_time);
-	sqlite3_bind_int  (stmt_select_range, 2, static_cast<int>(p.X - range));
-	sqlite3_bind_int  (stmt_select_range, 3, static_cast<int>(p.X + range));
-	sqlite3_bind_int  (stmt_select_range, 4, static_cast<int>(p.Y - range));
-	sqlite3_bind_int  (stmt_select_range, 5, static_cast<int>(p.Y + range));
-	sqlite3_bind_int  (stmt_select_range, 6, static_cast<int>(p.Z - range));
-	sqlite3_bind_int  (stmt_select_range, 7, static_cast<int>(p.Z + range));
-	sqlite3_bind_int  (stmt_select_range, 8, limit);
+	std::list<ActionRow> rows;
+	for (s16 z = bmin.Z; z <= bmax.Z; z++)
+	for (s16 y = bmin.Y; y <= bmax.Y; y++) {
+		sqlite3_bind_int64(stmt_select_range, 1,
+			MapDatabase::getBlockAsInteger(v3s16(bmin.X, y, z)));
+		sqlite3_bind_int64(stmt_select_range, 2,
+			MapDatabase::getBlockAsInteger(v3s16(bmax.X, y, z)));
+		rows.splice(rows.end(), actionRowsFromSelect(stmt_select_range));
+	}
 
-	const std::list<ActionRow> & rows = actionRowsFromSelect(stmt_select_range);
-	sqlite3_reset(stmt_select_range);
+	// Same order and limit as a single query
+	rows.sort([] (const ActionRow &a, const ActionRow &b) {
+		return a.timestamp != b.timestamp ?
+			a.timestamp > b.timestamp : a.id > b.id;
+	});
+	if (limit >= 0 && rows.size() > (size_t)limit)
+		rows.resize(limit);
 
 	return rows;
 }
@@ -687,11 +845,6 @@ void RollbackManager::migrate(const std::string & file_path)
 
 	fh.seekg(0);
 
-	sqlite3_stmt *stmt_begin;
-	sqlite3_stmt *stmt_commit;
-	SQLOK(sqlite3_prepare_v2(db, "BEGIN", -1, &stmt_begin, NULL));
-	SQLOK(sqlite3_prepare_v2(db, "COMMIT", -1, &stmt_commit, NULL));
-
 	std::string bit;
 	int i = 0;
 	time_t start = time(0);
@@ -783,9 +936,6 @@ void RollbackManager::migrate(const std::string & file_path)
 	SQLRES(sqlite3_step(stmt_commit), SQLITE_DONE);
 	sqlite3_reset(stmt_commit);
 
-	SQLOK(sqlite3_finalize(stmt_begin));
-	SQLOK(sqlite3_finalize(stmt_commit));
-
 	std::cout
 		<< " Done: 100%                                  " << std::endl
 		<< "Now you can delete the old rollback.txt file." << std::endl;
@@ -911,49 +1061,104 @@ std::string RollbackManager::getSuspect(v3s16 p, float nearness_shortcut,
 
 void RollbackManager::flush()
 {
-	sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+	MutexAutoLock lock(m_db_mutex);
+	writeQueuedActions();
+}
 
-	std::list<RollbackAction>::const_iterator iter;
 
-	for (iter  = action_todisk_buffer.begin();
-			iter != action_todisk_buffer.end();
-			++iter) {
-		if (iter->actor.empty()) {
-			continue;
+void RollbackManager::writeQueuedActions()
+{
+	std::vector<RollbackAction> actions;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		actions.swap(action_todisk_buffer);
+	}
+	if (actions.empty())
+		return;
+
+	size_t known_actors = knownActors.size();
+	size_t known_nodes = knownNodes.size();
+
+	try {
+		SQLRES(sqlite3_step(stmt_begin), SQLITE_DONE);
+		SQLOK(sqlite3_reset(stmt_begin));
+
+		for (const RollbackAction &action : actions) {
+			if (action.actor.empty()) {
+				continue;
+			}
+
+			registerRow(actionRowFromRollbackAction(action));
 		}
 
-		registerRow(actionRowFromRollbackAction(*iter));
+		SQLRES(sqlite3_step(stmt_commit), SQLITE_DONE);
+		SQLOK(sqlite3_reset(stmt_commit));
+	} catch (BaseException &e) {
+		// Leave the statements ready for the next attempt
+		sqlite3_reset(stmt_begin);
+		sqlite3_reset(stmt_commit);
+		sqlite3_reset(stmt_insert);
+		sqlite3_reset(stmt_replace);
+		sqlite3_reset(stmt_knownActor_insert);
+		sqlite3_reset(stmt_knownNode_insert);
+
+		// Undo the partial transaction, including the actors and nodes
+		// it added
+		if (!sqlite3_get_autocommit(db)) {
+			if (sqlite3_step(stmt_rollback) != SQLITE_DONE) {
+				errorstream << "RollbackManager: Failed to roll back: "
+					<< sqlite3_errmsg(db) << std::endl;
+			}
+			sqlite3_reset(stmt_rollback);
+		}
+		knownActors.resize(known_actors);
+		knownNodes.resize(known_nodes);
+
+		// Queue the actions again, ahead of those added in the meantime
+		{
+			MutexAutoLock lock(m_queue_mutex);
+			actions.insert(actions.end(), action_todisk_buffer.begin(),
+				action_todisk_buffer.end());
+			action_todisk_buffer.swap(actions);
+		}
+		throw;
 	}
-
-	sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
-	action_todisk_buffer.clear();
 }
 
 
 void RollbackManager::addAction(const RollbackAction & action)
 {
-	action_todisk_buffer.push_back(action);
-	action_latest_buffer.push_back(action);
-
-	// Flush to disk sometimes
-	if (action_todisk_buffer.size() >= 500) {
-		flush();
+	bool wake_writer;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		action_todisk_buffer.push_back(action);
+		wake_writer = action_todisk_buffer.size() % ACTION_BATCH_SIZE == 0;
 	}
+	if (wake_writer)
+		m_writer->wake();
+
+	// getSuspect() does not look at older actions
+	action_latest_buffer.push_back(action);
+	while (action_latest_buffer.front().unix_time <
+			action.unix_time - SUSPECT_MAX_AGE)
+		action_latest_buffer.pop_front();
 }
 
 std::list<RollbackAction> RollbackManager::getEntriesSince(time_t first_time)
 {
-	flush();
+	MutexAutoLock lock(m_db_mutex);
+	writeQueuedActions();
 	return getActionsSince(first_time);
 }
 
 std::list<RollbackAction> RollbackManager::getNodeActors(v3s16 pos, int range,
 		time_t seconds, int limit)
 {
-	flush();
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
+	MutexAutoLock lock(m_db_mutex);
+	writeQueuedActions();
 	return getActionsSince_range(first_time, pos, range, limit);
 }
 
@@ -964,8 +1169,7 @@ std::list<RollbackAction> RollbackManager::getRevertActions(
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
-	flush();
-
+	MutexAutoLock lock(m_db_mutex);
+	writeQueuedActions();
 	return getActionsSince(first_time, actor_filter);
 }
-
@@ -23,10 +23,12 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irr_v3d.h"
 #include "rollback_interface.h"
 #include <list>
+#include <mutex>
 #include <vector>
 #include "sqlite3.h"
 
 class IGameDef;
+class RollbackWriterThread;
 
 struct ActionRow;
 struct Entity;
@@ -60,9 +62,12 @@ class RollbackManager: public IRollbackManager
 	const char * getActorName(const int id);
 	const char * getNodeName(const int id);
 	bool createTables();
+	void upgradeTables();
 	bool initDatabase();
+	// Writes the queued actions in one transaction, m_db_mutex must be held
+	void writeQueuedActions();
 	bool registerRow(const ActionRow & row);
-	const std::list<ActionRow> actionRowsFromSelect(sqlite3_stmt * stmt);
+	std::list<ActionRow> actionRowsFromSelect(sqlite3_stmt * stmt);
 	ActionRow actionRowFromRollbackAction(const RollbackAction & action);
 	const std::list<RollbackAction> rollbackActionsFromActionRows(
 			const std::list<ActionRow> & rows);
@@ -84,11 +89,22 @@ class RollbackManager: public IRollbackManager
 	std::string current_actor;
 	bool current_actor_is_guess = false;
 
-	std::list<RollbackAction> action_todisk_buffer;
+	// Actions waiting for the writer thread, protected by m_queue_mutex
+	std::vector<RollbackAction> action_todisk_buffer;
+	std::mutex m_queue_mutex;
+	// Recent actions for getSuspect(), only used by the server thread
 	std::list<RollbackAction> action_latest_buffer;
 
+	RollbackWriterThread *m_writer = nullptr;
+	// Protects the database, its statements and the known actors and nodes,
+	// which are used by both the writer and the server thread
+	std::mutex m_db_mutex;
+
 	std::string database_path;
 	sqlite3 * db;
+	sqlite3_stmt * stmt_begin;
+	sqlite3_stmt * stmt_commit;
+	sqlite3_stmt * stmt_rollback;
 	sqlite3_stmt * stmt_insert;
 	sqlite3_stmt * stmt_replace;
 	sqlite3_stmt * stmt_select;
@@ -32,6 +32,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "serverobject.h"
 #include "porting.h"
 #include "mapgen/mg_schematic.h"
+#include "mapgen/treegen.h"
 #include "noise.h"
 #include "util/pointedthing.h"
 #include "debug.h" // For FATAL_ERROR
@@ -1650,6 +1651,42 @@ void push_noiseparams(lua_State *L, NoiseParams *np)
 	lua_setfield(L, -2, "spread");
 }
 
+/******************************************************************************/
+void read_tree_def(lua_State *L, int index, const NodeDefManager *ndef,
+	treegen::TreeDef &tree_def)
+{
+	std::string trunk, leaves, fruit;
+
+	getstringfield(L, index, "axiom", tree_def.initial_axiom);
+	getstringfield(L, index, "rules_a", tree_def.rules_a);
+	getstringfield(L, index, "rules_b", tree_def.rules_b);
+	getstringfield(L, index, "rules_c", tree_def.rules_c);
+	getstringfield(L, index, "rules_d", tree_def.rules_d);
+	getstringfield(L, index, "trunk", trunk);
+	tree_def.trunknode = ndef->getId(trunk);
+	getstringfield(L, index, "leaves", leaves);
+	tree_def.leavesnode = ndef->getId(leaves);
+	tree_def.leaves2_chance = 0;
+	getstringfield(L, index, "leaves2", leaves);
+	if (!leaves.empty()) {
+		tree_def.leaves2node = ndef->getId(leaves);
+		getintfield(L, index, "leaves2_chance", tree_def.leaves2_chance);
+	}
+	getintfield(L, index, "angle", tree_def.angle);
+	getintfield(L, index, "iterations", tree_def.iterations);
+	if (!getintfield(L, index, "random_level", tree_def.iterations_random_level))
+		tree_def.iterations_random_level = 0;
+	getstringfield(L, index, "trunk_type", tree_def.trunk_type);
+	getboolfield(L, index, "thin_branches", tree_def.thin_branches);
+	tree_def.fruit_chance = 0;
+	getstringfield(L, index, "fruit", fruit);
+	if (!fruit.empty()) {
+		tree_def.fruitnode = ndef->getId(fruit);
+		getintfield(L, index, "fruit_chance", tree_def.fruit_chance);
+	}
+	tree_def.explicit_seed = getintfield(L, index, "seed", tree_def.seed);
+}
+
 /******************************************************************************/
 // Returns depth of json value tree
 static int push_json_value_getdepth(const Json::Value &value)
@@ -63,6 +63,7 @@ struct EnumString;
 struct NoiseParams;
 class Schematic;
 class ServerActiveObject;
+namespace treegen { struct TreeDef; }
 
 
 ContentFeatures    read_content_features     (lua_State *L, int index);
@@ -172,6 +173,10 @@ bool               read_noiseparams          (lua_State *L, int index,
                                               NoiseParams *np);
 void               push_noiseparams          (lua_State *L, NoiseParams *np);
 
+void               read_tree_def             (lua_State *L, int index,
+                                              const NodeDefManager *ndef,
+                                              treegen::TreeDef &tree_def);
+
 void               luaentity_get             (lua_State *L,u16 id);
 
 bool               push_json_value           (lua_State *L,
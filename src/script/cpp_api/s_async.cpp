@@ -31,10 +31,21 @@ extern "C" {
 #include "log.h"
 #include "filesys.h"
 #include "porting.h"
+#include "settings.h"
+#include "common/c_converter.h"
 #include "common/c_internal.h"
+#include "lua_api/l_item.h"
+#include "lua_api/l_vmanip.h"
+#include "map.h"
 
 /******************************************************************************/
 AsyncEngine::~AsyncEngine()
+{
+	stopWorkers();
+}
+
+/******************************************************************************/
+void AsyncEngine::stopWorkers()
 {
 
 	// Request all threads to stop
@@ -72,9 +83,10 @@ void AsyncEngine::registerStateInitializer(StateInitializer func)
 }
 
 /******************************************************************************/
-void AsyncEngine::initialize(unsigned int numEngines)
+void AsyncEngine::initialize(unsigned int numEngines, IGameDef *gamedef)
 {
 	initDone = true;
+	this->gamedef = gamedef;
 
 	for (unsigned int i = 0; i < numEngines; i++) {
 		AsyncWorkerThread *toAdd = new AsyncWorkerThread(this,
@@ -94,13 +106,34 @@ unsigned int AsyncEngine::queueAsyncJob(const std::string &func,
 	toAdd.serializedFunction = func;
 	toAdd.serializedParams = params;
 
-	jobQueue.push_back(toAdd);
+	unsigned int id = toAdd.id;
+	jobQueue.push_back(std::move(toAdd));
 
 	jobQueueCounter.post();
 
 	jobQueueMutex.unlock();
 
-	return toAdd.id;
+	return id;
+}
+
+/******************************************************************************/
+unsigned int AsyncEngine::queueAsyncJob(const std::string &func,
+		const std::string &params, std::vector<LuaJobObject> &&objects)
+{
+	MutexAutoLock autolock(jobQueueMutex);
+	LuaJobInfo toAdd;
+	toAdd.id = jobIdCounter++;
+	toAdd.serializedFunction = func;
+	toAdd.serializedParams = params;
+	toAdd.objects = std::move(objects);
+	toAdd.hasObjects = true;
+
+	unsigned int id = toAdd.id;
+	jobQueue.push_back(std::move(toAdd));
+
+	jobQueueCounter.post();
+
+	return id;
 }
 
 /******************************************************************************/
@@ -112,7 +145,7 @@ LuaJobInfo AsyncEngine::getJob()
 	LuaJobInfo retval;
 
 	if (!jobQueue.empty()) {
-		retval = jobQueue.front();
+		retval = std::move(jobQueue.front());
 		jobQueue.pop_front();
 		retval.valid = true;
 	}
@@ -122,10 +155,13 @@ LuaJobInfo AsyncEngine::getJob()
 }
 
 /******************************************************************************/
-void AsyncEngine::putJobResult(const LuaJobInfo &result)
+void AsyncEngine::putJobResult(LuaJobInfo &&result)
 {
+	// Objects not consumed by the job are not needed anymore
+	result.objects.clear();
+
 	resultQueueMutex.lock();
-	resultQueue.push_back(result);
+	resultQueue.push_back(std::move(result));
 	resultQueueMutex.unlock();
 }
 
@@ -134,9 +170,9 @@ void AsyncEngine::step(lua_State *L)
 {
 	int error_handler = PUSH_ERROR_HANDLER(L);
 	lua_getglobal(L, "core");
-	resultQueueMutex.lock();
+	MutexAutoLock autolock(resultQueueMutex);
 	while (!resultQueue.empty()) {
-		LuaJobInfo jobDone = resultQueue.front();
+		LuaJobInfo jobDone = std::move(resultQueue.front());
 		resultQueue.pop_front();
 
 		lua_getfield(L, -1, "async_event_handler");
@@ -150,10 +186,13 @@ void AsyncEngine::step(lua_State *L)
 		lua_pushinteger(L, jobDone.id);
 		lua_pushlstring(L, jobDone.serializedResult.data(),
 				jobDone.serializedResult.size());
+		if (jobDone.error.empty())
+			lua_pushnil(L);
+		else
+			lua_pushstring(L, jobDone.error.c_str());
 
-		PCALL_RESL(L, lua_pcall(L, 2, 0, error_handler));
+		PCALL_RESL(L, lua_pcall(L, 3, 0, error_handler));
 	}
-	resultQueueMutex.unlock();
 	lua_pop(L, 2); // Pop core and error handler
 }
 
@@ -167,7 +206,7 @@ void AsyncEngine::pushFinishedJobs(lua_State* L) {
 	int top = lua_gettop(L);
 
 	while (!resultQueue.empty()) {
-		LuaJobInfo jobDone = resultQueue.front();
+		LuaJobInfo jobDone = std::move(resultQueue.front());
 		resultQueue.pop_front();
 
 		lua_createtable(L, 0, 2);  // Pre-allocate space for two map fields
@@ -197,12 +236,20 @@ void AsyncEngine::prepareEnvironment(lua_State* L, int top)
 /******************************************************************************/
 AsyncWorkerThread::AsyncWorkerThread(AsyncEngine* jobDispatcher,
 		const std::string &name) :
-	Thread(name),
 	ScriptApiBase(ScriptingType::Async),
+	Thread(name),
 	jobDispatcher(jobDispatcher)
 {
 	lua_State *L = getStack();
 
+	// Server jobs may read the item and node definitions, and run in the
+	// same sandbox as the mods queueing them
+	if (jobDispatcher->gamedef) {
+		setGameDef(jobDispatcher->gamedef);
+		if (g_settings->getBool("secure.enable_security"))
+			initializeSecurity();
+	}
+
 	// Prepare job lua environment
 	lua_getglobal(L, "core");
 	int top = lua_gettop(L);
@@ -227,7 +274,7 @@ void* AsyncWorkerThread::run()
 
 	std::string script = getServer()->getBuiltinLuaPath() + DIR_DELIM + "init.lua";
 	try {
-		loadScript(script);
+		loadMod(script, BUILTIN_MOD_NAME);
 	} catch (const ModError &e) {
 		errorstream << "Execution of async base environment failed: "
 			<< e.what() << std::endl;
@@ -257,17 +304,49 @@ void* AsyncWorkerThread::run()
 
 		luaL_checktype(L, -1, LUA_TFUNCTION);
 
+		// Load the function here, loadstring refuses bytecode in the
+		// secure environment
+		if (luaL_loadbuffer(L, toProcess.serializedFunction.data(),
+				toProcess.serializedFunction.size(), "=(async)")) {
+			toProcess.error = readParam<std::string>(L, -1);
+			errorstream << "ASYNC WORKER: Unable to load function: "
+				<< toProcess.error << std::endl;
+			lua_pop(L, 2);  // Pop error message and job processor
+			toProcess.serializedResult = "";
+			jobDispatcher->putJobResult(std::move(toProcess));
+			continue;
+		}
+
 		// Call it
-		lua_pushlstring(L,
-				toProcess.serializedFunction.data(),
-				toProcess.serializedFunction.size());
 		lua_pushlstring(L,
 				toProcess.serializedParams.data(),
 				toProcess.serializedParams.size());
 
-		int result = lua_pcall(L, 2, 1, error_handler);
+		int nargs = 2;
+		if (toProcess.hasObjects) {
+			lua_createtable(L, toProcess.objects.size(), 0);
+			int index = 1;
+			for (LuaJobObject &object : toProcess.objects) {
+				if (object.vm) {
+					LuaVoxelManip *o = new LuaVoxelManip(object.vm.release(), false);
+					*(void **)(lua_newuserdata(L, sizeof(void *))) = o;
+					luaL_getmetatable(L, "VoxelManip");
+					lua_setmetatable(L, -2);
+				} else {
+					LuaItemStack::create(L, object.item);
+				}
+				lua_rawseti(L, -2, index++);
+			}
+			nargs++;
+		}
+
+		int result = lua_pcall(L, nargs, 1, error_handler);
 		if (result) {
-			PCALL_RES(result);
+			// Errors are reported here, a failing job must not take
+			// the worker down
+			toProcess.error = readParam<std::string>(L, -1);
+			errorstream << "ASYNC WORKER: Job failed: "
+				<< toProcess.error << std::endl;
 			toProcess.serializedResult = "";
 		} else {
 			// Fetch result
@@ -276,10 +355,10 @@ void* AsyncWorkerThread::run()
 			toProcess.serializedResult = std::string(retval, length);
 		}
 
-		lua_pop(L, 1);  // Pop retval
+		lua_pop(L, 1);  // Pop retval or error message
 
 		// Put job result
-		jobDispatcher->putJobResult(toProcess);
+		jobDispatcher->putJobResult(std::move(toProcess));
 	}
 
 	lua_pop(L, 2);  // Pop core and error handler
@@ -22,18 +22,31 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <vector>
 #include <deque>
 #include <map>
+#include <memory>
 
 #include "threading/semaphore.h"
 #include "threading/thread.h"
 #include "lua.h"
 #include "cpp_api/s_base.h"
+#include "cpp_api/s_security.h"
+#include "inventory.h"
 
 // Forward declarations
 class AsyncEngine;
+class MMVManip;
 
 
 // Declarations
 
+// Native object passed to a job without serialization
+struct LuaJobObject
+{
+	// Copy of the VoxelManip data, owned by the job until it is pushed to
+	// the async environment. Null if the object is an ItemStack.
+	std::unique_ptr<MMVManip> vm;
+	ItemStack item;
+};
+
 // Data required to queue a job
 struct LuaJobInfo
 {
@@ -43,8 +56,14 @@ struct LuaJobInfo
 	std::string serializedFunction = "";
 	// Parameter to be passed to function
 	std::string serializedParams = "";
+	// Native objects passed along with the parameters
+	std::vector<LuaJobObject> objects;
+	// Whether the objects table is passed to the job processor, even if empty
+	bool hasObjects = false;
 	// Result of function call
 	std::string serializedResult = "";
+	// Error message if the job failed, empty otherwise
+	std::string error = "";
 	// JobID used to identify a job and match it to callback
 	unsigned int id = 0;
 
@@ -52,7 +71,10 @@ struct LuaJobInfo
 };
 
 // Asynchronous working environment
-class AsyncWorkerThread : public Thread, public ScriptApiBase {
+class AsyncWorkerThread : public Thread,
+		virtual public ScriptApiBase,
+		public ScriptApiSecurity
+{
 public:
 	AsyncWorkerThread(AsyncEngine* jobDispatcher, const std::string &name);
 	virtual ~AsyncWorkerThread();
@@ -80,8 +102,15 @@ class AsyncEngine {
 	/**
 	 * Create async engine tasks and lock function registration
 	 * @param numEngines Number of async threads to be started
+	 * @param gamedef Server whose definitions the jobs may read, or nullptr.
+	 *   The worker environments are sandboxed like the server's if set.
+	 */
+	void initialize(unsigned int numEngines, IGameDef *gamedef = nullptr);
+
+	/**
+	 * Stop and delete all worker threads, pending jobs are dropped
 	 */
-	void initialize(unsigned int numEngines);
+	void stopWorkers();
 
 	/**
 	 * Queue an async job
@@ -91,6 +120,16 @@ class AsyncEngine {
 	 */
 	unsigned int queueAsyncJob(const std::string &func, const std::string &params);
 
+	/**
+	 * Queue an async job with native objects passed along
+	 * @param func Serialized lua function
+	 * @param params Serialized parameters
+	 * @param objects Objects passed to the job processor as a table
+	 * @return jobid The job is queued
+	 */
+	unsigned int queueAsyncJob(const std::string &func, const std::string &params,
+			std::vector<LuaJobObject> &&objects);
+
 	/**
 	 * Engine step to process finished jobs
 	 *   the engine step is one way to pass events back, PushFinishedJobs another
@@ -116,7 +155,7 @@ class AsyncEngine {
 	 * Put a Job result back to result queue
 	 * @param result result of completed job
 	 */
-	void putJobResult(const LuaJobInfo &result);
+	void putJobResult(LuaJobInfo &&result);
 
 	/**
 	 * Initialize environment with current registred functions
@@ -131,6 +170,9 @@ class AsyncEngine {
 	// Variable locking the engine against further modification
 	bool initDone = false;
 
+	// Game definition passed to the worker environments
+	IGameDef *gamedef = nullptr;
+
 	// Internal store for registred state initializers
 	std::vector<StateInitializer> stateInitializers;
 
@@ -244,6 +244,74 @@ bool ScriptApiEntity::luaentity_Punch(u16 id,
 	return retval;
 }
 
+// True if the entity uses the on_step of __builtin:item that the engine
+// implements natively
+bool ScriptApiEntity::luaentity_IsNativeItem(u16 id)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	// Get core.luaentities[id]
+	luaentity_get(L, id);
+	lua_getfield(L, -1, "on_step");
+	lua_getfield(L, -2, "native_on_step");
+	bool native = lua_isfunction(L, -1) && lua_rawequal(L, -1, -2);
+	lua_pop(L, 3); // Pop native_on_step, on_step and entity
+	return native;
+}
+
+float ScriptApiEntity::luaentity_GetItemAge(u16 id)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	luaentity_get(L, id);
+	lua_getfield(L, -1, "age");
+	float age = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : 0.0f;
+	lua_pop(L, 2); // Pop age and entity
+	return age;
+}
+
+void ScriptApiEntity::luaentity_SetItemAge(u16 id, float age)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	luaentity_get(L, id);
+	lua_pushnumber(L, age);
+	lua_setfield(L, -2, "age");
+	lua_pop(L, 1); // Pop entity
+}
+
+// Calls entity:merge_with_objects({ObjectRef, ...})
+void ScriptApiEntity::luaentity_MergeItems(u16 id,
+		const std::vector<ServerActiveObject *> &objects)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	int error_handler = PUSH_ERROR_HANDLER(L);
+
+	// Get core.luaentities[id]
+	luaentity_get(L, id);
+	int object = lua_gettop(L);
+	lua_getfield(L, -1, "merge_with_objects");
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 3); // Pop merge_with_objects, entity and error handler
+		return;
+	}
+	luaL_checktype(L, -1, LUA_TFUNCTION);
+	lua_pushvalue(L, object); // self
+
+	lua_createtable(L, objects.size(), 0);
+	int i = 1;
+	for (ServerActiveObject *sao : objects) {
+		objectrefGetOrCreate(L, sao);
+		lua_rawseti(L, -2, i++);
+	}
+
+	setOriginFromTable(object);
+	PCALL_RES(lua_pcall(L, 2, 0, error_handler));
+
+	lua_pop(L, 2); // Pop object and error handler
+}
+
 // Calls entity[field](ObjectRef self, ObjectRef sao)
 bool ScriptApiEntity::luaentity_run_simple_callback(u16 id,
 	ServerActiveObject *sao, const char *field)
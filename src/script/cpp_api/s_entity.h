@@ -19,6 +19,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #pragma once
 
+#include <vector>
 #include "cpp_api/s_base.h"
 #include "irr_v3d.h"
 
@@ -45,6 +46,13 @@ class ScriptApiEntity
 	void luaentity_on_attach_child(u16 id, ServerActiveObject *child);
 	void luaentity_on_detach_child(u16 id, ServerActiveObject *child);
 	void luaentity_on_detach(u16 id, ServerActiveObject *parent);
+
+	// Natively stepped item entities, see LuaEntitySAO::stepNativeItem()
+	bool luaentity_IsNativeItem(u16 id);
+	float luaentity_GetItemAge(u16 id);
+	void luaentity_SetItemAge(u16 id, float age);
+	void luaentity_MergeItems(u16 id,
+			const std::vector<ServerActiveObject *> &objects);
 private:
 	bool luaentity_run_simple_callback(u16 id, ServerActiveObject *sao,
 		const char *field);
@@ -312,7 +312,9 @@ LuaAreaStore::LuaAreaStore(const std::string &type)
 		as = new SpatialAreaStore();
 	} else
 #endif
-	{
+	if (type == "RTree") {
+		as = new RTreeAreaStore();
+	} else {
 		as = new VectorAreaStore();
 	}
 }
@@ -917,7 +917,11 @@ int ModApiEnvMod::l_find_nodes_in_area_under_air(lua_State *L)
 // returns world-specific PerlinNoise
 int ModApiEnvMod::l_get_perlin(lua_State *L)
 {
-	GET_ENV_PTR_NO_MAP_LOCK;
+	NO_MAP_LOCK_REQUIRED;
+
+	u64 world_seed;
+	if (!getWorldSeed(L, &world_seed))
+		return 0;
 
 	NoiseParams params;
 
@@ -930,7 +934,7 @@ int ModApiEnvMod::l_get_perlin(lua_State *L)
 		params.spread  = v3f(1, 1, 1) * readParam<float>(L, 4);
 	}
 
-	params.seed += (int)env->getServerMap().getSeed();
+	params.seed += (int)world_seed;
 
 	LuaPerlinNoise *n = new LuaPerlinNoise(&params);
 	*(void **)(lua_newuserdata(L, sizeof(void *))) = n;
@@ -943,14 +947,18 @@ int ModApiEnvMod::l_get_perlin(lua_State *L)
 // returns world-specific PerlinNoiseMap
 int ModApiEnvMod::l_get_perlin_map(lua_State *L)
 {
-	GET_ENV_PTR_NO_MAP_LOCK;
+	NO_MAP_LOCK_REQUIRED;
+
+	u64 world_seed;
+	if (!getWorldSeed(L, &world_seed))
+		return 0;
 
 	NoiseParams np;
 	if (!read_noiseparams(L, 1, &np))
 		return 0;
 	v3s16 size = read_v3s16(L, 2);
 
-	s32 seed = (s32)(env->getServerMap().getSeed());
+	s32 seed = (s32)world_seed;
 	LuaPerlinNoiseMap *n = new LuaPerlinNoiseMap(&np, seed, size);
 	*(void **)(lua_newuserdata(L, sizeof(void *))) = n;
 	luaL_getmetatable(L, "PerlinNoiseMap");
@@ -958,6 +966,24 @@ int ModApiEnvMod::l_get_perlin_map(lua_State *L)
 	return 1;
 }
 
+bool ModApiEnvMod::getWorldSeed(lua_State *L, u64 *seed)
+{
+	// The mapgen and async environments have no ServerEnvironment, take the
+	// seed from the mapgen parameters shared with the map instead
+	ScriptingType type = getScriptApiBase(L)->getType();
+	if (type == ScriptingType::Emerge || type == ScriptingType::Async) {
+		*seed = getServer(L)->getEmergeManager()->mgparams->seed;
+		return true;
+	}
+
+	ServerEnvironment *env = (ServerEnvironment *)getEnv(L);
+	if (!env)
+		return false;
+
+	*seed = env->getServerMap().getSeed();
+	return true;
+}
+
 // get_voxel_manip()
 // returns voxel manipulator
 int ModApiEnvMod::l_get_voxel_manip(lua_State *L)
@@ -1198,43 +1224,13 @@ int ModApiEnvMod::l_spawn_tree(lua_State *L)
 	v3s16 p0 = read_v3s16(L, 1);
 
 	treegen::TreeDef tree_def;
-	std::string trunk,leaves,fruit;
 	const NodeDefManager *ndef = env->getGameDef()->ndef();
 
-	if(lua_istable(L, 2))
-	{
-		getstringfield(L, 2, "axiom", tree_def.initial_axiom);
-		getstringfield(L, 2, "rules_a", tree_def.rules_a);
-		getstringfield(L, 2, "rules_b", tree_def.rules_b);
-		getstringfield(L, 2, "rules_c", tree_def.rules_c);
-		getstringfield(L, 2, "rules_d", tree_def.rules_d);
-		getstringfield(L, 2, "trunk", trunk);
-		tree_def.trunknode=ndef->getId(trunk);
-		getstringfield(L, 2, "leaves", leaves);
-		tree_def.leavesnode=ndef->getId(leaves);
-		tree_def.leaves2_chance=0;
-		getstringfield(L, 2, "leaves2", leaves);
-		if (!leaves.empty()) {
-			tree_def.leaves2node=ndef->getId(leaves);
-			getintfield(L, 2, "leaves2_chance", tree_def.leaves2_chance);
-		}
-		getintfield(L, 2, "angle", tree_def.angle);
-		getintfield(L, 2, "iterations", tree_def.iterations);
-		if (!getintfield(L, 2, "random_level", tree_def.iterations_random_level))
-			tree_def.iterations_random_level = 0;
-		getstringfield(L, 2, "trunk_type", tree_def.trunk_type);
-		getboolfield(L, 2, "thin_branches", tree_def.thin_branches);
-		tree_def.fruit_chance=0;
-		getstringfield(L, 2, "fruit", fruit);
-		if (!fruit.empty()) {
-			tree_def.fruitnode=ndef->getId(fruit);
-			getintfield(L, 2, "fruit_chance",tree_def.fruit_chance);
-		}
-		tree_def.explicit_seed = getintfield(L, 2, "seed", tree_def.seed);
-	}
-	else
+	if (!lua_istable(L, 2))
 		return 0;
 
+	read_tree_def(L, 2, ndef, tree_def);
+
 	treegen::error e;
 	if ((e = treegen::spawn_ltree (env, p0, ndef, tree_def)) != treegen::SUCCESS) {
 		if (e == treegen::UNBALANCED_BRACKETS) {
@@ -1327,6 +1323,12 @@ void ModApiEnvMod::Initialize(lua_State *L, int top)
 	API_FCT(forceload_free_block);
 }
 
+void ModApiEnvMod::InitializeAsync(lua_State *L, int top)
+{
+	API_FCT(get_perlin);
+	API_FCT(get_perlin_map);
+}
+
 void ModApiEnvMod::InitializeClient(lua_State *L, int top)
 {
 	API_FCT(get_timeofday);
@@ -184,8 +184,13 @@ class ModApiEnvMod : public ModApiBase {
 	// stops forceloading a position
 	static int l_forceload_free_block(lua_State *L);
 
+	// Reads the world seed, also in the mapgen and async environments.
+	// Returns false if it is not available yet.
+	static bool getWorldSeed(lua_State *L, u64 *seed);
+
 public:
 	static void Initialize(lua_State *L, int top);
+	static void InitializeAsync(lua_State *L, int top);
 	static void InitializeClient(lua_State *L, int top);
 
 	static struct EnumString es_ClearObjectsMode[];
@@ -200,17 +205,20 @@ class LuaABM : public ActiveBlockModifier {
 	float m_trigger_interval;
 	u32 m_trigger_chance;
 	bool m_simple_catch_up;
+	std::string m_label;
 public:
 	LuaABM(lua_State *L, int id,
 			const std::vector<std::string> &trigger_contents,
 			const std::vector<std::string> &required_neighbors,
-			float trigger_interval, u32 trigger_chance, bool simple_catch_up):
+			float trigger_interval, u32 trigger_chance, bool simple_catch_up,
+			const std::string &label):
 		m_id(id),
 		m_trigger_contents(trigger_contents),
 		m_required_neighbors(required_neighbors),
 		m_trigger_interval(trigger_interval),
 		m_trigger_chance(trigger_chance),
-		m_simple_catch_up(simple_catch_up)
+		m_simple_catch_up(simple_catch_up),
+		m_label(label)
 	{
 	}
 	virtual const std::vector<std::string> &getTriggerContents() const
@@ -233,6 +241,10 @@ class LuaABM : public ActiveBlockModifier {
 	{
 		return m_simple_catch_up;
 	}
+	virtual std::string getLabel()
+	{
+		return m_label;
+	}
 	virtual void trigger(ServerEnvironment *env, v3s16 p, MapNode n,
 			u32 active_object_count, u32 active_object_count_wider);
 };
@@ -639,3 +639,9 @@ void ModApiItemMod::Initialize(lua_State *L, int top)
 	API_FCT(get_content_id);
 	API_FCT(get_name_from_content_id);
 }
+
+void ModApiItemMod::InitializeAsync(lua_State *L, int top)
+{
+	API_FCT(get_content_id);
+	API_FCT(get_name_from_content_id);
+}
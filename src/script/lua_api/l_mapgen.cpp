@@ -31,6 +31,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapgen/mg_ore.h"
 #include "mapgen/mg_decoration.h"
 #include "mapgen/mg_schematic.h"
+#include "mapgen/placement_batch.h"
 #include "mapgen/mapgen_v5.h"
 #include "mapgen/mapgen_v7.h"
 #include "filesys.h"
@@ -1291,7 +1292,6 @@ int ModApiMapgen::l_register_ore(lua_State *L)
 	ore->clust_scarcity = getintfield_default(L, index, "clust_scarcity", 1);
 	ore->clust_num_ores = getintfield_default(L, index, "clust_num_ores", 1);
 	ore->clust_size     = getintfield_default(L, index, "clust_size", 0);
-	ore->noise          = NULL;
 	ore->flags          = 0;
 
 	//// Get noise_threshold
@@ -1703,6 +1703,78 @@ int ModApiMapgen::l_place_schematic_on_vmanip(lua_State *L)
 }
 
 
+// bulk_place({{pos=, schematic=, ...}, {pos=, treedef=}, ...})
+int ModApiMapgen::l_bulk_place(lua_State *L)
+{
+	MAP_LOCK_REQUIRED;
+
+	GET_ENV_PTR;
+
+	ServerMap *map = &(env->getServerMap());
+	SchematicManager *schemmgr = getServer(L)->getEmergeManager()->schemmgr;
+	const NodeDefManager *ndef = getServer(L)->getNodeDefManager();
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	PlacementBatch batch(map);
+	lua_pushnil(L);
+	while (lua_next(L, 1)) {
+		// key at index -2 and placement at index -1
+		int index = lua_gettop(L);
+		luaL_checktype(L, index, LUA_TTABLE);
+
+		lua_getfield(L, index, "pos");
+		v3s16 p = check_v3s16(L, -1);
+		lua_pop(L, 1);
+
+		lua_getfield(L, index, "treedef");
+		if (lua_istable(L, -1)) {
+			treegen::TreeDef tree_def;
+			read_tree_def(L, lua_gettop(L), ndef, tree_def);
+			batch.addTree(p, tree_def);
+			lua_pop(L, 2);
+			continue;
+		}
+		lua_pop(L, 1);
+
+		Rotation rot = (Rotation)getenumfield(L, index, "rotation",
+			es_Rotation, ROTATE_0);
+
+		bool force_placement = true;
+		getboolfield(L, index, "force_placement", force_placement);
+
+		StringMap replace_names;
+		lua_getfield(L, index, "replacements");
+		if (lua_istable(L, -1))
+			read_schematic_replacements(L, -1, &replace_names);
+		lua_pop(L, 1);
+
+		lua_getfield(L, index, "schematic");
+		Schematic *schem = get_or_load_schematic(L, -1, schemmgr, &replace_names);
+		lua_pop(L, 1);
+
+		u32 flags = 0;
+		lua_getfield(L, index, "flags");
+		read_flags(L, lua_gettop(L), flagdesc_deco, &flags, NULL);
+		lua_pop(L, 1);
+
+		if (schem)
+			batch.addSchematic(schem, p, flags, rot, force_placement);
+		else
+			errorstream << "bulk_place: failed to get schematic" << std::endl;
+
+		// removes placement, keeps key for next iteration
+		lua_pop(L, 1);
+	}
+
+	if (batch.commit() == treegen::UNBALANCED_BRACKETS)
+		luaL_error(L, "bulk_place(): closing ']' has no matching opening bracket");
+
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+
 // serialize_schematic(schematic, format, options={...})
 int ModApiMapgen::l_serialize_schematic(lua_State *L)
 {
@@ -1832,6 +1904,27 @@ int ModApiMapgen::l_read_schematic(lua_State *L)
 }
 
 
+// register_mapgen_script(path)
+int ModApiMapgen::l_register_mapgen_script(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	std::string path = luaL_checkstring(L, 1);
+	CHECK_SECURE_PATH(L, path.c_str(), false);
+
+	EmergeManager *emerge = getServer(L)->getEmergeManager();
+	if (emerge->isRunning())
+		throw LuaError("Mapgen scripts must be registered at load time");
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, CUSTOM_RIDX_CURRENT_MOD_NAME);
+	std::string modname = readParam<std::string>(L, -1, "");
+	lua_pop(L, 1);
+
+	emerge->addMapgenScript(modname, path);
+	return 0;
+}
+
+
 void ModApiMapgen::Initialize(lua_State *L, int top)
 {
 	API_FCT(get_biome_id);
@@ -1869,6 +1962,28 @@ void ModApiMapgen::Initialize(lua_State *L, int top)
 	API_FCT(create_schematic);
 	API_FCT(place_schematic);
 	API_FCT(place_schematic_on_vmanip);
+	API_FCT(bulk_place);
 	API_FCT(serialize_schematic);
 	API_FCT(read_schematic);
+
+	API_FCT(register_mapgen_script);
+}
+
+void ModApiMapgen::InitializeEmerge(lua_State *L, int top)
+{
+	API_FCT(get_biome_id);
+	API_FCT(get_biome_name);
+	API_FCT(get_heat);
+	API_FCT(get_humidity);
+	API_FCT(get_biome_data);
+	API_FCT(get_mapgen_object);
+
+	API_FCT(get_mapgen_params);
+	API_FCT(get_mapgen_setting);
+	API_FCT(get_mapgen_setting_noiseparams);
+	API_FCT(get_noiseparams);
+	API_FCT(get_decoration_id);
+
+	API_FCT(generate_ores);
+	API_FCT(generate_decorations);
 }
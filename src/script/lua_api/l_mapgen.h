@@ -128,14 +128,21 @@ class ModApiMapgen : public ModApiBase
 	//     replacements, force_placement, flagstring)
 	static int l_place_schematic_on_vmanip(lua_State *L);
 
+	// bulk_place({{pos=, schematic=, ...}, {pos=, treedef=}, ...})
+	static int l_bulk_place(lua_State *L);
+
 	// serialize_schematic(schematic, format, options={...})
 	static int l_serialize_schematic(lua_State *L);
 
 	// read_schematic(schematic, options={...})
 	static int l_read_schematic(lua_State *L);
 
+	// register_mapgen_script(path)
+	static int l_register_mapgen_script(lua_State *L);
+
 public:
 	static void Initialize(lua_State *L, int top);
+	static void InitializeEmerge(lua_State *L, int top);
 
 	static struct EnumString es_BiomeTerrainType[];
 	static struct EnumString es_DecorationType[];
@@ -22,6 +22,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/c_converter.h"
 #include "common/c_content.h"
 #include "cpp_api/s_base.h"
+#include "lua_api/l_item.h"
+#include "lua_api/l_vmanip.h"
+#include "map.h"
+#include "scripting_server.h"
 #include "server.h"
 #include "environment.h"
 #include "remoteplayer.h"
@@ -505,6 +509,63 @@ int ModApiServer::l_set_last_run_mod(lua_State *L)
 	return 0;
 }
 
+static int dump_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+	((std::string *)ud)->append((const char *)p, sz);
+	return 0;
+}
+
+static bool is_userdata_of(lua_State *L, int index, const char *tname)
+{
+	if (!lua_isuserdata(L, index) || !lua_getmetatable(L, index))
+		return false;
+	luaL_getmetatable(L, tname);
+	bool equal = lua_rawequal(L, -1, -2);
+	lua_pop(L, 2);
+	return equal;
+}
+
+// do_async_callback(func, serialized_params, ...)
+int ModApiServer::l_do_async_callback(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+
+	// Dump the function here rather than accepting bytecode from Lua,
+	// which the secure environment prohibits
+	luaL_checktype(L, 1, LUA_TFUNCTION);
+	std::string serialized_func;
+	lua_pushvalue(L, 1);
+	if (lua_dump(L, dump_writer, &serialized_func) != 0)
+		throw LuaError("do_async_callback: Unable to dump function");
+	lua_pop(L, 1);
+
+	size_t params_len;
+	const char *params = luaL_checklstring(L, 2, &params_len);
+
+	std::vector<LuaJobObject> objects;
+	int top = lua_gettop(L);
+	for (int i = 3; i <= top; i++) {
+		LuaJobObject object;
+		if (is_userdata_of(L, i, "VoxelManip")) {
+			MMVManip *vm = LuaVoxelManip::checkobject(L, i)->vm;
+			object.vm.reset(vm->clone());
+		} else if (is_userdata_of(L, i, "ItemStack")) {
+			object.item = LuaItemStack::checkobject(L, i)->getItem();
+		} else {
+			throw LuaError("do_async_callback: Only VoxelManip and ItemStack "
+				"objects can be passed natively");
+		}
+		objects.push_back(std::move(object));
+	}
+
+	ServerScripting *script = getScriptApi<ServerScripting>(L);
+	u32 jobid = script->queueAsync(serialized_func,
+			std::string(params, params_len), std::move(objects));
+
+	lua_pushinteger(L, jobid);
+	return 1;
+}
+
 void ModApiServer::Initialize(lua_State *L, int top)
 {
 	API_FCT(request_shutdown);
@@ -539,4 +600,18 @@ void ModApiServer::Initialize(lua_State *L, int top)
 
 	API_FCT(get_last_run_mod);
 	API_FCT(set_last_run_mod);
+
+	API_FCT(do_async_callback);
+}
+
+void ModApiServer::InitializeAsync(lua_State *L, int top)
+{
+	API_FCT(get_worldpath);
+	API_FCT(is_singleplayer);
+
+	API_FCT(get_current_modname);
+	API_FCT(get_modpath);
+	API_FCT(get_modnames);
+
+	API_FCT(print);
 }
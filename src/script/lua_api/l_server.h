@@ -106,6 +106,11 @@ class ModApiServer : public ModApiBase
 	// set_last_run_mod(modname)
 	static int l_set_last_run_mod(lua_State *L);
 
+	// do_async_callback(func, serialized_params, ...) -> jobid
+	// trailing VoxelManip and ItemStack arguments are copied to the job
+	static int l_do_async_callback(lua_State *L);
+
 public:
 	static void Initialize(lua_State *L, int top);
+	static void InitializeAsync(lua_State *L, int top);
 };
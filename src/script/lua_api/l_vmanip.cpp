@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "lua_api/l_internal.h"
 #include "common/c_content.h"
 #include "common/c_converter.h"
+#include "cpp_api/s_base.h"
 #include "emerge.h"
 #include "environment.h"
 #include "map.h"
@@ -43,6 +44,12 @@ int LuaVoxelManip::l_read_from_map(lua_State *L)
 {
 	MAP_LOCK_REQUIRED;
 
+	// The map can't be accessed from other threads without the env lock
+	ScriptingType type = getScriptApiBase(L)->getType();
+	if (type == ScriptingType::Emerge || type == ScriptingType::Async)
+		throw LuaError("VoxelManip:read_from_map is only available in the "
+			"main environment");
+
 	LuaVoxelManip *o = checkobject(L, 1);
 	MMVManip *vm = o->vm;
 
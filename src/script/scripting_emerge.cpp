@@ -0,0 +1,106 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "scripting_emerge.h"
+#include "server.h"
+#include "log.h"
+#include "settings.h"
+#include "cpp_api/s_internal.h"
+#include "common/c_converter.h"
+#include "lua_api/l_base.h"
+#include "lua_api/l_env.h"
+#include "lua_api/l_item.h"
+#include "lua_api/l_mapgen.h"
+#include "lua_api/l_noise.h"
+#include "lua_api/l_server.h"
+#include "lua_api/l_settings.h"
+#include "lua_api/l_util.h"
+#include "lua_api/l_vmanip.h"
+#include "mapgen/mapgen.h"
+
+extern "C" {
+#include "lualib.h"
+}
+
+EmergeScripting::EmergeScripting(Server *server):
+		ScriptApiBase(ScriptingType::Emerge)
+{
+	setGameDef(server);
+
+	SCRIPTAPI_PRECHECKHEADER
+
+	if (g_settings->getBool("secure.enable_security")) {
+		initializeSecurity();
+	}
+
+	lua_getglobal(L, "core");
+	int top = lua_gettop(L);
+
+	// Initialize our lua_api modules
+	InitializeModApi(L, top);
+	lua_pop(L, 1);
+
+	// Push builtin initialization type
+	lua_pushstring(L, "emerge");
+	lua_setglobal(L, "INIT");
+
+	infostream << "SCRIPTAPI: Initialized mapgen modules" << std::endl;
+}
+
+void EmergeScripting::InitializeModApi(lua_State *L, int top)
+{
+	// Register reference classes (userdata)
+	LuaPerlinNoise::Register(L);
+	LuaPerlinNoiseMap::Register(L);
+	LuaPseudoRandom::Register(L);
+	LuaPcgRandom::Register(L);
+	LuaSecureRandom::Register(L);
+	LuaVoxelManip::Register(L);
+	LuaSettings::Register(L);
+
+	// Initialize mod api modules
+	ModApiEnvMod::InitializeAsync(L, top);
+	ModApiItemMod::InitializeAsync(L, top);
+	ModApiMapgen::InitializeEmerge(L, top);
+	ModApiServer::InitializeAsync(L, top);
+	ModApiUtil::InitializeAsync(L, top);
+}
+
+void EmergeScripting::on_generated(Mapgen *mg, v3s16 minp, v3s16 maxp,
+	u32 blockseed)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	// Get core.registered_on_generateds
+	lua_getglobal(L, "core");
+	lua_getfield(L, -1, "registered_on_generateds");
+
+	// Changes made through the VoxelManip are written to the map together
+	// with the rest of the chunk
+	LuaVoxelManip *o = new LuaVoxelManip(mg->vm, true);
+	*(void **)(lua_newuserdata(L, sizeof(void *))) = o;
+	luaL_getmetatable(L, "VoxelManip");
+	lua_setmetatable(L, -2);
+
+	// Call callbacks
+	push_v3s16(L, minp);
+	push_v3s16(L, maxp);
+	lua_pushnumber(L, blockseed);
+	runCallbacks(4, RUN_CALLBACKS_MODE_FIRST);
+}
@@ -0,0 +1,51 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include "cpp_api/s_base.h"
+#include "cpp_api/s_security.h"
+#include "irr_v3d.h"
+
+class Mapgen;
+
+/*****************************************************************************/
+/* Scripting <-> Emerge thread Interface                                     */
+/*****************************************************************************/
+
+/*
+	Lua environment owned by a single emerge thread. It runs the scripts
+	registered with core.register_mapgen_script() and calls their
+	on_generated callbacks right after the chunk has been generated, before
+	it is handed back to the map. It has no access to the environment.
+*/
+class EmergeScripting:
+		virtual public ScriptApiBase,
+		public ScriptApiSecurity
+{
+public:
+	EmergeScripting(Server *server);
+
+	// use ScriptApiBase::loadMod() to load mods
+
+	// Called with the mapgen VoxelManip of the chunk being generated
+	void on_generated(Mapgen *mg, v3s16 minp, v3s16 maxp, u32 blockseed);
+
+private:
+	void InitializeModApi(lua_State *L, int top);
+};
@@ -122,6 +122,66 @@ void ServerScripting::InitializeModApi(lua_State *L, int top)
 	ModApiChannels::Initialize(L, top);
 }
 
+void ServerScripting::InitializeAsyncModApi(lua_State *L, int top)
+{
+	// Register reference classes (userdata)
+	LuaItemStack::Register(L);
+	LuaPerlinNoise::Register(L);
+	LuaPerlinNoiseMap::Register(L);
+	LuaPseudoRandom::Register(L);
+	LuaPcgRandom::Register(L);
+	LuaSecureRandom::Register(L);
+	LuaVoxelManip::Register(L);
+	LuaSettings::Register(L);
+
+	// Initialize mod api modules
+	ModApiEnvMod::InitializeAsync(L, top);
+	ModApiItemMod::InitializeAsync(L, top);
+	ModApiServer::InitializeAsync(L, top);
+	ModApiUtil::InitializeAsync(L, top);
+}
+
+void ServerScripting::initAsync()
+{
+	int num_threads = g_settings->getS32("num_async_threads");
+	if (num_threads <= 0)
+		num_threads = Thread::getNumberOfProcessors() - 2;
+	if (num_threads < 1)
+		num_threads = 1;
+
+	infostream << "SCRIPTAPI: Initializing async engine with "
+		<< num_threads << " threads" << std::endl;
+
+	asyncEngine.registerStateInitializer(InitializeAsyncModApi);
+	asyncEngine.initialize(num_threads, getGameDef());
+}
+
+void ServerScripting::stepAsync()
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	try {
+		asyncEngine.step(L);
+	} catch (LuaError &e) {
+		getServer()->setAsyncFatalError(
+				std::string("Async job callback: ") + e.what() + "\n"
+				+ script_get_backtrace(L));
+	}
+}
+
+void ServerScripting::stopAsync()
+{
+	asyncEngine.stopWorkers();
+}
+
+u32 ServerScripting::queueAsync(const std::string &serialized_func,
+		const std::string &serialized_params,
+		std::vector<LuaJobObject> &&objects)
+{
+	return asyncEngine.queueAsyncJob(serialized_func, serialized_params,
+			std::move(objects));
+}
+
 void log_deprecated(const std::string &message)
 {
 	log_deprecated(NULL, message);
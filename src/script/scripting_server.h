@@ -19,6 +19,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #pragma once
 #include "cpp_api/s_base.h"
+#include "cpp_api/s_async.h"
 #include "cpp_api/s_entity.h"
 #include "cpp_api/s_env.h"
 #include "cpp_api/s_inventory.h"
@@ -48,8 +49,24 @@ class ServerScripting:
 
 	// use ScriptApiBase::loadMod() to load mods
 
+	// Start the async worker threads, once mods and mapgens are set up
+	void initAsync();
+	// Pass results of finished async jobs to their callbacks
+	void stepAsync();
+	// Stop the async worker threads, before the server is torn down
+	void stopAsync();
+
+	// Pass a job to the async worker threads
+	u32 queueAsync(const std::string &serialized_func,
+			const std::string &serialized_params,
+			std::vector<LuaJobObject> &&objects);
+
 private:
 	void InitializeModApi(lua_State *L, int top);
+
+	static void InitializeAsyncModApi(lua_State *L, int top);
+
+	AsyncEngine asyncEngine;
 };
 
 void log_deprecated(const std::string &message);
@@ -61,6 +61,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/base64.h"
 #include "util/sha1.h"
 #include "util/hex.h"
+#include "threading/task_pool.h"
 #include "database/database.h"
 #include "chatmessage.h"
 #include "chat_interface.h"
@@ -289,6 +290,10 @@ Server::~Server()
 		delete m_thread;
 	}
 
+	// Async workers read the definitions deleted below
+	if (m_script)
+		m_script->stopAsync();
+
 	// Delete things in the reverse order of creation
 	delete m_emerge;
 	delete m_env;
@@ -391,6 +396,9 @@ void Server::init()
 	// Initialize mapgens
 	m_emerge->initMapgens(servermap->getMapgenParams());
 
+	// Start async workers, they read the mapgen parameters
+	m_script->initAsync();
+
 	if (g_settings->getBool("enable_rollback_recording")) {
 		// Create rollback manager
 		m_rollback = new RollbackManager(m_path_world, this);
@@ -539,6 +547,13 @@ void Server::AsyncRunStep(bool initial_step)
 		m_env->step(dtime);
 	}
 
+	{
+		MutexAutoLock lock(m_env_mutex);
+		// Run callbacks of finished async jobs
+		ScopeProfiler sp(g_profiler, "Server: async job callbacks");
+		m_script->stepAsync();
+	}
+
 	static const float map_timer_and_unload_dtime = 2.92;
 	if(m_map_timer_and_unload_interval.step(dtime, map_timer_and_unload_dtime))
 	{
@@ -588,6 +603,8 @@ void Server::AsyncRunStep(bool initial_step)
 		*/
 		if (!modified_blocks.empty()) {
 			SetBlocksNotSent(modified_blocks);
+			for (const auto &modified_block : modified_blocks)
+				m_env->markBlockChanged(modified_block.first);
 		}
 	}
 	m_clients.step(dtime);
@@ -1111,6 +1128,8 @@ void Server::setTimeOfDay(u32 time)
 
 void Server::onMapEditEvent(const MapEditEvent &event)
 {
+	m_env->onMapEditEvent(event);
+
 	if (m_ignore_map_edit_events_area.contains(event.getArea()))
 		return;
 
@@ -1517,8 +1536,7 @@ void Server::SendSpawnParticle(session_t peer_id, u16 protocol_version,
 				bool vertical, const std::string &texture,
 				const struct TileAnimationParams &animation, u8 glow)
 {
-	static thread_local const float radius =
-			g_settings->getS16("max_block_send_distance") * MAP_BLOCKSIZE * BS;
+	const float radius = m_max_block_send_distance * MAP_BLOCKSIZE * BS;
 
 	if (peer_id == PEER_ID_INEXISTENT) {
 		std::vector<session_t> clients = m_clients.getClientIDs();
@@ -1861,16 +1879,12 @@ void Server::SendPlayerFormspecPrepend(session_t peer_id)
 void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersao)
 {
 	// Radius inside which objects are active
-	static thread_local const s16 radius =
-		g_settings->getS16("active_object_send_range_blocks") * MAP_BLOCKSIZE;
+	const s16 radius = m_active_object_send_range * MAP_BLOCKSIZE;
 
 	// Radius inside which players are active
-	static thread_local const bool is_transfer_limited =
-		g_settings->exists("unlimited_player_transfer_distance") &&
-		!g_settings->getBool("unlimited_player_transfer_distance");
+	const bool is_transfer_limited = !m_unlimited_player_transfer_distance;
 
-	static thread_local const s16 player_transfer_dist =
-		g_settings->getS16("player_transfer_distance") * MAP_BLOCKSIZE;
+	const s16 player_transfer_dist = m_player_transfer_distance * MAP_BLOCKSIZE;
 
 	s16 player_radius = player_transfer_dist == 0 && is_transfer_limited ?
 		radius : player_transfer_dist;
@@ -2309,8 +2323,8 @@ void Server::SendBlocks(float dtime)
 
 	// Maximal total count calculation
 	// The per-client block sends is halved with the maximal online users
-	u32 max_blocks_to_send = (m_env->getPlayerCount() + g_settings->getU32("max_users")) *
-		g_settings->getU32("max_simultaneous_block_sends_per_client") / 4 + 1;
+	u32 max_blocks_to_send = (m_env->getPlayerCount() + m_max_users) *
+		m_max_simultaneous_block_sends / 4 + 1;
 
 	ScopeProfiler sp(g_profiler, "Server::SendBlocks(): Send to clients");
 	Map &map = m_env->getMap();
@@ -2356,6 +2370,85 @@ bool Server::SendBlock(session_t peer_id, const v3s16 &blockpos)
 	return true;
 }
 
+// Reads a media file and computes its SHA1 digest
+static bool hashMediaFile(const std::string &filepath, std::string *digest)
+{
+	std::ifstream fis(filepath.c_str(), std::ios_base::binary);
+	if (!fis.good()) {
+		errorstream << "Server::fillMediaCache(): Could not open \""
+				<< filepath << "\" for reading" << std::endl;
+		return false;
+	}
+	std::ostringstream tmp_os(std::ios_base::binary);
+	bool bad = false;
+	for(;;) {
+		char buf[1024];
+		fis.read(buf, 1024);
+		std::streamsize len = fis.gcount();
+		tmp_os.write(buf, len);
+		if (fis.eof())
+			break;
+		if (!fis.good()) {
+			bad = true;
+			break;
+		}
+	}
+	if(bad) {
+		errorstream<<"Server::fillMediaCache(): Failed to read \""
+				<< filepath << "\"" << std::endl;
+		return false;
+	}
+	if(tmp_os.str().length() == 0) {
+		errorstream << "Server::fillMediaCache(): Empty file \""
+				<< filepath << "\"" << std::endl;
+		return false;
+	}
+
+	SHA1 sha1;
+	sha1.addBytes(tmp_os.str().c_str(), tmp_os.str().length());
+
+	unsigned char *raw = sha1.getDigest();
+	digest->assign((char *)raw, 20);
+	free(raw);
+	return true;
+}
+
+struct MediaHashCacheEntry
+{
+	u64 size;
+	u64 mtime;
+	std::string digest;
+};
+
+/*
+	Checksums of the media files of the last start, one file per line:
+	"<size> <mtime> <base64 digest> <path>"
+*/
+static std::string getMediaHashCachePath()
+{
+	return porting::path_cache + DIR_DELIM + "media_hashes.txt";
+}
+
+static void readMediaHashCache(
+		std::unordered_map<std::string, MediaHashCacheEntry> &cache)
+{
+	std::ifstream is(getMediaHashCachePath().c_str(), std::ios_base::binary);
+	std::string line;
+	while (std::getline(is, line)) {
+		std::istringstream iss(line);
+		MediaHashCacheEntry entry;
+		std::string digest_base64, path;
+		iss >> entry.size >> entry.mtime >> digest_base64;
+		iss.get(); // Space before the path, which may contain spaces itself
+		std::getline(iss, path);
+		if (iss.fail() || path.empty() || !base64_is_valid(digest_base64))
+			continue;
+		entry.digest = base64_decode(digest_base64);
+		if (entry.digest.size() == 20)
+			cache[path] = entry;
+	}
+}
+
 void Server::fillMediaCache()
 {
 	infostream<<"Server: Calculating media file checksums"<<std::endl;
@@ -2366,7 +2459,18 @@ void Server::fillMediaCache()
 	fs::GetRecursiveDirs(paths, m_gamespec.path + DIR_DELIM + "textures");
 	fs::GetRecursiveDirs(paths, porting::path_user + DIR_DELIM + "textures" + DIR_DELIM + "server");
 
-	// Collect media file information from paths into cache
+	struct MediaFile
+	{
+		std::string name;
+		std::string path;
+		u64 size = 0;
+		u64 mtime = 0;
+		// Raw SHA1 digest, empty if the file could not be read
+		std::string digest;
+	};
+	std::vector<MediaFile> files;
+
+	// Collect media files from paths
 	for (const std::string &mediapath : paths) {
 		std::vector<fs::DirListNode> dirlist = fs::GetDirListing(mediapath);
 		for (const fs::DirListNode &dln : dirlist) {
@@ -2394,55 +2498,68 @@ void Server::fillMediaCache()
 						<< filename << "\"" << std::endl;
 				continue;
 			}
-			// Ok, attempt to load the file and add to cache
-			std::string filepath;
-			filepath.append(mediapath).append(DIR_DELIM).append(filename);
-
-			// Read data
-			std::ifstream fis(filepath.c_str(), std::ios_base::binary);
-			if (!fis.good()) {
-				errorstream << "Server::fillMediaCache(): Could not open \""
-						<< filename << "\" for reading" << std::endl;
-				continue;
-			}
-			std::ostringstream tmp_os(std::ios_base::binary);
-			bool bad = false;
-			for(;;) {
-				char buf[1024];
-				fis.read(buf, 1024);
-				std::streamsize len = fis.gcount();
-				tmp_os.write(buf, len);
-				if (fis.eof())
-					break;
-				if (!fis.good()) {
-					bad = true;
-					break;
-				}
-			}
-			if(bad) {
-				errorstream<<"Server::fillMediaCache(): Failed to read \""
-						<< filename << "\"" << std::endl;
-				continue;
-			}
-			if(tmp_os.str().length() == 0) {
-				errorstream << "Server::fillMediaCache(): Empty file \""
-						<< filepath << "\"" << std::endl;
+			MediaFile file;
+			file.name = filename;
+			file.path.append(mediapath).append(DIR_DELIM).append(filename);
+			files.push_back(file);
+		}
+	}
+
+	// Reuse the checksums of files that did not change since the last start
+	std::unordered_map<std::string, MediaHashCacheEntry> cache;
+	readMediaHashCache(cache);
+
+	std::vector<u32> to_hash;
+	for (u32 i = 0; i < files.size(); i++) {
+		MediaFile &file = files[i];
+		if (fs::GetFileInfo(file.path, &file.size, &file.mtime)) {
+			auto it = cache.find(file.path);
+			if (it != cache.end() && it->second.size == file.size &&
+					it->second.mtime == file.mtime) {
+				file.digest = it->second.digest;
 				continue;
 			}
+		}
+		to_hash.push_back(i);
+	}
+
+	// Read and hash all other files in parallel
+	if (!to_hash.empty()) {
+		unsigned int num_threads = MYMIN(MYMAX(Thread::getNumberOfProcessors(), 1U),
+			(unsigned int)to_hash.size()) - 1;
+		TaskPool pool("MediaHash", num_threads);
+		pool.run(to_hash.size(), [&files, &to_hash] (unsigned int i) {
+			MediaFile &file = files[to_hash[i]];
+			if (!hashMediaFile(file.path, &file.digest))
+				file.digest.clear();
+		});
+	}
+	infostream << "Server: Hashed " << to_hash.size() << " of "
+			<< files.size() << " media files" << std::endl;
+
+	// Put in list, later paths override earlier ones of the same name
+	std::ostringstream cache_os(std::ios_base::binary);
+	size_t num_cached = 0;
+	for (const MediaFile &file : files) {
+		if (file.digest.empty())
+			continue;
 
-			SHA1 sha1;
-			sha1.addBytes(tmp_os.str().c_str(), tmp_os.str().length());
+		std::string sha1_base64 = base64_encode(
+			(const unsigned char *)file.digest.c_str(), 20);
+		m_media[file.name] = MediaInfo(file.path, sha1_base64);
+		verbosestream << "Server: " << hex_encode(file.digest) << " is "
+				<< file.name << std::endl;
 
-			unsigned char *digest = sha1.getDigest();
-			std::string sha1_base64 = base64_encode(digest, 20);
-			std::string sha1_hex = hex_encode((char*)digest, 20);
-			free(digest);
+		cache_os << file.size << " " << file.mtime << " " << sha1_base64
+				<< " " << file.path << "\n";
+		num_cached++;
+	}
 
-			// Put in list
-			m_media[filename] = MediaInfo(filepath, sha1_base64);
-			verbosestream << "Server: " << sha1_hex << " is " << filename
+	if (!to_hash.empty() || cache.size() != num_cached) {
+		if (!fs::CreateAllDirs(porting::path_cache) ||
+				!fs::safeWriteToFile(getMediaHashCachePath(), cache_os.str()))
+			warningstream << "Server: Failed to write media hash cache"
 					<< std::endl;
-		}
 	}
 }
 
@@ -2588,11 +2705,29 @@ void Server::sendRequestedMedia(session_t peer_id,
 	}
 }
 
-void Server::sendDetachedInventory(const std::string &name, session_t peer_id)
+static void putDetachedInventory(NetworkPacket &pkt, const Inventory *inv,
+		bool incremental)
+{
+	pkt << true; // Update inventory
+
+	// Serialization & NetworkPacket isn't a love story
+	std::ostringstream os(std::ios_base::binary);
+	inv->serialize(os, incremental);
+
+	const std::string &os_str = os.str();
+	pkt << static_cast<u16>(os_str.size()); // HACK: to keep compatibility with 5.0.0 clients
+	pkt.putRawString(os_str);
+}
+
+void Server::sendDetachedInventory(const std::string &name, session_t peer_id,
+		bool incremental)
 {
 	const auto &inv_it = m_detached_inventories.find(name);
 	const auto &player_it = m_detached_inventories_player.find(name);
 
+	// Whether every client that knows the inventory gets this update
+	bool reaches_all = peer_id == PEER_ID_INEXISTENT;
+
 	if (player_it == m_detached_inventories_player.end() ||
 			player_it->second.empty()) {
 		// OK. Send to everyone
@@ -2608,6 +2743,7 @@ void Server::sendDetachedInventory(const std::string &name, session_t peer_id)
 			return; // Caller requested send to a different player, so don't send.
 
 		peer_id = p->getPeerId();
+		reaches_all = true;
 	}
 
 	NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
@@ -2615,23 +2751,39 @@ void Server::sendDetachedInventory(const std::string &name, session_t peer_id)
 
 	if (inv_it == m_detached_inventories.end()) {
 		pkt << false; // Remove inventory
-	} else {
-		pkt << true; // Update inventory
 
-		// Serialization & NetworkPacket isn't a love story
-		std::ostringstream os(std::ios_base::binary);
-		inv_it->second->serialize(os);
-		inv_it->second->setModified(false);
-
-		const std::string &os_str = os.str();
-		pkt << static_cast<u16>(os_str.size()); // HACK: to keep compatibility with 5.0.0 clients
-		pkt.putRawString(os_str);
+		if (peer_id == PEER_ID_INEXISTENT)
+			m_clients.sendToAll(&pkt);
+		else
+			Send(&pkt);
+		return;
 	}
 
-	if (peer_id == PEER_ID_INEXISTENT)
+	Inventory *inv = inv_it->second;
+
+	// Unchanged slots may only be skipped if all recipients got every
+	// previous update
+	incremental &= reaches_all;
+	if (incremental && peer_id != PEER_ID_INEXISTENT)
+		incremental = m_clients.getProtocolVersion(peer_id) >= 38;
+
+	putDetachedInventory(pkt, inv, incremental);
+
+	if (peer_id == PEER_ID_INEXISTENT && incremental) {
+		// Serialize once per format, older clients get the full inventory
+		NetworkPacket legacypkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
+		legacypkt << name;
+		putDetachedInventory(legacypkt, inv, false);
+		m_clients.sendToAllCompat(&pkt, &legacypkt, 38);
+	} else if (peer_id == PEER_ID_INEXISTENT) {
 		m_clients.sendToAll(&pkt);
-	else
+	} else {
 		Send(&pkt);
+	}
+
+	// A full copy sent to a single client leaves the others behind
+	if (reaches_all)
+		inv->setModified(false);
 }
 
 void Server::sendDetachedInventories(session_t peer_id, bool incremental)
@@ -2644,7 +2796,7 @@ void Server::sendDetachedInventories(session_t peer_id, bool incremental)
 				continue;
 		}
 
-		sendDetachedInventory(name, peer_id);
+		sendDetachedInventory(name, peer_id, incremental);
 	}
 }
 
@@ -445,7 +445,8 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	void sendRequestedMedia(session_t peer_id,
 			const std::vector<std::string> &tosend);
 
-	void sendDetachedInventory(const std::string &name, session_t peer_id);
+	void sendDetachedInventory(const std::string &name, session_t peer_id,
+			bool incremental = false);
 
 	// Adds a ParticleSpawner on peer with peer_id (PEER_ID_INEXISTENT == all)
 	void SendAddParticleSpawner(session_t peer_id, u16 protocol_version,
@@ -663,6 +664,17 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	u64 m_csm_restriction_flags = CSMRestrictionFlags::CSM_RF_NONE;
 	u32 m_csm_restriction_noderange = 8;
 
+	// Settings read every step
+	SettingHandle<u32> m_max_users{"max_users"};
+	SettingHandle<u32> m_max_simultaneous_block_sends{
+		"max_simultaneous_block_sends_per_client"};
+	SettingHandle<s16> m_max_block_send_distance{"max_block_send_distance"};
+	SettingHandle<s16> m_active_object_send_range{
+		"active_object_send_range_blocks"};
+	SettingHandle<s16> m_player_transfer_distance{"player_transfer_distance"};
+	SettingHandle<bool> m_unlimited_player_transfer_distance{
+		"unlimited_player_transfer_distance", g_settings, true};
+
 	// ModChannel manager
 	std::unique_ptr<ModChannelMgr> m_modchannel_mgr;
 };
@@ -18,6 +18,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include <log.h>
+#include <cmath>
+#include <unordered_map>
 #include "mapblock.h"
 #include "profiler.h"
 #include "activeobjectmgr.h"
@@ -125,6 +127,50 @@ void ActiveObjectMgr::getObjectsInsideRadius(
 	}
 }
 
+void ActiveObjectMgr::getObjectsInsideRadius(const std::vector<v3f> &positions,
+		float radius, std::vector<std::vector<u16>> &results)
+{
+	results.clear();
+	results.resize(positions.size());
+	if (positions.empty())
+		return;
+
+	// Bucket the positions into cells as large as the radius, so that each
+	// object only needs to be tested against the 27 surrounding cells.
+	// Cell coordinates are packed with 21 bits each, wrapping doesn't
+	// matter as the distance is checked anyway.
+	auto cell_key = [] (s32 x, s32 y, s32 z) {
+		return ((u64)(x & 0x1FFFFF) << 42) | ((u64)(y & 0x1FFFFF) << 21) |
+				(u64)(z & 0x1FFFFF);
+	};
+	auto get_cell = [radius] (const v3f &p) {
+		return v3s32(std::floor(p.X / radius), std::floor(p.Y / radius),
+				std::floor(p.Z / radius));
+	};
+	std::unordered_map<u64, std::vector<u32>> cells;
+	for (u32 i = 0; i < positions.size(); i++) {
+		v3s32 c = get_cell(positions[i]);
+		cells[cell_key(c.X, c.Y, c.Z)].push_back(i);
+	}
+
+	float r2 = radius * radius;
+	for (auto &activeObject : m_active_objects) {
+		const v3f &objectpos = activeObject.second->getBasePosition();
+		v3s32 c = get_cell(objectpos);
+		for (s32 z = c.Z - 1; z <= c.Z + 1; z++)
+		for (s32 y = c.Y - 1; y <= c.Y + 1; y++)
+		for (s32 x = c.X - 1; x <= c.X + 1; x++) {
+			auto it = cells.find(cell_key(x, y, z));
+			if (it == cells.end())
+				continue;
+			for (u32 i : it->second) {
+				if (objectpos.getDistanceFromSQ(positions[i]) <= r2)
+					results[i].push_back(activeObject.first);
+			}
+		}
+	}
+}
+
 void ActiveObjectMgr::getAddedActiveObjectsAroundPos(const v3f &player_pos, f32 radius,
 		f32 player_radius, std::set<u16> &current_objects,
 		std::queue<u16> &added_objects)
@@ -38,6 +38,11 @@ class ActiveObjectMgr : public ::ActiveObjectMgr<ServerActiveObject>
 	void getObjectsInsideRadius(
 			const v3f &pos, float radius, std::vector<u16> &result);
 
+	// Same as getObjectsInsideRadius for many positions at once, with a
+	// single pass over the objects. results[i] belongs to positions[i].
+	void getObjectsInsideRadius(const std::vector<v3f> &positions,
+			float radius, std::vector<std::vector<u16>> &results);
+
 	void getAddedActiveObjectsAroundPos(const v3f &player_pos, f32 radius,
 			f32 player_radius, std::set<u16> &current_objects,
 			std::queue<u16> &added_objects);
@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "nodemetadata.h"
 #include "gamedef.h"
 #include "map.h"
+#include "pathfinder.h"
 #include "porting.h"
 #include "profiler.h"
 #include "raycast.h"
@@ -45,6 +46,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "database/database-postgresql.h"
 #endif
 #include <algorithm>
+#include <cmath>
 
 #define LBM_NAME_ALLOWED_CHARS "abcdefghijklmnopqrstuvwxyz0123456789_:"
 
@@ -287,27 +289,12 @@ void LBMManager::applyLBMs(ServerEnvironment *env, MapBlock *block, u32 stamp)
 	ActiveBlockList
 */
 
-void fillRadiusBlock(v3s16 p0, s16 r, std::set<v3s16> &list)
-{
-	v3s16 p;
-	for(p.X=p0.X-r; p.X<=p0.X+r; p.X++)
-		for(p.Y=p0.Y-r; p.Y<=p0.Y+r; p.Y++)
-			for(p.Z=p0.Z-r; p.Z<=p0.Z+r; p.Z++)
-			{
-				// limit to a sphere
-				if (p.getDistanceFrom(p0) <= r) {
-					// Set in list
-					list.insert(p);
-				}
-			}
-}
-
 void fillViewConeBlock(v3s16 p0,
 	const s16 r,
 	const v3f camera_pos,
 	const v3f camera_dir,
 	const float camera_fov,
-	std::set<v3s16> &list)
+	std::vector<v3s16> &list)
 {
 	v3s16 p;
 	const s16 r_nodes = r * BS * MAP_BLOCKSIZE;
@@ -315,69 +302,195 @@ void fillViewConeBlock(v3s16 p0,
 	for (p.Y = p0.Y - r; p.Y <= p0.Y+r; p.Y++)
 	for (p.Z = p0.Z - r; p.Z <= p0.Z+r; p.Z++) {
 		if (isBlockInSight(p, camera_pos, camera_dir, camera_fov, r_nodes)) {
-			list.insert(p);
+			list.push_back(p);
 		}
 	}
 }
 
+const std::vector<v3s16> &ActiveBlockList::getSphereOffsets(s16 radius)
+{
+	if (radius == m_sphere_radius)
+		return m_sphere_offsets;
+
+	m_sphere_offsets.clear();
+	m_sphere_radius = radius;
+	v3s16 p;
+	for (p.X = -radius; p.X <= radius; p.X++)
+	for (p.Y = -radius; p.Y <= radius; p.Y++)
+	for (p.Z = -radius; p.Z <= radius; p.Z++) {
+		// limit to a sphere
+		if (p.getDistanceFrom(v3s16(0, 0, 0)) <= radius)
+			m_sphere_offsets.push_back(p);
+	}
+	return m_sphere_offsets;
+}
+
+void ActiveBlockList::addRef(v3s16 p, bool abm)
+{
+	m_refs[p]++;
+	if (abm)
+		m_abm_refs[p]++;
+	m_touched.push_back(p);
+}
+
+void ActiveBlockList::removeRef(v3s16 p, bool abm)
+{
+	auto it = m_refs.find(p);
+	if (--it->second == 0)
+		m_refs.erase(it);
+	if (abm) {
+		it = m_abm_refs.find(p);
+		if (--it->second == 0)
+			m_abm_refs.erase(it);
+	}
+	m_touched.push_back(p);
+}
+
+void ActiveBlockList::addSphere(v3s16 center, s16 radius)
+{
+	for (const v3s16 &offset : getSphereOffsets(radius))
+		addRef(center + offset, true);
+}
+
+void ActiveBlockList::removeSphere(v3s16 center, s16 radius)
+{
+	for (const v3s16 &offset : getSphereOffsets(radius))
+		removeRef(center + offset, true);
+}
+
 void ActiveBlockList::update(std::vector<PlayerSAO*> &active_players,
 	s16 active_block_range,
 	s16 active_object_range,
 	std::set<v3s16> &blocks_removed,
 	std::set<v3s16> &blocks_added)
 {
+	// Blocks that failed to load are checked again
+	m_touched.swap(m_unloaded);
+	m_unloaded.clear();
+
 	/*
-		Create the new list
+		Update the areas of the players
 	*/
-	std::set<v3s16> newlist = m_forceloaded_list;
-	m_abm_list = m_forceloaded_list;
+	for (auto &it : m_players)
+		it.second.seen = false;
+
 	for (const PlayerSAO *playersao : active_players) {
+		PlayerArea &area = m_players[playersao->getId()];
+		area.seen = true;
+
 		v3s16 pos = getNodeBlockPos(floatToInt(playersao->getBasePosition(), BS));
-		fillRadiusBlock(pos, active_block_range, m_abm_list);
-		fillRadiusBlock(pos, active_block_range, newlist);
+		bool moved = pos != area.center || active_block_range != area.radius;
+		if (moved) {
+			if (area.radius >= 0)
+				removeSphere(area.center, area.radius);
+			addSphere(pos, active_block_range);
+		}
 
 		s16 player_ao_range = std::min(active_object_range, playersao->getWantedRange());
 		// only do this if this would add blocks
-		if (player_ao_range > active_block_range) {
+		if (player_ao_range <= active_block_range) {
+			for (const v3s16 &p : area.cone)
+				removeRef(p, false);
+			area.cone.clear();
+			area.cone_range = 0;
+		} else if (moved || player_ao_range != area.cone_range ||
+				std::fabs(playersao->getLookPitch() - area.cone_pitch) > 1.0f ||
+				std::fabs(playersao->getRotation().Y - area.cone_yaw) > 1.0f ||
+				playersao->getFov() != area.cone_fov) {
+			// The camera turned noticeably, recompute the view cone
+			area.cone_range = player_ao_range;
+			area.cone_pitch = playersao->getLookPitch();
+			area.cone_yaw = playersao->getRotation().Y;
+			area.cone_fov = playersao->getFov();
+
 			v3f camera_dir = v3f(0,0,1);
-			camera_dir.rotateYZBy(playersao->getLookPitch());
-			camera_dir.rotateXZBy(playersao->getRotation().Y);
+			camera_dir.rotateYZBy(area.cone_pitch);
+			camera_dir.rotateXZBy(area.cone_yaw);
+			std::vector<v3s16> cone;
 			fillViewConeBlock(pos,
 				player_ao_range,
 				playersao->getEyePosition(),
 				camera_dir,
-				playersao->getFov(),
-				newlist);
+				area.cone_fov,
+				cone);
+
+			// Add first so that blocks in both cones keep their reference
+			for (const v3s16 &p : cone)
+				addRef(p, false);
+			for (const v3s16 &p : area.cone)
+				removeRef(p, false);
+			area.cone.swap(cone);
+		}
+
+		area.center = pos;
+		area.radius = active_block_range;
+	}
+
+	// Players that left or died
+	for (auto it = m_players.begin(); it != m_players.end();) {
+		PlayerArea &area = it->second;
+		if (area.seen) {
+			++it;
+			continue;
 		}
+		removeSphere(area.center, area.radius);
+		for (const v3s16 &p : area.cone)
+			removeRef(p, false);
+		it = m_players.erase(it);
 	}
 
 	/*
-		Find out which blocks on the old list are not on the new list
+		Update the forceloaded blocks
 	*/
-	// Go through old list
-	for (v3s16 p : m_list) {
-		// If not on new list, it's been removed
-		if (newlist.find(p) == newlist.end())
-			blocks_removed.insert(p);
+	for (const v3s16 &p : m_forceloaded_applied) {
+		if (m_forceloaded_list.find(p) == m_forceloaded_list.end())
+			removeRef(p, true);
+	}
+	for (const v3s16 &p : m_forceloaded_list) {
+		if (m_forceloaded_applied.find(p) == m_forceloaded_applied.end())
+			addRef(p, true);
 	}
+	m_forceloaded_applied = m_forceloaded_list;
 
 	/*
-		Find out which blocks on the new list are not on the old list
+		Apply the changed blocks to the lists
 	*/
-	// Go through new list
-	for (v3s16 p : newlist) {
-		// If not on old list, it's been added
-		if(m_list.find(p) == m_list.end())
+	for (const v3s16 &p : m_touched) {
+		bool active = m_refs.find(p) != m_refs.end();
+		bool listed = m_list.find(p) != m_list.end();
+		if (active && !listed) {
+			m_list.insert(p);
 			blocks_added.insert(p);
+		} else if (!active && listed) {
+			m_list.erase(p);
+			blocks_removed.insert(p);
+		}
+
+		if (active && m_abm_refs.find(p) != m_abm_refs.end())
+			m_abm_list.insert(p);
+		else
+			m_abm_list.erase(p);
 	}
+	m_touched.clear();
+}
 
-	/*
-		Update m_list
-	*/
+void ActiveBlockList::removeUnloaded(v3s16 p)
+{
+	m_list.erase(p);
+	m_abm_list.erase(p);
+	m_unloaded.push_back(p);
+}
+
+void ActiveBlockList::clear()
+{
 	m_list.clear();
-	for (v3s16 p : newlist) {
-		m_list.insert(p);
-	}
+	m_abm_list.clear();
+	m_refs.clear();
+	m_abm_refs.clear();
+	m_players.clear();
+	m_forceloaded_applied.clear();
+	m_touched.clear();
+	m_unloaded.clear();
 }
 
 /*
@@ -456,6 +569,9 @@ ServerEnvironment::ServerEnvironment(ServerMap *map,
 
 	m_player_database = openPlayerDatabase(player_backend_name, path_world, conf);
 	m_auth_database = openAuthDatabase(auth_backend_name, path_world, conf);
+
+	m_pathfinder_cache = new PathfinderCache(server->ndef());
+	m_map->addEventReceiver(m_pathfinder_cache);
 }
 
 ServerEnvironment::~ServerEnvironment()
@@ -468,7 +584,9 @@ ServerEnvironment::~ServerEnvironment()
 	deactivateFarObjects(true);
 
 	// Drop/delete map
+	m_map->removeEventReceiver(m_pathfinder_cache);
 	m_map->drop();
+	delete m_pathfinder_cache;
 
 	// Delete ActiveBlockModifiers
 	for (ABMWithState &m_abm : m_abms) {
@@ -735,6 +853,7 @@ void ServerEnvironment::loadDefaultMeta()
 struct ActiveABM
 {
 	ActiveBlockModifier *abm;
+	ABMWithState *state;
 	int chance;
 	std::vector<content_t> required_neighbors;
 	bool check_required_neighbors; // false if required_neighbors is known to be empty
@@ -745,6 +864,7 @@ class ABMHandler
 private:
 	ServerEnvironment *m_env;
 	std::vector<std::vector<ActiveABM> *> m_aabms;
+	std::vector<ABMWithState *> m_abms_due;
 public:
 	ABMHandler(std::vector<ABMWithState> &abms,
 		float dtime_s, ServerEnvironment *env,
@@ -760,20 +880,26 @@ class ABMHandler
 			if(trigger_interval < 0.001)
 				trigger_interval = 0.001;
 			float actual_interval = dtime_s;
+			float coverage = 1.0f;
 			if(use_timers){
 				abmws.timer += dtime_s;
 				if(abmws.timer < trigger_interval)
 					continue;
 				abmws.timer -= trigger_interval;
 				actual_interval = trigger_interval;
+				coverage = abmws.coverage;
+				abmws.trigger_count = 0;
+				m_abms_due.push_back(&abmws);
 			}
 			float chance = abm->getTriggerChance();
 			if(chance == 0)
 				chance = 1;
 			ActiveABM aabm;
 			aabm.abm = abm;
+			aabm.state = &abmws;
 			if (abm->getSimpleCatchUp()) {
-				float intervals = actual_interval / trigger_interval;
+				// Make up for the blocks not reached in the last round
+				float intervals = actual_interval / trigger_interval / coverage;
 				if(intervals == 0)
 					continue;
 				aabm.chance = chance / intervals;
@@ -813,6 +939,12 @@ class ABMHandler
 			delete aabms;
 	}
 
+	// ABMs whose timer elapsed for this round
+	const std::vector<ABMWithState *> &getDueABMs() const
+	{
+		return m_abms_due;
+	}
+
 	// Find out how many objects the given block and its neighbours contain.
 	// Returns the number of objects in the block, and also in 'wider' the
 	// number of objects in the block and all its neighbours. The latter
@@ -926,6 +1058,7 @@ class ABMHandler
 				neighbor_found:
 
 				abms_run++;
+				aabm.state->trigger_count++;
 				// Call all the trigger variations
 				aabm.abm->trigger(m_env, p, n);
 				aabm.abm->trigger(m_env, p, n,
@@ -980,9 +1113,12 @@ void ServerEnvironment::activateBlock(MapBlock *block, u32 additional_dtime)
 	/* Handle LoadingBlockModifiers */
 	m_lbm_mgr.applyLBMs(this, block, stamp);
 
-	// Run node timers
+	// Run node timers, timers of active blocks follow the scheduler
+	block->m_node_timers.detach();
 	std::vector<NodeTimer> elapsed_timers =
 		block->m_node_timers.step((float)dtime_s);
+	if (m_active_blocks.contains(block->getPos()))
+		block->m_node_timers.attach(&m_node_timer_scheduler, block->getPos());
 	if (!elapsed_timers.empty()) {
 		MapNode n;
 		for (const NodeTimer &elapsed_timer : elapsed_timers) {
@@ -1201,6 +1337,10 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 void ServerEnvironment::step(float dtime)
 {
 	ScopeProfiler sp2(g_profiler, "ServerEnv::step()", SPT_AVG);
+
+	// Nodes may have been changed without map events since the last step
+	m_pathfinder_cache->clear();
+
 	/* Step time of day */
 	stepTimeOfDay(dtime);
 
@@ -1261,14 +1401,10 @@ void ServerEnvironment::step(float dtime)
 		*/
 		// use active_object_send_range_blocks since that is max distance
 		// for active objects sent the client anyway
-		static thread_local const s16 active_object_range =
-				g_settings->getS16("active_object_send_range_blocks");
-		static thread_local const s16 active_block_range =
-				g_settings->getS16("active_block_range");
 		std::set<v3s16> blocks_removed;
 		std::set<v3s16> blocks_added;
-		m_active_blocks.update(players, active_block_range, active_object_range,
-			blocks_removed, blocks_added);
+		m_active_blocks.update(players, m_active_block_range,
+			m_active_object_send_range, blocks_removed, blocks_added);
 
 		/*
 			Handle removed blocks
@@ -1284,6 +1420,7 @@ void ServerEnvironment::step(float dtime)
 
 			// Set current time as timestamp (and let it set ChangedFlag)
 			block->setTimestamp(m_game_time);
+			block->m_node_timers.detach();
 		}
 
 		/*
@@ -1293,8 +1430,7 @@ void ServerEnvironment::step(float dtime)
 		for (const v3s16 &p: blocks_added) {
 			MapBlock *block = m_map->getBlockOrEmerge(p);
 			if (!block) {
-				m_active_blocks.m_list.erase(p);
-				m_active_blocks.m_abm_list.erase(p);
+				m_active_blocks.removeUnloaded(p);
 				continue;
 			}
 
@@ -1326,74 +1462,46 @@ void ServerEnvironment::step(float dtime)
 				block->raiseModified(MOD_STATE_WRITE_AT_UNLOAD,
 					MOD_REASON_BLOCK_EXPIRED);
 
-			// Run node timers
-			std::vector<NodeTimer> elapsed_timers = block->m_node_timers.step(dtime);
-			if (!elapsed_timers.empty()) {
-				MapNode n;
-				v3s16 p2;
-				for (const NodeTimer &elapsed_timer: elapsed_timers) {
-					n = block->getNodeNoEx(elapsed_timer.position);
-					p2 = elapsed_timer.position + block->getPosRelative();
-					if (m_script->node_on_timer(p2, n, elapsed_timer.elapsed)) {
-						block->setNodeTimer(NodeTimer(
-							elapsed_timer.timeout, 0, elapsed_timer.position));
-					}
-				}
-			}
+			// The block may have been reloaded without being activated
+			if (!block->m_node_timers.isAttached())
+				block->m_node_timers.attach(&m_node_timer_scheduler, p);
 		}
-	}
-
-	if (m_active_block_modifier_interval.step(dtime, m_cache_abm_interval)) {
-		ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per interval", SPT_AVG);
-		TimeTaker timer("modify in active blocks per interval");
-
-		// Initialize handling of ActiveBlockModifiers
-		ABMHandler abmhandler(m_abms, m_cache_abm_interval, this, true);
 
-		int blocks_scanned = 0;
-		int abms_run = 0;
-		int blocks_cached = 0;
+		// Run node timers, only blocks with elapsed timers are visited
+		m_node_timer_scheduler.step(dtime);
+		std::vector<v3s16> due_blocks;
+		m_node_timer_scheduler.popDueBlocks(due_blocks);
 
-		std::vector<v3s16> output(m_active_blocks.m_abm_list.size());
-
-		// Shuffle the active blocks so that each block gets an equal chance
-		// of having its ABMs run.
-		std::copy(m_active_blocks.m_abm_list.begin(), m_active_blocks.m_abm_list.end(), output.begin());
-		std::shuffle(output.begin(), output.end(), m_rgen);
-
-		int i = 0;
-		// The time budget for ABMs is 20%.
-		u32 max_time_ms = m_cache_abm_interval * 1000 / 5;
-		for (const v3s16 &p : output) {
+		std::vector<NodeTimer> elapsed_timers;
+		for (const v3s16 &p: due_blocks) {
+			if (!m_active_blocks.contains(p))
+				continue;
 			MapBlock *block = m_map->getBlockNoCreateNoEx(p);
-			if (!block)
+			if (!block || !block->m_node_timers.isAttached())
 				continue;
 
-			i++;
-
-			// Set current time as timestamp
-			block->setTimestampNoChangedFlag(m_game_time);
-
-			/* Handle ActiveBlockModifiers */
-			abmhandler.apply(block, blocks_scanned, abms_run, blocks_cached);
-
-			u32 time_ms = timer.getTimerTime();
-
-			if (time_ms > max_time_ms) {
-				warningstream << "active block modifiers took "
-					  << time_ms << "ms (processed " << i << " of "
-					  << output.size() << " active blocks)" << std::endl;
-				break;
+			elapsed_timers.clear();
+			block->m_node_timers.popElapsed(elapsed_timers);
+			MapNode n;
+			v3s16 p2;
+			for (const NodeTimer &elapsed_timer: elapsed_timers) {
+				n = block->getNodeNoEx(elapsed_timer.position);
+				p2 = elapsed_timer.position + block->getPosRelative();
+				if (m_script->node_on_timer(p2, n, elapsed_timer.elapsed)) {
+					block->setNodeTimer(NodeTimer(
+						elapsed_timer.timeout, 0, elapsed_timer.position));
+				}
 			}
 		}
-		g_profiler->avg("ServerEnv: active blocks", m_active_blocks.m_abm_list.size());
-		g_profiler->avg("ServerEnv: active blocks cached", blocks_cached);
-		g_profiler->avg("ServerEnv: active blocks scanned for ABMs", blocks_scanned);
-		g_profiler->avg("ServerEnv: ABMs run", abms_run);
-
-		timer.stop(true);
+		g_profiler->avg("ServerEnv: node timer blocks visited", due_blocks.size());
 	}
 
+	if (m_active_block_modifier_interval.step(dtime, m_cache_abm_interval))
+		startABMRound();
+
+	if (m_abm_handler && !m_abm_queue.empty())
+		stepABMs(dtime);
+
 	/*
 		Step script environment (run global on_step())
 	*/
@@ -1405,6 +1513,10 @@ void ServerEnvironment::step(float dtime)
 	{
 		ScopeProfiler sp(g_profiler, "ServerEnv: Run SAO::step()", SPT_AVG);
 
+		// Changes made while stepping are seen by all objects next step
+		m_changed_blocks_last_step.swap(m_changed_blocks);
+		m_changed_blocks.clear();
+
 		// This helps the objects to send data at the same time
 		bool send_recommended = false;
 		m_send_recommended_timer += dtime;
@@ -1428,6 +1540,9 @@ void ServerEnvironment::step(float dtime)
 		m_ao_manager.step(dtime, cb_state);
 	}
 
+	if (!m_item_merge_queue.empty())
+		mergeItems();
+
 	/*
 		Manage active objects
 	*/
@@ -1694,6 +1809,178 @@ u16 ServerEnvironment::addActiveObjectRaw(ServerActiveObject *object,
 	return object->getId();
 }
 
+void ServerEnvironment::startABMRound()
+{
+	// Finish the last round
+	if (m_abm_handler) {
+		float coverage = m_abm_round_size == 0 ? 1.0f :
+			(float)m_abm_round_processed / m_abm_round_size;
+		if (!m_abm_queue.empty()) {
+			warningstream << "active block modifiers could not keep up, "
+				<< m_abm_queue.size() << " of " << m_abm_round_size
+				<< " active blocks carried over" << std::endl;
+		}
+
+		for (ABMWithState *abmws : m_abm_handler->getDueABMs()) {
+			// Limit the compensation to 10 times the chance
+			abmws->coverage = MYMAX(coverage, 0.1f);
+
+			std::string label = abmws->abm->getLabel();
+			if (label.empty() && !abmws->abm->getTriggerContents().empty())
+				label = abmws->abm->getTriggerContents()[0];
+			g_profiler->avg("ABM coverage: " + label, coverage);
+			g_profiler->avg("ABM triggers/s: " + label,
+				abmws->trigger_count / abmws->abm->getTriggerInterval());
+		}
+	}
+
+	// Blocks the last round did not reach are processed first, so that
+	// the same blocks are not skipped again and again
+	std::vector<v3s16> carried_over;
+	carried_over.swap(m_abm_queue);
+	std::set<v3s16> carried_over_set;
+	for (const v3s16 &p : carried_over) {
+		if (m_active_blocks.m_abm_list.find(p) !=
+				m_active_blocks.m_abm_list.end())
+			carried_over_set.insert(p);
+	}
+
+	// Shuffle the active blocks so that each block gets an equal chance
+	// of having its ABMs run.
+	m_abm_queue.reserve(m_active_blocks.m_abm_list.size());
+	for (const v3s16 &p : m_active_blocks.m_abm_list) {
+		if (carried_over_set.find(p) == carried_over_set.end())
+			m_abm_queue.push_back(p);
+	}
+	std::shuffle(m_abm_queue.begin(), m_abm_queue.end(), m_rgen);
+	for (const v3s16 &p : carried_over) {
+		if (carried_over_set.erase(p))
+			m_abm_queue.push_back(p);
+	}
+
+	m_abm_handler.reset(new ABMHandler(m_abms, m_cache_abm_interval, this, true));
+	m_abm_round_size = m_abm_queue.size();
+	m_abm_round_processed = 0;
+	m_abm_round_timer = 0.0f;
+
+	g_profiler->avg("ServerEnv: active blocks", m_active_blocks.m_abm_list.size());
+	g_profiler->avg("ServerEnv: active blocks carried over", carried_over.size());
+}
+
+void ServerEnvironment::stepABMs(float dtime)
+{
+	ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per step", SPT_AVG);
+	TimeTaker timer("modify in active blocks per step", nullptr, PRECISION_MICRO);
+
+	// Spread the blocks of the round evenly over its steps
+	m_abm_round_timer += dtime;
+	size_t target = std::ceil(m_abm_round_size *
+		MYMIN(m_abm_round_timer / m_cache_abm_interval, 1.0f));
+
+	int blocks_scanned = 0;
+	int abms_run = 0;
+	int blocks_cached = 0;
+
+	// The time budget for ABMs is 20% of the step.
+	u64 max_time_us = dtime * 1000000 / 5;
+	while (m_abm_round_processed < target && !m_abm_queue.empty()) {
+		v3s16 p = m_abm_queue.back();
+		m_abm_queue.pop_back();
+		m_abm_round_processed++;
+
+		// The block may have left the active area since the round started
+		if (m_active_blocks.m_abm_list.find(p) ==
+				m_active_blocks.m_abm_list.end())
+			continue;
+
+		MapBlock *block = m_map->getBlockNoCreateNoEx(p);
+		if (!block)
+			continue;
+
+		// Set current time as timestamp
+		block->setTimestampNoChangedFlag(m_game_time);
+
+		/* Handle ActiveBlockModifiers */
+		m_abm_handler->apply(block, blocks_scanned, abms_run, blocks_cached);
+
+		if (timer.getTimerTime() > max_time_us)
+			break;
+	}
+	g_profiler->avg("ServerEnv: active blocks cached", blocks_cached);
+	g_profiler->avg("ServerEnv: active blocks scanned for ABMs", blocks_scanned);
+	g_profiler->avg("ServerEnv: ABMs run", abms_run);
+
+	timer.stop(true);
+}
+
+void ServerEnvironment::onMapEditEvent(const MapEditEvent &event)
+{
+	switch (event.type) {
+	case MEET_ADDNODE:
+	case MEET_REMOVENODE:
+	case MEET_SWAPNODE:
+		markBlockChanged(getNodeBlockPos(event.p));
+		break;
+	case MEET_OTHER:
+		for (const v3s16 &blockpos : event.modified_blocks)
+			markBlockChanged(blockpos);
+		break;
+	default:
+		// Metadata does not affect physics
+		break;
+	}
+}
+
+void ServerEnvironment::markBlockChanged(v3s16 blockpos)
+{
+	// Entities touch the nodes of neighbouring blocks at the borders
+	v3s16 p;
+	for (p.Z = blockpos.Z - 1; p.Z <= blockpos.Z + 1; p.Z++)
+	for (p.Y = blockpos.Y - 1; p.Y <= blockpos.Y + 1; p.Y++)
+	for (p.X = blockpos.X - 1; p.X <= blockpos.X + 1; p.X++)
+		m_changed_blocks.insert(p);
+}
+
+void ServerEnvironment::mergeItems()
+{
+	ScopeProfiler sp(g_profiler, "ServerEnv: merge items", SPT_AVG);
+
+	std::vector<LuaEntitySAO *> items;
+	std::vector<v3f> positions;
+	for (u16 id : m_item_merge_queue) {
+		ServerActiveObject *obj = getActiveObject(id);
+		if (!obj || obj->isGone() ||
+				obj->getType() != ACTIVEOBJECT_TYPE_LUAENTITY)
+			continue;
+		items.push_back((LuaEntitySAO *)obj);
+		positions.push_back(obj->getBasePosition());
+	}
+	m_item_merge_queue.clear();
+
+	std::vector<std::vector<u16>> results;
+	m_ao_manager.getObjectsInsideRadius(positions, 1.0f * BS, results);
+
+	std::vector<LuaEntitySAO *> nearby;
+	for (size_t i = 0; i < items.size(); i++) {
+		// An earlier merge may have removed this item
+		if (items[i]->isGone())
+			continue;
+
+		nearby.clear();
+		for (u16 id : results[i]) {
+			ServerActiveObject *obj = getActiveObject(id);
+			if (!obj || obj == items[i] || obj->isGone() ||
+					obj->getType() != ACTIVEOBJECT_TYPE_LUAENTITY)
+				continue;
+			LuaEntitySAO *entity = (LuaEntitySAO *)obj;
+			if (entity->getName() == "__builtin:item")
+				nearby.push_back(entity);
+		}
+		if (!nearby.empty())
+			items[i]->mergeNearbyItems(nearby);
+	}
+}
+
 /*
 	Remove objects that satisfy (isGone() && m_known_by_count==0)
 */
@@ -1815,7 +2102,7 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 		<<"activating objects of block "<<PP(block->getPos())
 		<<" ("<<block->m_static_objects.m_stored.size()
 		<<" objects)"<<std::endl;
-	bool large_amount = (block->m_static_objects.m_stored.size() > g_settings->getU16("max_objects_per_block"));
+	bool large_amount = (block->m_static_objects.m_stored.size() > m_max_objects_per_block);
 	if (large_amount) {
 		errorstream<<"suspiciously large amount of objects detected: "
 			<<block->m_static_objects.m_stored.size()<<" in "
@@ -2055,7 +2342,7 @@ bool ServerEnvironment::saveStaticToBlock(
 				<< " when saving static data of object to it. id=" << store_id << std::endl;
 		return false;
 	}
-	if (block->m_static_objects.m_stored.size() >= g_settings->getU16("max_objects_per_block")) {
+	if (block->m_static_objects.m_stored.size() >= m_max_objects_per_block) {
 		warningstream << "ServerEnv: Trying to store id = " << store_id
 				<< " statically but block " << PP(blockpos)
 				<< " already contains "
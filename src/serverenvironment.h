@@ -22,14 +22,19 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "activeobject.h"
 #include "environment.h"
 #include "mapnode.h"
+#include "nodetimer.h"
 #include "settings.h"
 #include "server/activeobjectmgr.h"
 #include "util/numeric.h"
+#include <memory>
 #include <set>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 class IGameDef;
 class ServerMap;
+class PathfinderCache;
 struct GameParams;
 class MapBlock;
 class RemotePlayer;
@@ -38,10 +43,12 @@ class AuthDatabase;
 class PlayerSAO;
 class ServerEnvironment;
 class ActiveBlockModifier;
+class ABMHandler;
 struct StaticObject;
 class ServerActiveObject;
 class Server;
 class ServerScripting;
+struct MapEditEvent;
 
 /*
 	{Active, Loading} block modifier interface.
@@ -67,6 +74,8 @@ class ActiveBlockModifier
 	virtual u32 getTriggerChance() = 0;
 	// Whether to modify chance to simulate time lost by an unnattended block
 	virtual bool getSimpleCatchUp() = 0;
+	// Name shown in the profiler, may be empty
+	virtual std::string getLabel() { return ""; }
 	// This is called usually at interval for 1/chance of the nodes
 	virtual void trigger(ServerEnvironment *env, v3s16 p, MapNode n){};
 	virtual void trigger(ServerEnvironment *env, v3s16 p, MapNode n,
@@ -77,6 +86,11 @@ struct ABMWithState
 {
 	ActiveBlockModifier *abm;
 	float timer = 0.0f;
+	// Share of the blocks processed in time in the last round the ABM was
+	// part of, the chance of catch-up ABMs is compensated with it
+	float coverage = 1.0f;
+	// Times the ABM was triggered in the current round
+	u32 trigger_count = 0;
 
 	ABMWithState(ActiveBlockModifier *abm_);
 };
@@ -152,11 +166,18 @@ class LBMManager
 
 /*
 	List of active blocks, used by ServerEnvironment
+
+	The blocks are reference counted by the areas around the players and
+	the forceloaded blocks. The areas of a player are only updated when
+	the player moves to another block or turns the camera, so an update
+	only processes the blocks that actually changed.
 */
 
 class ActiveBlockList
 {
 public:
+	typedef std::unordered_set<v3s16, BlockPosHash> BlockSet;
+
 	void update(std::vector<PlayerSAO*> &active_players,
 		s16 active_block_range,
 		s16 active_object_range,
@@ -167,15 +188,49 @@ class ActiveBlockList
 		return (m_list.find(p) != m_list.end());
 	}
 
-	void clear(){
-		m_list.clear();
-	}
+	// Removes a block that could not be loaded, the next update adds it
+	// again if it is still in range
+	void removeUnloaded(v3s16 p);
 
-	std::set<v3s16> m_list;
-	std::set<v3s16> m_abm_list;
+	void clear();
+
+	BlockSet m_list;
+	BlockSet m_abm_list;
 	std::set<v3s16> m_forceloaded_list;
 
 private:
+	// Blocks a player keeps active
+	struct PlayerArea
+	{
+		v3s16 center;
+		s16 radius = -1;
+		// Blocks in the view cone, beyond the radius
+		std::vector<v3s16> cone;
+		// Camera the cone was computed for
+		s16 cone_range = 0;
+		f32 cone_pitch = 0.0f;
+		f32 cone_yaw = 0.0f;
+		f32 cone_fov = 0.0f;
+		bool seen = false;
+	};
+
+	void addRef(v3s16 p, bool abm);
+	void removeRef(v3s16 p, bool abm);
+	void addSphere(v3s16 center, s16 radius);
+	void removeSphere(v3s16 center, s16 radius);
+	const std::vector<v3s16> &getSphereOffsets(s16 radius);
+
+	std::unordered_map<v3s16, u32, BlockPosHash> m_refs;
+	std::unordered_map<v3s16, u32, BlockPosHash> m_abm_refs;
+	// Keyed by active object id
+	std::unordered_map<u16, PlayerArea> m_players;
+	std::set<v3s16> m_forceloaded_applied;
+	// Blocks whose reference count changed during the update
+	std::vector<v3s16> m_touched;
+	std::vector<v3s16> m_unloaded;
+
+	std::vector<v3s16> m_sphere_offsets;
+	s16 m_sphere_radius = -1;
 };
 
 /*
@@ -209,6 +264,9 @@ class ServerEnvironment : public Environment
 
 	ServerMap & getServerMap();
 
+	// Map data used by path searches during the current step
+	PathfinderCache *getPathfinderCache() { return m_pathfinder_cache; }
+
 	//TODO find way to remove this fct!
 	ServerScripting* getScriptIface()
 	{ return m_script; }
@@ -328,6 +386,19 @@ class ServerEnvironment : public Environment
 		return m_ao_manager.getObjectsInsideRadius(pos, radius, objects);
 	}
 
+	// Queue a builtin item that came to rest for merging with nearby items
+	void queueItemMerge(u16 id) { m_item_merge_queue.push_back(id); }
+
+	// Wakes sleeping entities around the nodes changed by a map edit
+	void onMapEditEvent(const MapEditEvent &event);
+	void markBlockChanged(v3s16 blockpos);
+	// Whether nodes in or next to the block changed during the last step
+	bool isBlockChanged(v3s16 blockpos) const
+	{
+		return m_changed_blocks_last_step.find(blockpos) !=
+			m_changed_blocks_last_step.end();
+	}
+
 	// Clear objects, loading and going through every MapBlock
 	void clearObjects(ClearObjectsMode mode);
 
@@ -399,6 +470,20 @@ class ServerEnvironment : public Environment
 	*/
 	void removeRemovedObjects();
 
+	/*
+		Merge the queued items with the items around them, the radius
+		queries for all of them are done in one pass
+	*/
+	void mergeItems();
+
+	/*
+		ABMs are run in rounds of abm_interval. The blocks of a round are
+		processed a share per step, blocks that were not reached in time
+		go first in the next round.
+	*/
+	void startABMRound();
+	void stepABMs(float dtime);
+
 	/*
 		Convert stored objects from block to active
 	*/
@@ -435,6 +520,13 @@ class ServerEnvironment : public Environment
 	Server *m_server;
 	// Active Object Manager
 	server::ActiveObjectMgr m_ao_manager;
+	// Items that came to rest during the current step
+	std::vector<u16> m_item_merge_queue;
+	// Drives the node timers of the active blocks
+	NodeTimerScheduler m_node_timer_scheduler;
+	// Blocks with changed nodes, including their neighbours
+	std::set<v3s16> m_changed_blocks;
+	std::set<v3s16> m_changed_blocks_last_step;
 	// World path
 	const std::string m_path_world;
 	// Outgoing network message buffer for active objects
@@ -457,6 +549,12 @@ class ServerEnvironment : public Environment
 	u32 m_last_clear_objects_time = 0;
 	// Active block modifiers
 	std::vector<ABMWithState> m_abms;
+	// Current ABM round, blocks are taken from the back of the queue
+	std::unique_ptr<ABMHandler> m_abm_handler;
+	std::vector<v3s16> m_abm_queue;
+	size_t m_abm_round_size = 0;
+	size_t m_abm_round_processed = 0;
+	float m_abm_round_timer = 0.0f;
 	LBMManager m_lbm_mgr;
 	// An interval for generally sending object positions and stuff
 	float m_recommended_send_interval = 0.1f;
@@ -470,6 +568,13 @@ class ServerEnvironment : public Environment
 	PlayerDatabase *m_player_database = nullptr;
 	AuthDatabase *m_auth_database = nullptr;
 
+	PathfinderCache *m_pathfinder_cache = nullptr;
+
+	// Settings read every step or for every object
+	SettingHandle<s16> m_active_object_send_range{"active_object_send_range_blocks"};
+	SettingHandle<s16> m_active_block_range{"active_block_range"};
+	SettingHandle<u16> m_max_objects_per_block{"max_objects_per_block"};
+
 	// Pseudo random generator for shuffling, etc.
 	std::mt19937 m_rgen;
 
@@ -1054,3 +1054,96 @@ void Settings::doCallbacks(const std::string &name) const
 			(it->first)(name, it->second);
 	}
 }
+
+
+/*
+	SettingHandle
+*/
+
+template <typename T>
+static T read_setting(const Settings *settings, const std::string &name);
+
+template <>
+bool read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getBool(name);
+}
+
+template <>
+u16 read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getU16(name);
+}
+
+template <>
+s16 read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getS16(name);
+}
+
+template <>
+u32 read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getU32(name);
+}
+
+template <>
+s32 read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getS32(name);
+}
+
+template <>
+u64 read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getU64(name);
+}
+
+template <>
+float read_setting(const Settings *settings, const std::string &name)
+{
+	return settings->getFloat(name);
+}
+
+template <typename T>
+SettingHandle<T>::SettingHandle(const std::string &name, Settings *settings,
+		T fallback) :
+	m_name(name),
+	m_settings(settings),
+	m_value(fallback)
+{
+	// Register first so that no change is missed
+	m_settings->registerChangedCallback(m_name, settingChangedCallback, this);
+	update();
+}
+
+template <typename T>
+SettingHandle<T>::~SettingHandle()
+{
+	m_settings->deregisterChangedCallback(m_name, settingChangedCallback, this);
+}
+
+template <typename T>
+void SettingHandle<T>::settingChangedCallback(const std::string &name, void *data)
+{
+	((SettingHandle<T> *)data)->update();
+}
+
+template <typename T>
+void SettingHandle<T>::update()
+{
+	try {
+		m_value.store(read_setting<T>(m_settings, m_name),
+			std::memory_order_relaxed);
+	} catch (SettingNotFoundException &e) {
+		// Removed, keep the last value
+	}
+}
+
+template class SettingHandle<bool>;
+template class SettingHandle<u16>;
+template class SettingHandle<s16>;
+template class SettingHandle<u32>;
+template class SettingHandle<s32>;
+template class SettingHandle<u64>;
+template class SettingHandle<float>;
@@ -20,7 +20,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #pragma once
 
 #include "irrlichttypes_bloated.h"
+#include "util/basic_macros.h"
 #include "util/string.h"
+#include <atomic>
 #include <string>
 #include <list>
 #include <set>
@@ -238,3 +240,34 @@ class Settings {
 	mutable std::mutex m_mutex;
 
 };
+
+/*
+	Value of a setting for code that reads it often, e.g. every step.
+	The value is parsed once and updated by a changed callback, reading it
+	takes neither a lock nor parsing. Like other changed callbacks it does
+	not see changes of defaults. If the setting doesn't exist the value is
+	fallback until it is set.
+
+	Available for bool, u16, s16, u32, s32, u64 and float.
+*/
+template <typename T>
+class SettingHandle {
+public:
+	SettingHandle(const std::string &name, Settings *settings = g_settings,
+		T fallback = T());
+	~SettingHandle();
+	DISABLE_CLASS_COPY(SettingHandle);
+
+	T get() const { return m_value.load(std::memory_order_relaxed); }
+	operator T() const { return get(); }
+
+	const std::string &getName() const { return m_name; }
+
+private:
+	static void settingChangedCallback(const std::string &name, void *data);
+	void update();
+
+	const std::string m_name;
+	Settings *m_settings;
+	std::atomic<T> m_value;
+};
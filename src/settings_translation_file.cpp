@@ -359,6 +359,8 @@ fake_function() {
 	gettext("Delay between mesh updates on the client in ms. Increasing this will slow\ndown the rate of mesh updates, thus reducing jitter on slower clients.");
 	gettext("Mapblock mesh generator's MapBlock cache size in MB");
 	gettext("Size of the MapBlock cache of the mesh generator. Increasing this will\nincrease the cache hit %, reducing the data being copied from the main\nthread, thus reducing jitter.");
+	gettext("Greedy meshing");
+	gettext("Merges adjacent coplanar faces of cubic nodes with identical texture and\nlighting into larger quads. Reduces the vertex count of mapblock meshes.");
 	gettext("Minimap");
 	gettext("Enables minimap.");
 	gettext("Round minimap");
@@ -582,6 +584,8 @@ fake_function() {
 	gettext("Advanced");
 	gettext("Deprecated Lua API handling");
 	gettext("Handling for deprecated lua api calls:\n-    legacy: (try to) mimic old behaviour (default for release).\n-    log: mimic and log backtrace of deprecated call (default for debug).\n-    error: abort on usage of deprecated call (suggested for mod developers).");
+	gettext("Number of async threads");
+	gettext("Number of threads running jobs queued by mods with minetest.handle_async.\nValue 0:\n-    Automatic selection. The number of async threads will be\n-    'number of processors - 2', with a lower limit of 1.\nAny other value:\n-    Specifies the number of async threads, with a lower limit of 1.");
 	gettext("Max. clearobjects extra blocks");
 	gettext("Number of extra blocks that can be loaded by /clearobjects at once.\nThis is a trade-off between sqlite transaction overhead and\nmemory consumption (4096=100MB, as a rule of thumb).");
 	gettext("Unload unused server data");
@@ -654,6 +658,8 @@ fake_function() {
 	gettext("Level of logging to be written to debug.txt:\n-    <nothing> (no logging)\n-    none (messages with no level)\n-    error\n-    warning\n-    action\n-    info\n-    verbose");
 	gettext("Debug log file size threshold");
 	gettext("If the file size of debug.txt exceeds the number of megabytes specified in\nthis setting when it is opened, the file is moved to debug.txt.1,\ndeleting an older debug.txt.1 if it exists.\ndebug.txt is only moved if this setting is positive.");
+	gettext("Asynchronous logging");
+	gettext("Write the log from a separate thread instead of the logging thread.\nReduces stalls on slow disks or terminals. Errors are still written\nimmediately. Messages are dropped (and the number reported) if a thread\nlogs faster than the log can be written.");
 	gettext("IPv6");
 	gettext("IPv6 support.");
 	gettext("Advanced");
@@ -1022,6 +1028,10 @@ fake_function() {
 	gettext("Maximum number of blocks to be queued that are to be generated.\nSet to blank for an appropriate amount to be chosen automatically.");
 	gettext("Number of emerge threads");
 	gettext("Number of emerge threads to use.\nWARNING: Currently there are multiple bugs that may cause crashes when\n'num_emerge_threads' is larger than 1. Until this warning is removed it is\nstrongly recommended this value is set to the default '1'.\nValue 0:\n-    Automatic selection. The number of emerge threads will be\n-    'number of processors - 2', with a lower limit of 1.\nAny other value:\n-    Specifies the number of emerge threads, with a lower limit of 1.\nWARNING: Increasing the number of emerge threads increases engine mapgen\nspeed, but this may harm game performance by interfering with other\nprocesses, especially in singleplayer and/or when running Lua code in\n'on_generated'. For many users the optimum setting may be '1'.");
+	gettext("Mapgen worker threads");
+	gettext("Number of worker threads that help emerge threads generate a single\nmapchunk. Independent noises, terrain columns and biomes are split\nbetween them. The generated terrain does not depend on this value.\nValue 0 disables the workers, each mapchunk is then generated by\none emerge thread only.");
+	gettext("Mapgen noise cache size");
+	gettext("Maximum number of 2D noise maps kept in memory for reuse by mapchunks\ngenerated above or below each other. Each map takes about 25 KiB with\nthe default chunksize. Value 0 disables the cache.");
 	gettext("Online Content Repository");
 	gettext("ContentDB URL");
 	gettext("The URL for the content repository");
@@ -0,0 +1,147 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "task_pool.h"
+#include <algorithm>
+#include "threading/thread.h"
+
+class TaskPool::WorkerThread : public Thread
+{
+public:
+	WorkerThread(const std::string &name, TaskPool *pool) :
+		Thread(name),
+		m_pool(pool)
+	{}
+
+protected:
+	void *run()
+	{
+		m_pool->workerLoop();
+		return nullptr;
+	}
+
+private:
+	TaskPool *m_pool;
+};
+
+
+TaskPool::TaskPool(const std::string &name, unsigned int num_threads)
+{
+	for (unsigned int i = 0; i < num_threads; i++) {
+		WorkerThread *thread = new WorkerThread(name + std::to_string(i), this);
+		thread->start();
+		m_threads.push_back(thread);
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_job_added.notify_all();
+	}
+
+	for (WorkerThread *thread : m_threads) {
+		thread->stop();
+		thread->wait();
+		delete thread;
+	}
+}
+
+bool TaskPool::claim(Job **job, unsigned int *i)
+{
+	if (m_jobs.empty())
+		return false;
+
+	Job *front = m_jobs.front();
+	*job = front;
+	*i = front->next++;
+	// Once every part has been handed out nobody needs to see the job anymore
+	if (front->next == front->count)
+		m_jobs.pop_front();
+	return true;
+}
+
+void TaskPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_stop) {
+		Job *job;
+		unsigned int i;
+		if (!claim(&job, &i)) {
+			m_job_added.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+		(*job->fn)(i);
+		lock.lock();
+
+		// The job lives on the stack of run(), which waits for this
+		if (++job->done == job->count)
+			job->finished.notify_all();
+	}
+}
+
+void TaskPool::run(unsigned int count, const std::function<void(unsigned int)> &fn)
+{
+	if (count == 0)
+		return;
+
+	if (m_threads.empty() || count == 1) {
+		for (unsigned int i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	Job job;
+	job.fn = &fn;
+	job.count = count;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobs.push_back(&job);
+	m_job_added.notify_all();
+
+	// Help out with our own job until all of its parts have been claimed
+	while (job.next < job.count) {
+		unsigned int i = job.next++;
+		if (job.next == job.count) {
+			auto it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+			if (it != m_jobs.end())
+				m_jobs.erase(it);
+		}
+
+		lock.unlock();
+		fn(i);
+		lock.lock();
+
+		job.done++;
+	}
+
+	while (job.done != job.count)
+		job.finished.wait(lock);
+}
+
+void TaskPool::run(const std::vector<std::function<void()>> &tasks)
+{
+	run(tasks.size(), [&tasks] (unsigned int i) {
+		tasks[i]();
+	});
+}
@@ -0,0 +1,74 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "util/basic_macros.h"
+
+/*
+	A fixed set of worker threads that split up the work of their callers.
+
+	run() blocks until all parts of the job are finished. The calling thread
+	works on the job too, so jobs make progress even if every worker is busy
+	and a pool without workers simply runs the job serially. Several threads
+	may call run() at the same time, their jobs are processed in order.
+*/
+class TaskPool
+{
+public:
+	TaskPool(const std::string &name, unsigned int num_threads);
+	~TaskPool();
+	DISABLE_CLASS_COPY(TaskPool);
+
+	// Calls fn(i) for every i in [0, count), possibly in parallel
+	void run(unsigned int count, const std::function<void(unsigned int)> &fn);
+
+	// Runs independent tasks, possibly in parallel
+	void run(const std::vector<std::function<void()>> &tasks);
+
+	unsigned int getThreadCount() const { return m_threads.size(); }
+
+private:
+	class WorkerThread;
+
+	struct Job
+	{
+		const std::function<void(unsigned int)> *fn;
+		unsigned int count;
+		unsigned int next = 0;
+		unsigned int done = 0;
+		std::condition_variable finished;
+	};
+
+	// Claims the next part of the front job. Requires m_mutex held.
+	bool claim(Job **job, unsigned int *i);
+	void workerLoop();
+
+	std::mutex m_mutex;
+	std::condition_variable m_job_added;
+	std::deque<Job *> m_jobs;
+	bool m_stop = false;
+	std::vector<WorkerThread *> m_threads;
+};
@@ -19,6 +19,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "test.h"
 
+#include <algorithm>
 #include "util/areastore.h"
 
 class TestAreaStore : public TestBase {
@@ -31,7 +32,10 @@ class TestAreaStore : public TestBase {
 	void genericStoreTest(AreaStore *store);
 	void testVectorStore();
 	void testSpatialStore();
+	void testRTreeStore();
+	void testRTreeConsistency();
 	void testSerialization();
+	void testSerializationLarge();
 };
 
 static TestAreaStore g_test_instance;
@@ -42,7 +46,26 @@ void TestAreaStore::runTests(IGameDef *gamedef)
 #if USE_SPATIAL
 	TEST(testSpatialStore);
 #endif
+	TEST(testRTreeStore);
+	TEST(testRTreeConsistency);
 	TEST(testSerialization);
+	TEST(testSerializationLarge);
+}
+
+static std::vector<u32> get_sorted_ids(const std::vector<Area *> &areas)
+{
+	std::vector<u32> ids;
+	for (const Area *a : areas)
+		ids.push_back(a->id);
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+static Area get_random_area(PcgRandom &pr)
+{
+	v3s16 minedge(pr.range(-500, 500), pr.range(-50, 50), pr.range(-500, 500));
+	v3s16 size(pr.range(0, 40), pr.range(0, 40), pr.range(0, 40));
+	return Area(minedge, minedge + size);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -61,6 +84,86 @@ void TestAreaStore::testSpatialStore()
 #endif
 }
 
+void TestAreaStore::testRTreeStore()
+{
+	RTreeAreaStore store;
+	genericStoreTest(&store);
+}
+
+void TestAreaStore::testRTreeConsistency()
+{
+	// Enough areas for a tree of several levels, with splits and
+	// underfull nodes after removals
+	VectorAreaStore vstore;
+	RTreeAreaStore rstore;
+	vstore.setCacheParams(false, 16, 20);
+	rstore.setCacheParams(false, 16, 20);
+	PcgRandom pr(1234);
+	std::vector<u32> ids;
+
+	for (u32 i = 0; i < 4000; i++) {
+		Area varea = get_random_area(pr);
+		Area rarea = varea;
+		vstore.insertArea(&varea);
+		rstore.insertArea(&rarea);
+		UASSERTEQ(u32, varea.id, rarea.id);
+		ids.push_back(varea.id);
+	}
+	for (u32 i = 0; i < 2500; i++) {
+		size_t idx = pr.range(0, ids.size() - 1);
+		UASSERT(rstore.removeArea(ids[idx]));
+		vstore.removeArea(ids[idx]);
+		ids[idx] = ids.back();
+		ids.pop_back();
+	}
+	UASSERT(!rstore.removeArea(U32_MAX - 1));
+	UASSERTEQ(size_t, rstore.size(), vstore.size());
+
+	std::vector<Area *> vres, rres;
+	for (u32 i = 0; i < 500; i++) {
+		v3s16 pos(pr.range(-500, 500), pr.range(-50, 50), pr.range(-500, 500));
+		vstore.getAreasForPos(&vres, pos);
+		rstore.getAreasForPos(&rres, pos);
+		UASSERT(get_sorted_ids(vres) == get_sorted_ids(rres));
+		vres.clear();
+		rres.clear();
+
+		Area q = get_random_area(pr);
+		q.maxedge += v3s16(100, 100, 100);
+		bool accept_overlap = i % 2;
+		vstore.getAreasInArea(&vres, q.minedge, q.maxedge, accept_overlap);
+		rstore.getAreasInArea(&rres, q.minedge, q.maxedge, accept_overlap);
+		UASSERT(get_sorted_ids(vres) == get_sorted_ids(rres));
+		vres.clear();
+		rres.clear();
+	}
+
+	// A deserialized store is bulk loaded
+	std::ostringstream os(std::ios_base::binary);
+	vstore.serialize(os);
+	std::istringstream is(os.str(), std::ios_base::binary);
+	RTreeAreaStore loaded;
+	loaded.setCacheParams(false, 16, 20);
+	loaded.deserialize(is);
+	UASSERTEQ(size_t, loaded.size(), vstore.size());
+
+	for (u32 i = 0; i < 500; i++) {
+		v3s16 pos(pr.range(-500, 500), pr.range(-50, 50), pr.range(-500, 500));
+		vstore.getAreasForPos(&vres, pos);
+		loaded.getAreasForPos(&rres, pos);
+		UASSERT(get_sorted_ids(vres) == get_sorted_ids(rres));
+		vres.clear();
+		rres.clear();
+	}
+
+	for (u32 id : ids)
+		UASSERT(loaded.removeArea(id));
+	UASSERTEQ(size_t, loaded.size(), 0);
+	loaded.getAreasInArea(&rres, v3s16(-1000, -1000, -1000),
+		v3s16(1000, 1000, 1000), true);
+	UASSERTEQ(size_t, rres.size(), 0);
+}
+
 void TestAreaStore::genericStoreTest(AreaStore *store)
 {
 	Area a(v3s16(-10, -3, 5), v3s16(0, 29, 7));
@@ -171,3 +274,33 @@ void TestAreaStore::testSerialization()
 	UASSERTEQ(u32, c.id, 2);
 }
 
+void TestAreaStore::testSerializationLarge()
+{
+	// Too many areas for the 16 bit count of version 0
+	RTreeAreaStore store;
+	PcgRandom pr(42);
+	for (u32 i = 0; i < 70000; i++) {
+		Area a = get_random_area(pr);
+		a.data = std::to_string(i);
+		store.insertArea(&a);
+	}
+
+	std::ostringstream os(std::ios_base::binary);
+	store.serialize(os);
+	std::string str = os.str();
+	UASSERTEQ(u8, str[0], 5);
+
+	std::istringstream is(str, std::ios_base::binary);
+	VectorAreaStore loaded;
+	loaded.deserialize(is);
+	UASSERTEQ(size_t, loaded.size(), 70000);
+	const Area *last = loaded.getArea(69999);
+	UASSERT(last);
+	UASSERTEQ(const std::string &, last->data, "69999");
+	UASSERT(last->minedge == store.getArea(69999)->minedge);
+
+	// Truncated data is rejected
+	std::istringstream is_short(str.substr(0, 1000), std::ios_base::binary);
+	VectorAreaStore store_short;
+	EXCEPTION_CHECK(SerializationError, store_short.deserialize(is_short));
+}
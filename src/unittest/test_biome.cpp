@@ -0,0 +1,168 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include "mapgen/mg_biome.h"
+#include "noise.h"
+
+class TestBiome : public TestBase {
+public:
+	TestBiome() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestBiome"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testLookupRandom();
+	void testLookupLimits();
+	void testLookupAfterAdd();
+
+private:
+	void addRandomBiomes(BiomeManager *bmgr, PcgRandom &pr, u32 num_biomes);
+	void checkLookup(const BiomeManager *bmgr, float heat, float humidity,
+		v3s16 pos);
+};
+
+static TestBiome g_test_instance;
+
+void TestBiome::runTests(IGameDef *gamedef)
+{
+	TEST(testLookupRandom);
+	TEST(testLookupLimits);
+	TEST(testLookupAfterAdd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestBiome::addRandomBiomes(BiomeManager *bmgr, PcgRandom &pr,
+	u32 num_biomes)
+{
+	const s16 limit = 31000;
+	for (u32 i = 0; i < num_biomes; i++) {
+		Biome *b = BiomeManager::create(BIOMETYPE_NORMAL);
+		b->name = "test_biome_" + std::to_string(bmgr->getNumObjects());
+		b->flags = 0;
+		b->heat_point = pr.range(-20, 120);
+		b->humidity_point = pr.range(-20, 120);
+		b->vertical_blend = 0;
+		b->min_pos = v3s16(-limit, -limit, -limit);
+		b->max_pos = v3s16(limit, limit, limit);
+
+		// Overlapping Y ranges, some with vertical blend
+		switch (pr.range(0, 3)) {
+		case 0:
+			b->max_pos.Y = pr.range(-200, 0);
+			break;
+		case 1:
+			b->min_pos.Y = pr.range(-200, 50);
+			b->max_pos.Y = b->min_pos.Y + pr.range(0, 100);
+			b->vertical_blend = pr.range(0, 8);
+			break;
+		case 2:
+			b->min_pos.Y = pr.range(0, 200);
+			break;
+		default:
+			break;
+		}
+
+		// A few biomes with their own X/Z limits
+		if (pr.range(0, 7) == 0) {
+			b->min_pos.X = pr.range(-200, 0);
+			b->max_pos.X = b->min_pos.X + pr.range(0, 200);
+			b->min_pos.Z = pr.range(-200, 0);
+			b->max_pos.Z = b->min_pos.Z + pr.range(0, 200);
+		}
+
+		UASSERT(bmgr->add(b) != OBJDEF_INVALID_HANDLE);
+	}
+}
+
+
+void TestBiome::checkLookup(const BiomeManager *bmgr, float heat,
+	float humidity, v3s16 pos)
+{
+	UASSERT(bmgr->getBiomeFromNoiseOriginal(heat, humidity, pos) ==
+		bmgr->getBiomeFromNoiseLinear(heat, humidity, pos));
+}
+
+
+void TestBiome::testLookupRandom()
+{
+	PcgRandom pr(1337);
+
+	for (u32 num_biomes : {1, 5, 40, 200}) {
+		BiomeManager bmgr(nullptr);
+		addRandomBiomes(&bmgr, pr, num_biomes);
+		bmgr.updateLookup();
+
+		for (u32 i = 0; i < 20000; i++) {
+			float heat = pr.range(-40000, 140000) / 1000.0f;
+			float humidity = pr.range(-40000, 140000) / 1000.0f;
+			v3s16 pos(pr.range(-300, 300), pr.range(-300, 300),
+				pr.range(-300, 300));
+			checkLookup(&bmgr, heat, humidity, pos);
+		}
+	}
+}
+
+
+void TestBiome::testLookupLimits()
+{
+	PcgRandom pr(4242);
+	BiomeManager bmgr(nullptr);
+	addRandomBiomes(&bmgr, pr, 60);
+	bmgr.updateLookup();
+
+	// Y band edges, blend edges and biome points, where ties between
+	// biomes are most likely
+	for (size_t i = 1; i < bmgr.getNumObjects(); i++) {
+		const Biome *b = (Biome *)bmgr.getRaw(i);
+		const s16 ys[] = {
+			b->min_pos.Y, (s16)(b->min_pos.Y - 1),
+			b->max_pos.Y, (s16)(b->max_pos.Y + 1),
+			(s16)(b->max_pos.Y + b->vertical_blend),
+			(s16)(b->max_pos.Y + b->vertical_blend + 1),
+		};
+		for (s16 y : ys) {
+			for (u32 j = 0; j < 20; j++) {
+				v3s16 pos(pr.range(-300, 300), y, pr.range(-300, 300));
+				checkLookup(&bmgr, b->heat_point, b->humidity_point, pos);
+				checkLookup(&bmgr, pr.range(-50, 150), pr.range(-50, 150), pos);
+			}
+		}
+	}
+}
+
+
+void TestBiome::testLookupAfterAdd()
+{
+	PcgRandom pr(31337);
+	BiomeManager bmgr(nullptr);
+	addRandomBiomes(&bmgr, pr, 20);
+	bmgr.updateLookup();
+
+	// Biomes registered after the lookup was built must still be found
+	addRandomBiomes(&bmgr, pr, 5);
+
+	for (u32 i = 0; i < 5000; i++) {
+		v3s16 pos(pr.range(-300, 300), pr.range(-300, 300),
+			pr.range(-300, 300));
+		checkLookup(&bmgr, pr.range(-20, 120), pr.range(-20, 120), pos);
+	}
+}
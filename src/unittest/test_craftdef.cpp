@@ -0,0 +1,101 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include "craftdef.h"
+#include "gamedef.h"
+#include "inventory.h"
+
+class TestCraftDef : public TestBase
+{
+public:
+	TestCraftDef() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestCraftDef"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testGroupRecipes(IGameDef *gamedef);
+
+private:
+	std::string craft(IWritableCraftDefManager *cdef, IGameDef *gamedef,
+			unsigned int width, const std::vector<std::string> &items);
+};
+
+static TestCraftDef g_test_instance;
+
+void TestCraftDef::runTests(IGameDef *gamedef)
+{
+	TEST(testGroupRecipes, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string TestCraftDef::craft(IWritableCraftDefManager *cdef,
+		IGameDef *gamedef, unsigned int width,
+		const std::vector<std::string> &items)
+{
+	CraftInput input;
+	input.method = CRAFT_METHOD_NORMAL;
+	input.width = width;
+	for (const std::string &item : items)
+		input.items.emplace_back(item, item.empty() ? 0 : 1, 0, gamedef->idef());
+
+	CraftOutput output;
+	std::vector<ItemStack> replacements;
+	if (!cdef->getCraftResult(input, output, replacements, false, gamedef))
+		return "";
+	return output.item;
+}
+
+void TestCraftDef::testGroupRecipes(IGameDef *gamedef)
+{
+	IWritableCraftDefManager *cdef = createCraftDefManager();
+	CraftReplacements no_replacements;
+
+	// Both stone and brick are in the cracky group
+	cdef->registerCraft(new CraftDefinitionShaped("default:torch", 1,
+		{"group:cracky", "group:cracky"}, no_replacements), gamedef);
+	cdef->registerCraft(new CraftDefinitionShapeless("default:lava",
+		{"group:crumbly", "default:stone"}, no_replacements), gamedef);
+	cdef->registerCraft(new CraftDefinitionShaped("default:dirt_with_grass", 1,
+		{"default:stone"}, no_replacements), gamedef);
+	// Registered later, takes precedence over the first recipe
+	cdef->registerCraft(new CraftDefinitionShaped("default:water", 1,
+		{"group:cracky", "default:brick"}, no_replacements), gamedef);
+	cdef->initHashes(gamedef);
+
+	UASSERTEQ(std::string, craft(cdef, gamedef, 1,
+		{"default:stone", "default:brick"}), "default:water");
+	UASSERTEQ(std::string, craft(cdef, gamedef, 1,
+		{"default:brick", "default:stone"}), "default:torch");
+	UASSERTEQ(std::string, craft(cdef, gamedef, 3,
+		{"", "default:stone", "", "", "", "", "default:dirt_with_grass"}),
+		"default:lava");
+	UASSERTEQ(std::string, craft(cdef, gamedef, 3,
+		{"", "", "", "", "default:stone"}), "default:dirt_with_grass");
+
+	// Ingredients present but not all of them
+	UASSERTEQ(std::string, craft(cdef, gamedef, 3,
+		{"default:dirt_with_grass", "default:dirt_with_grass"}), "");
+	UASSERTEQ(std::string, craft(cdef, gamedef, 1,
+		{"default:stone", "default:torch"}), "");
+
+	delete cdef;
+}
@@ -36,6 +36,7 @@ class TestInventory : public TestBase {
 	static const char *serialized_inventory_in;
 	static const char *serialized_inventory_out;
 	static const char *serialized_inventory_inc;
+	static const char *serialized_inventory_inc_slot;
 };
 
 static TestInventory g_test_instance;
@@ -72,12 +73,25 @@ void TestInventory::testSerializeDeserialize(IItemDefManager *idef)
 	inv.serialize(inv_os, true);
 	UASSERTEQ(std::string, inv_os.str(), serialized_inventory_inc);
 
+	// Client side copy that only receives the incremental update
+	Inventory inv_client(inv);
+
 	ItemStack leftover = inv.getList("main")->takeItem(7, 99 - 12);
 	ItemStack wanted = ItemStack("default:dirt", 99 - 12, 0, idef);
 	UASSERT(leftover == wanted);
 	leftover = inv.getList("main")->getItem(7);
 	wanted.count = 12;
 	UASSERT(leftover == wanted);
+
+	// Only the changed slot is sent
+	inv_os.str("");
+	inv_os.clear();
+	inv.serialize(inv_os, true);
+	UASSERTEQ(std::string, inv_os.str(), serialized_inventory_inc_slot);
+
+	std::istringstream inc_is(inv_os.str(), std::ios::binary);
+	inv_client.deSerialize(inc_is);
+	UASSERT(inv_client == inv);
 }
 
 const char *TestInventory::serialized_inventory_in =
@@ -124,3 +138,20 @@ const char *TestInventory::serialized_inventory_inc =
 	"KeepList main\n"
 	"KeepList abc\n"
 	"EndInventory\n";
+
+const char *TestInventory::serialized_inventory_inc_slot =
+	"List main 10\n"
+	"Width 5\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Keep\n"
+	"Item default:dirt 12\n"
+	"Keep\n"
+	"Keep\n"
+	"EndInventoryList\n"
+	"KeepList abc\n"
+	"EndInventory\n";
@@ -0,0 +1,306 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include "client/mapblock_mesh.h"
+#include "client/renderingengine.h"
+#include "client/shader.h"
+#include "client/tile.h"
+#include "nodedef.h"
+#include "noise.h"
+#include "settings.h"
+#include "util/numeric.h"
+
+/*
+	Meshes the same block with and without greedy meshing, using Irrlicht's
+	null driver, and compares the node faces covered by both meshes.
+*/
+
+class TestMapblockMesh : public TestBase {
+public:
+	TestMapblockMesh() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMapblockMesh"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testGreedyFlatLighting();
+	void testGreedySmoothLighting();
+
+private:
+	// Position, normal and layer of a node face, then its texture and
+	// sorted vertex colors
+	typedef std::tuple<s32, s32, s32, s32, s32, video::ITexture *,
+		u32, u32, u32, u32> FaceCell;
+
+	content_t defineNode(const std::string &name, const std::string &texture,
+			bool world_aligned);
+	void generateBlocks();
+	void compareGreedy(bool smooth_lighting);
+	MapBlockMesh *makeMesh(bool smooth_lighting, bool greedy_meshing);
+	void getFaceCells(MapBlockMesh *mesh, std::vector<FaceCell> &cells,
+			u32 *quad_count);
+
+	NodeDefManager *m_ndef = nullptr;
+	IWritableTextureSource *m_tsrc = nullptr;
+	IWritableShaderSource *m_shdrsrc = nullptr;
+	TextureSettings m_tsettings;
+
+	content_t c_stone, c_dirt, c_grass, c_brick;
+
+	// The meshed block (0,0,0) and its neighbours
+	std::map<v3s16, std::vector<MapNode>> m_blocks;
+};
+
+static TestMapblockMesh g_test_instance;
+
+void TestMapblockMesh::runTests(IGameDef *gamedef)
+{
+	g_settings->set("video_driver", "null");
+	g_settings->setBool("enable_shaders", false);
+	g_settings->setBool("enable_minimap", false);
+
+	RenderingEngine *engine = new RenderingEngine(nullptr);
+	m_tsrc = createTextureSource();
+	m_shdrsrc = createShaderSource();
+	m_ndef = createNodeDefManager();
+	m_tsettings.readSettings();
+
+	const std::string base = "[combine:16x16^[colorize:";
+	c_stone = defineNode("test:stone", base + "#707070", false);
+	c_dirt  = defineNode("test:dirt", base + "#6b4a2b", false);
+	c_grass = defineNode("test:grass", base + "#3f8f2f", false);
+	c_brick = defineNode("test:brick", base + "#a04030", true);
+	generateBlocks();
+
+	TEST(testGreedyFlatLighting);
+	TEST(testGreedySmoothLighting);
+
+	m_blocks.clear();
+	delete m_ndef;
+	delete m_shdrsrc;
+	delete m_tsrc;
+	delete engine;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+content_t TestMapblockMesh::defineNode(const std::string &name,
+		const std::string &texture, bool world_aligned)
+{
+	ContentFeatures f;
+	f.name = name;
+	f.drawtype = NDT_NORMAL;
+	for (TileDef &tiledef : f.tiledef) {
+		tiledef.name = texture;
+		if (world_aligned) {
+			tiledef.align_style = ALIGN_STYLE_WORLD;
+			tiledef.scale = 2;
+		}
+	}
+
+	// Only tiles are needed for meshing, skip NodeDefManager::updateTextures
+	// which requires a Client
+	f.updateTextures(m_tsrc, m_shdrsrc,
+			RenderingEngine::get_scene_manager()->getMeshManipulator(),
+			nullptr, m_tsettings);
+	return m_ndef->set(name, f);
+}
+
+void TestMapblockMesh::generateBlocks()
+{
+	const s16 size = 3 * MAP_BLOCKSIZE;
+	PcgRandom pr(1337);
+
+	// Terrain with steps, brick columns and caves, indexed z, y, x
+	std::vector<MapNode> region(size * size * size, MapNode(CONTENT_AIR));
+	auto at = [&] (s16 x, s16 y, s16 z) -> MapNode & {
+		return region[(z * size + y) * size + x];
+	};
+
+	for (s16 z = 0; z < size; z++)
+	for (s16 x = 0; x < size; x++) {
+		s16 height = size / 2 + (s16)(4.0f * std::sin(x * 0.3f)
+				+ 3.0f * std::cos(z * 0.2f));
+		bool brick = pr.range(0, 19) == 0;
+		for (s16 y = 0; y <= height + (brick ? 3 : 0); y++) {
+			if (y > height)
+				at(x, y, z) = MapNode(c_brick);
+			else if (y < height - 3)
+				at(x, y, z) = MapNode(pr.range(0, 49) == 0 ? c_brick : c_stone);
+			else if (y < height)
+				at(x, y, z) = MapNode(c_dirt);
+			else
+				at(x, y, z) = MapNode(c_grass);
+		}
+	}
+
+	for (u32 i = 0; i < 20; i++) {
+		s16 cx = pr.range(2, size - 3), cy = pr.range(2, size / 2),
+			cz = pr.range(2, size - 3);
+		for (s16 z = cz - 2; z <= cz + 2; z++)
+		for (s16 y = cy - 1; y <= cy + 1; y++)
+		for (s16 x = cx - 2; x <= cx + 2; x++)
+			at(x, y, z) = MapNode(CONTENT_AIR);
+	}
+
+	// Sunlight from above, and dim uneven light in caves so that the
+	// lighting of neighbouring faces differs
+	for (s16 z = 0; z < size; z++)
+	for (s16 x = 0; x < size; x++) {
+		u8 light = LIGHT_SUN;
+		for (s16 y = size - 1; y >= 0; y--) {
+			MapNode &n = at(x, y, z);
+			const ContentFeatures &f = m_ndef->get(n);
+			if (!f.light_propagates)
+				light = 0;
+			u8 day = light;
+			if (f.light_propagates && light == 0)
+				day = pr.range(0, 4);
+			n.setLight(LIGHTBANK_DAY, day, f);
+			n.setLight(LIGHTBANK_NIGHT, 0, f);
+		}
+	}
+
+	m_blocks.clear();
+	v3s16 bp;
+	for (bp.Z = -1; bp.Z <= 1; bp.Z++)
+	for (bp.Y = -1; bp.Y <= 1; bp.Y++)
+	for (bp.X = -1; bp.X <= 1; bp.X++) {
+		std::vector<MapNode> &data = m_blocks[bp];
+		data.resize(MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE);
+		v3s16 origin = (bp + v3s16(1, 1, 1)) * MAP_BLOCKSIZE;
+		u32 i = 0;
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+			data[i++] = at(origin.X + x, origin.Y + y, origin.Z + z);
+	}
+}
+
+MapBlockMesh *TestMapblockMesh::makeMesh(bool smooth_lighting,
+		bool greedy_meshing)
+{
+	MeshMakeData data(m_ndef, m_tsrc, m_shdrsrc, false);
+	data.fillBlockDataBegin(v3s16(0, 0, 0));
+	for (auto &block : m_blocks)
+		data.fillBlockData(block.first, &block.second[0]);
+	data.setSmoothLighting(smooth_lighting);
+	data.setGreedyMeshing(greedy_meshing);
+
+	return new MapBlockMesh(&data, v3s16(0, 0, 0));
+}
+
+void TestMapblockMesh::getFaceCells(MapBlockMesh *mesh,
+		std::vector<FaceCell> &cells, u32 *quad_count)
+{
+	*quad_count = 0;
+	for (int layer = 0; layer < MAX_TILE_LAYERS; layer++) {
+		scene::IMesh *m = mesh->getMesh(layer);
+		for (u32 i = 0; i < m->getMeshBufferCount(); i++) {
+			scene::IMeshBuffer *buf = m->getMeshBuffer(i);
+			UASSERT(buf->getVertexType() == video::EVT_STANDARD);
+			const video::S3DVertex *vertices =
+				(const video::S3DVertex *)buf->getVertices();
+			const u16 *indices = buf->getIndices();
+			video::ITexture *texture = buf->getMaterial().getTexture(0);
+
+			// Every face is a quad of two triangles
+			UASSERT(buf->getIndexCount() % 6 == 0);
+			for (u32 j = 0; j < buf->getIndexCount(); j += 6) {
+				std::vector<u16> quad(indices + j, indices + j + 6);
+				std::sort(quad.begin(), quad.end());
+				quad.erase(std::unique(quad.begin(), quad.end()), quad.end());
+				UASSERT(quad.size() == 4);
+				(*quad_count)++;
+
+				v3f pmin = vertices[quad[0]].Pos;
+				v3f pmax = pmin;
+				u32 colors[4];
+				for (u32 k = 0; k < 4; k++) {
+					const v3f &pos = vertices[quad[k]].Pos;
+					pmin.X = MYMIN(pmin.X, pos.X);
+					pmin.Y = MYMIN(pmin.Y, pos.Y);
+					pmin.Z = MYMIN(pmin.Z, pos.Z);
+					pmax.X = MYMAX(pmax.X, pos.X);
+					pmax.Y = MYMAX(pmax.Y, pos.Y);
+					pmax.Z = MYMAX(pmax.Z, pos.Z);
+					colors[k] = vertices[quad[k]].Color.color;
+				}
+				std::sort(colors, colors + 4);
+
+				const v3f &normal = vertices[quad[0]].Normal;
+				s32 normal_id = normal.X > 0.5f ? 0 : normal.X < -0.5f ? 1 :
+					normal.Y > 0.5f ? 2 : normal.Y < -0.5f ? 3 :
+					normal.Z > 0.5f ? 4 : 5;
+
+				// Split the quad into node sized cells, positions are in
+				// half nodes so that face centers are integers
+				v3s16 cmin(std::lround(pmin.X * 2 / BS),
+					std::lround(pmin.Y * 2 / BS), std::lround(pmin.Z * 2 / BS));
+				v3s16 cmax(std::lround(pmax.X * 2 / BS),
+					std::lround(pmax.Y * 2 / BS), std::lround(pmax.Z * 2 / BS));
+				v3s16 step(cmin.X == cmax.X ? 1 : 2,
+					cmin.Y == cmax.Y ? 1 : 2, cmin.Z == cmax.Z ? 1 : 2);
+				v3s16 start(cmin.X == cmax.X ? cmin.X : cmin.X + 1,
+					cmin.Y == cmax.Y ? cmin.Y : cmin.Y + 1,
+					cmin.Z == cmax.Z ? cmin.Z : cmin.Z + 1);
+				for (s16 z = start.Z; z <= cmax.Z; z += step.Z)
+				for (s16 y = start.Y; y <= cmax.Y; y += step.Y)
+				for (s16 x = start.X; x <= cmax.X; x += step.X)
+					cells.emplace_back(x, y, z, normal_id, layer, texture,
+						colors[0], colors[1], colors[2], colors[3]);
+			}
+		}
+	}
+	std::sort(cells.begin(), cells.end());
+}
+
+void TestMapblockMesh::compareGreedy(bool smooth_lighting)
+{
+	std::vector<FaceCell> cells_rows, cells_greedy;
+	u32 quads_rows, quads_greedy;
+
+	MapBlockMesh *mesh = makeMesh(smooth_lighting, false);
+	getFaceCells(mesh, cells_rows, &quads_rows);
+	delete mesh;
+
+	mesh = makeMesh(smooth_lighting, true);
+	getFaceCells(mesh, cells_greedy, &quads_greedy);
+	delete mesh;
+
+	UASSERT(!cells_rows.empty());
+	UASSERT(cells_greedy == cells_rows);
+	// Faces must actually have been merged across rows
+	UASSERT(quads_greedy < quads_rows);
+}
+
+void TestMapblockMesh::testGreedyFlatLighting()
+{
+	compareGreedy(false);
+}
+
+void TestMapblockMesh::testGreedySmoothLighting()
+{
+	compareGreedy(true);
+}
@@ -0,0 +1,139 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <sstream>
+#include "nodetimer.h"
+
+class TestNodeTimer : public TestBase
+{
+public:
+	TestNodeTimer() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestNodeTimer"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testStep();
+	void testScheduler();
+	void testAttachDetach();
+};
+
+static TestNodeTimer g_test_instance;
+
+void TestNodeTimer::runTests(IGameDef *gamedef)
+{
+	TEST(testStep);
+	TEST(testScheduler);
+	TEST(testAttachDetach);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestNodeTimer::testStep()
+{
+	NodeTimerList timers;
+	timers.set(NodeTimer(2.0f, 0.0f, v3s16(1, 2, 3)));
+	timers.set(NodeTimer(5.0f, 1.0f, v3s16(4, 5, 6)));
+
+	UASSERT(timers.step(1.0f).empty());
+	UASSERT(timers.get(v3s16(1, 2, 3)).elapsed == 1.0f);
+
+	std::vector<NodeTimer> elapsed = timers.step(1.5f);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(1, 2, 3));
+	UASSERT(elapsed[0].elapsed == 2.5f);
+	UASSERT(timers.get(v3s16(1, 2, 3)).timeout == 0.0f);
+
+	elapsed = timers.step(1.5f);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(4, 5, 6));
+}
+
+void TestNodeTimer::testScheduler()
+{
+	NodeTimerScheduler scheduler;
+	NodeTimerList a, b;
+	a.attach(&scheduler, v3s16(0, 0, 0));
+	b.attach(&scheduler, v3s16(1, 0, 0));
+
+	a.set(NodeTimer(1.0f, 0.0f, v3s16(1, 1, 1)));
+	a.set(NodeTimer(3.0f, 0.0f, v3s16(2, 2, 2)));
+	b.set(NodeTimer(2.0f, 0.0f, v3s16(3, 3, 3)));
+
+	std::vector<v3s16> due;
+	scheduler.step(0.5f);
+	scheduler.popDueBlocks(due);
+	UASSERT(due.empty());
+
+	// Only the block with an elapsed timer is due
+	scheduler.step(0.5f);
+	scheduler.popDueBlocks(due);
+	UASSERTEQ(size_t, due.size(), 1);
+	UASSERT(due[0] == v3s16(0, 0, 0));
+
+	std::vector<NodeTimer> elapsed;
+	a.popElapsed(elapsed);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(1, 1, 1));
+	UASSERT(b.get(v3s16(3, 3, 3)).elapsed == 1.0f);
+
+	// Both blocks are due, each of them once
+	due.clear();
+	scheduler.step(2.0f);
+	scheduler.popDueBlocks(due);
+	UASSERTEQ(size_t, due.size(), 2);
+	UASSERTEQ(size_t, scheduler.size(), 0);
+}
+
+void TestNodeTimer::testAttachDetach()
+{
+	NodeTimerScheduler scheduler;
+	scheduler.step(100.0f);
+
+	NodeTimerList timers;
+	timers.set(NodeTimer(4.0f, 1.0f, v3s16(1, 2, 3)));
+	timers.attach(&scheduler, v3s16(0, 0, 0));
+	UASSERT(timers.get(v3s16(1, 2, 3)).elapsed == 1.0f);
+
+	scheduler.step(1.0f);
+	UASSERT(timers.get(v3s16(1, 2, 3)).elapsed == 2.0f);
+
+	// Time of detached lists does not advance
+	timers.detach();
+	scheduler.step(10.0f);
+	UASSERT(timers.get(v3s16(1, 2, 3)).elapsed == 2.0f);
+
+	// Serialized data is relative to the time of the list
+	timers.attach(&scheduler, v3s16(0, 0, 0));
+	std::ostringstream os(std::ios::binary);
+	timers.serialize(os, 25);
+	NodeTimerList timers2;
+	std::istringstream is(os.str(), std::ios::binary);
+	timers2.deSerialize(is, 25);
+	UASSERT(timers2.get(v3s16(1, 2, 3)).elapsed == 2.0f);
+
+	std::vector<v3s16> due;
+	scheduler.step(2.0f);
+	scheduler.popDueBlocks(due);
+	UASSERTEQ(size_t, due.size(), 1);
+	std::vector<NodeTimer> elapsed;
+	timers.popElapsed(elapsed);
+	UASSERTEQ(size_t, elapsed.size(), 1);
+}
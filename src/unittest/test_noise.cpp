@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <cmath>
 #include "exceptions.h"
 #include "noise.h"
+#include "mapgen/noise_cache.h"
 
 class TestNoise : public TestBase {
 public:
@@ -35,6 +36,7 @@ class TestNoise : public TestBase {
 	void testNoise3dPoint();
 	void testNoise3dBulk();
 	void testNoiseInvalidParams();
+	void testNoiseCache();
 
 	static const float expected_2d_results[10 * 10];
 	static const float expected_3d_results[10 * 10 * 10];
@@ -49,6 +51,7 @@ void TestNoise::runTests(IGameDef *gamedef)
 	TEST(testNoise3dPoint);
 	TEST(testNoise3dBulk);
 	TEST(testNoiseInvalidParams);
+	TEST(testNoiseCache);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -121,6 +124,33 @@ void TestNoise::testNoiseInvalidParams()
 	UASSERT(exception_thrown);
 }
 
+void TestNoise::testNoiseCache()
+{
+	NoiseParams np_normal(20, 40, v3f(50, 50, 50), 9, 5, 0.6, 2.0);
+	NoiseParams np_persist(0.6, 0.1, v3f(200, 200, 200), 539, 3, 0.6, 2.0);
+	Noise noise_cached(&np_normal, 1337, 10, 10);
+	Noise noise_direct(&np_normal, 1337, 10, 10);
+	Noise noise_persist(&np_persist, 1337, 10, 10);
+
+	// Small enough for some maps to be evicted between the passes
+	NoiseCache cache(3);
+
+	for (u32 pass = 0; pass != 3; pass++)
+	for (s16 x = 0; x != 50; x += 10) {
+		cache.perlinMap2D(&noise_cached, x, -10);
+		noise_direct.perlinMap2D(x, -10);
+		for (u32 i = 0; i != 10 * 10; i++)
+			UASSERTEQ(float, noise_cached.result[i], noise_direct.result[i]);
+
+		// Maps calculated with a persistence map are cached separately
+		cache.perlinMap2D(&noise_persist, x, -10);
+		cache.perlinMap2D(&noise_cached, x, -10, &noise_persist);
+		noise_direct.perlinMap2D(x, -10, noise_persist.result);
+		for (u32 i = 0; i != 10 * 10; i++)
+			UASSERTEQ(float, noise_cached.result[i], noise_direct.result[i]);
+	}
+}
+
 const float TestNoise::expected_2d_results[10 * 10] = {
 	19.11726, 18.49626, 16.48476, 15.02135, 14.75713, 16.26008, 17.54822,
 	18.06860, 18.57016, 18.48407, 18.49649, 17.89160, 15.94162, 14.54901,
@@ -0,0 +1,161 @@
+/*
+Minetest
+Copyright (C) 2019 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <cstdlib>
+#include "gamedef.h"
+#include "log.h"
+#include "map.h"
+#include "mapblock.h"
+#include "mapsector.h"
+#include "pathfinder.h"
+
+class TestPathfinder : public TestBase {
+public:
+	TestPathfinder() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestPathfinder"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testPath(IGameDef *gamedef);
+	void testLimits(IGameDef *gamedef);
+
+private:
+	void buildCourse(Map *map, IGameDef *gamedef);
+	void checkPath(Map *map, const std::vector<v3s16> &path);
+
+	static const v3s16 SOURCE;
+	static const v3s16 DESTINATION;
+	// Shortest number of moves from SOURCE to DESTINATION
+	static const u32 MOVES = 20;
+};
+
+static TestPathfinder g_test_instance;
+
+const v3s16 TestPathfinder::SOURCE(1, 4, 5);
+const v3s16 TestPathfinder::DESTINATION(13, 2, 5);
+
+void TestPathfinder::runTests(IGameDef *gamedef)
+{
+	TEST(testPath, gamedef);
+	TEST(testLimits, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+	A single mapblock, walked along X:
+	- floor to stand on at y = 4 for x < 4
+	- a platform one node higher for 4 <= x < 8, to jump onto
+	- a floor three nodes lower for x >= 8, to drop to
+	- a wall at x = 11 for 2 <= z <= 8, to walk around
+	All other blocks are not loaded, so the path has to stay in this one.
+*/
+void TestPathfinder::buildCourse(Map *map, IGameDef *gamedef)
+{
+	MapSector *sector = new MapSector(map, v2s16(0, 0), gamedef);
+	(*map->getSectorsPtr())[v2s16(0, 0)] = sector;
+	sector->createBlankBlock(0);
+
+	MapNode n_air(CONTENT_AIR);
+	MapNode n_stone(t_CONTENT_STONE);
+
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+		s16 floor_y = x < 4 ? 3 : x < 8 ? 4 : 1;
+		bool wall = x == 11 && z >= 2 && z <= 8 && y <= 12;
+		map->setNode(v3s16(x, y, z), y <= floor_y || wall ? n_stone : n_air);
+	}
+}
+
+void TestPathfinder::checkPath(Map *map, const std::vector<v3s16> &path)
+{
+	UASSERTEQ(size_t, path.size(), MOVES + 1);
+	UASSERT(path.front() == SOURCE);
+	UASSERT(path.back() == DESTINATION);
+
+	const NodeDefManager *ndef = map->getNodeDefManager();
+	for (size_t i = 0; i < path.size(); i++) {
+		// Each position is free and stood on
+		UASSERT(!ndef->get(map->getNode(path[i])).walkable);
+		UASSERT(ndef->get(map->getNode(path[i] + v3s16(0, -1, 0))).walkable);
+		if (i == 0)
+			continue;
+
+		// One horizontal step, at most one node up and three down
+		v3s16 d = path[i] - path[i - 1];
+		UASSERTEQ(int, std::abs(d.X) + std::abs(d.Z), 1);
+		UASSERT(d.Y <= 1 && d.Y >= -3);
+	}
+}
+
+void TestPathfinder::testPath(IGameDef *gamedef)
+{
+	Map map(null_stream, gamedef);
+	buildCourse(&map, gamedef);
+	PathfinderCache cache(gamedef->ndef());
+
+	for (PathAlgorithm algo : {PA_PLAIN, PA_PLAIN_NP, PA_DIJKSTRA}) {
+		// Without and with the cache shared between searches, twice to
+		// use the cached blocks
+		checkPath(&map, get_path(&map, gamedef->ndef(), nullptr,
+			SOURCE, DESTINATION, 8, 1, 3, algo));
+		for (int i = 0; i < 2; i++)
+			checkPath(&map, get_path(&map, gamedef->ndef(), &cache,
+				SOURCE, DESTINATION, 8, 1, 3, algo));
+	}
+
+	// Dijkstra finds a path as short as A*
+	UASSERTEQ(size_t, get_path(&map, gamedef->ndef(), &cache,
+		SOURCE, DESTINATION, 8, 1, 3, PA_PLAIN).size(),
+		get_path(&map, gamedef->ndef(), &cache,
+		SOURCE, DESTINATION, 8, 1, 3, PA_DIJKSTRA).size());
+
+	// The way back needs a jump of three nodes
+	for (PathAlgorithm algo : {PA_PLAIN, PA_DIJKSTRA}) {
+		UASSERT(get_path(&map, gamedef->ndef(), &cache, DESTINATION, SOURCE,
+			8, 1, 3, algo).empty());
+		UASSERTEQ(size_t, get_path(&map, gamedef->ndef(), &cache,
+			DESTINATION, SOURCE, 8, 3, 3, algo).size(), MOVES + 1);
+	}
+}
+
+void TestPathfinder::testLimits(IGameDef *gamedef)
+{
+	Map map(null_stream, gamedef);
+	buildCourse(&map, gamedef);
+
+	for (PathAlgorithm algo : {PA_PLAIN, PA_DIJKSTRA}) {
+		// Too low to jump onto the platform, or to drop from it
+		UASSERT(get_path(&map, gamedef->ndef(), nullptr,
+			SOURCE, DESTINATION, 8, 0, 3, algo).empty());
+		UASSERT(get_path(&map, gamedef->ndef(), nullptr,
+			SOURCE, DESTINATION, 8, 1, 2, algo).empty());
+
+		// Too close to walk around the wall
+		UASSERT(get_path(&map, gamedef->ndef(), nullptr,
+			SOURCE, DESTINATION, 3, 1, 3, algo).empty());
+
+		// Not standing on a surface
+		UASSERT(get_path(&map, gamedef->ndef(), nullptr,
+			SOURCE + v3s16(0, 1, 0), DESTINATION, 8, 1, 3, algo).empty());
+	}
+}
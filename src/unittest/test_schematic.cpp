@@ -21,7 +21,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "mapgen/mg_schematic.h"
 #include "gamedef.h"
+#include "map.h"
 #include "nodedef.h"
+#include "util/numeric.h"
 
 class TestSchematic : public TestBase {
 public:
@@ -33,6 +35,7 @@ class TestSchematic : public TestBase {
 	void testMtsSerializeDeserialize(const NodeDefManager *ndef);
 	void testLuaTableSerialize(const NodeDefManager *ndef);
 	void testFileSerializeDeserialize(const NodeDefManager *ndef);
+	void testCompiledBlit(const NodeDefManager *ndef);
 
 	static const content_t test_schem1_data[7 * 6 * 4];
 	static const content_t test_schem2_data[3 * 3 * 3];
@@ -52,6 +55,7 @@ void TestSchematic::runTests(IGameDef *gamedef)
 	TEST(testMtsSerializeDeserialize, ndef);
 	TEST(testLuaTableSerialize, ndef);
 	TEST(testFileSerializeDeserialize, ndef);
+	TEST(testCompiledBlit, ndef);
 
 	ndef->resetNodeResolveState();
 }
@@ -181,6 +185,71 @@ void TestSchematic::testFileSerializeDeserialize(const NodeDefManager *ndef)
 }
 
 
+void TestSchematic::testCompiledBlit(const NodeDefManager *ndef)
+{
+	static const v3s16 size(7, 6, 4);
+	static const u32 volume = size.X * size.Y * size.Z;
+	const content_t content_map[] = {
+		CONTENT_IGNORE,
+		t_CONTENT_STONE,
+		t_CONTENT_TORCH,
+		CONTENT_AIR,
+	};
+
+	Schematic generic, compiled;
+	for (Schematic *schem : {&generic, &compiled}) {
+		schem->m_ndef      = ndef;
+		schem->flags       = 0;
+		schem->size        = size;
+		schem->schemdata   = new MapNode[volume];
+		schem->slice_probs = new u8[size.Y];
+		for (size_t i = 0; i != volume; i++) {
+			u8 param1 = (i % 5 == 0) ? 60 : MTSCHEM_PROB_ALWAYS;
+			if (i % 7 == 0)
+				param1 |= MTSCHEM_FORCE_PLACE;
+			schem->schemdata[i] = MapNode(content_map[test_schem1_data[i]],
+				param1, i % 4);
+		}
+		for (s16 y = 0; y != size.Y; y++)
+			schem->slice_probs[y] = (y == 2) ? 64 : MTSCHEM_PROB_ALWAYS;
+	}
+
+	UASSERT(!compiled.isCompiled());
+	compiled.compile();
+	UASSERT(compiled.isCompiled());
+
+	// Partially outside of the voxel area, over some existing nodes
+	VoxelArea area(v3s16(0, 0, 0), v3s16(7, 7, 7));
+	v3s16 p(-2, 3, 2);
+
+	for (int rot = ROTATE_0; rot <= ROTATE_270; rot++)
+	for (int force = 0; force != 2; force++) {
+		MMVManip vm_generic(nullptr);
+		MMVManip vm_compiled(nullptr);
+		vm_generic.addArea(area);
+		vm_compiled.addArea(area);
+		for (s32 i = 0; i != area.getVolume(); i++) {
+			vm_generic.m_data[i] =
+				MapNode((i % 3) ? CONTENT_AIR : t_CONTENT_STONE);
+			vm_compiled.m_data[i] = vm_generic.m_data[i];
+		}
+
+		mysrand(1234);
+		generic.blitToVManip(&vm_generic, p, (Rotation)rot, force);
+		int next_generic = myrand_range(0, 1000000);
+
+		mysrand(1234);
+		compiled.blitToVManip(&vm_compiled, p, (Rotation)rot, force);
+		int next_compiled = myrand_range(0, 1000000);
+
+		// Both must also draw the same amount of random numbers
+		UASSERTEQ(int, next_compiled, next_generic);
+		for (s32 i = 0; i != area.getVolume(); i++)
+			UASSERT(vm_compiled.m_data[i] == vm_generic.m_data[i]);
+	}
+}
+
+
 // Should form a cross-shaped-thing...?
 const content_t TestSchematic::test_schem1_data[7 * 6 * 4] = {
 	3, 3, 1, 1, 1, 3, 3, // Y=0, Z=0
@@ -47,6 +47,7 @@ class TestServerActiveObjectMgr : public TestBase
 	void testRegisterObject();
 	void testRemoveObject();
 	void testGetObjectsInsideRadius();
+	void testGetObjectsInsideRadiusBatched();
 	void testGetAddedActiveObjectsAroundPos();
 };
 
@@ -58,6 +59,7 @@ void TestServerActiveObjectMgr::runTests(IGameDef *gamedef)
 	TEST(testRegisterObject)
 	TEST(testRemoveObject)
 	TEST(testGetObjectsInsideRadius);
+	TEST(testGetObjectsInsideRadiusBatched);
 	TEST(testGetAddedActiveObjectsAroundPos);
 }
 
@@ -159,6 +161,44 @@ void TestServerActiveObjectMgr::testGetObjectsInsideRadius()
 	clearSAOMgr(&saomgr);
 }
 
+void TestServerActiveObjectMgr::testGetObjectsInsideRadiusBatched()
+{
+	server::ActiveObjectMgr saomgr;
+	static const v3f sao_pos[] = {
+			v3f(10, 40, 10),
+			v3f(740, 100, -304),
+			v3f(-200, 100, -304),
+			v3f(740, -740, -304),
+			v3f(1500, -740, -304),
+			v3f(-45, -45, 0),
+	};
+
+	for (const auto &p : sao_pos) {
+		saomgr.registerObject(new TestServerActiveObject(p));
+	}
+
+	// Must match the single position query for every position
+	std::vector<v3f> positions = {
+			v3f(), v3f(700, 100, -300), v3f(-5000, 0, 0), v3f(-200, 80, -300),
+			v3f(40, 0, 40),
+	};
+	std::vector<std::vector<u16>> results;
+	saomgr.getObjectsInsideRadius(positions, 64, results);
+	UASSERTEQ(size_t, results.size(), positions.size());
+
+	for (size_t i = 0; i < positions.size(); i++) {
+		std::vector<u16> expected;
+		saomgr.getObjectsInsideRadius(positions[i], 64, expected);
+		std::sort(expected.begin(), expected.end());
+		std::sort(results[i].begin(), results[i].end());
+		UASSERT(results[i] == expected);
+	}
+	UASSERTCMP(int, ==, results[0].size(), 2);
+	UASSERTCMP(int, ==, results[2].size(), 0);
+
+	clearSAOMgr(&saomgr);
+}
+
 void TestServerActiveObjectMgr::testGetAddedActiveObjectsAroundPos()
 {
 	server::ActiveObjectMgr saomgr;
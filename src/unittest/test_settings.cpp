@@ -31,6 +31,7 @@ class TestSettings : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testAllSettings();
+	void testSettingHandle();
 
 	static const char *config_text_before;
 	static const std::string config_text_after;
@@ -41,6 +42,7 @@ static TestSettings g_test_instance;
 void TestSettings::runTests(IGameDef *gamedef)
 {
 	TEST(testAllSettings);
+	TEST(testSettingHandle);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -206,3 +208,45 @@ void TestSettings::testAllSettings()
 		UASSERT(!"Setting not found!");
 	}
 }
+
+void TestSettings::testSettingHandle()
+{
+	Settings s;
+	s.setDefault("handle_u16", "10");
+	s.set("handle_float", "1.5");
+
+	SettingHandle<u16> h_u16("handle_u16", &s);
+	SettingHandle<float> h_float("handle_float", &s);
+	SettingHandle<bool> h_bool("handle_bool", &s);
+
+	UASSERTEQ(u16, h_u16.get(), 10);
+	UASSERT(std::fabs(h_float - 1.5f) < 0.001f);
+	UASSERTEQ(bool, h_bool.get(), false);
+
+	SettingHandle<s16> h_fallback("handle_missing", &s, 42);
+	UASSERTEQ(s16, h_fallback.get(), 42);
+
+	// Values follow changes of the setting
+	s.setU16("handle_u16", 20);
+	s.setFloat("handle_float", 2.5f);
+	s.setBool("handle_bool", true);
+	UASSERTEQ(u16, h_u16.get(), 20);
+	UASSERT(std::fabs(h_float - 2.5f) < 0.001f);
+	UASSERTEQ(bool, h_bool.get(), true);
+
+	// Falls back to the default when removed
+	s.remove("handle_u16");
+	UASSERTEQ(u16, h_u16.get(), 10);
+
+	// Removed entirely, the last value is kept
+	s.remove("handle_bool");
+	UASSERTEQ(bool, h_bool.get(), true);
+
+	// Handles stop listening when destroyed
+	{
+		SettingHandle<s32> h_s32("handle_s32", &s);
+		s.setS32("handle_s32", -5);
+		UASSERTEQ(s32, h_s32.get(), -5);
+	}
+	s.setS32("handle_s32", 7);
+}
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include <atomic>
 #include "threading/semaphore.h"
+#include "threading/task_pool.h"
 #include "threading/thread.h"
 
 
@@ -33,6 +34,7 @@ class TestThreading : public TestBase {
 	void testStartStopWait();
 	void testThreadKill();
 	void testAtomicSemaphoreThread();
+	void testTaskPool();
 };
 
 static TestThreading g_test_instance;
@@ -42,6 +44,7 @@ void TestThreading::runTests(IGameDef *gamedef)
 	TEST(testStartStopWait);
 	TEST(testThreadKill);
 	TEST(testAtomicSemaphoreThread);
+	TEST(testTaskPool);
 }
 
 class SimpleTestThread : public Thread {
@@ -181,3 +184,35 @@ void TestThreading::testAtomicSemaphoreThread()
 	UASSERT(val == num_threads * 0x10000);
 }
 
+
+
+void TestThreading::testTaskPool()
+{
+	// A pool without workers runs everything on the calling thread
+	for (unsigned int num_threads : {0, 3}) {
+		TaskPool pool("TaskPoolTest", num_threads);
+		UASSERT(pool.getThreadCount() == num_threads);
+
+		// Every index is processed exactly once
+		std::vector<std::atomic<u32>> counts(1000);
+		for (auto &count : counts)
+			count = 0;
+		for (u32 i = 0; i < 10; i++)
+			pool.run(counts.size(), [&] (unsigned int i) { ++counts[i]; });
+		for (auto &count : counts)
+			UASSERT(count == 10);
+
+		std::atomic<u32> val;
+		val = 0;
+		pool.run({
+			[&] () { val += 1; },
+			[&] () { val += 2; },
+			[&] () { val += 4; },
+		});
+		UASSERT(val == 7);
+
+		// Empty jobs return immediately
+		pool.run(0, [&] (unsigned int i) { val = 0; });
+		UASSERT(val == 7);
+	}
+}
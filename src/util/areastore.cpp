@@ -20,6 +20,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "util/areastore.h"
 #include "util/serialize.h"
 #include "util/container.h"
+#include <algorithm>
+#include <cmath>
 
 #if USE_SPATIAL
 	#include <spatialindex/SpatialIndex.h>
@@ -50,7 +52,7 @@ AreaStore *AreaStore::getOptimalImplementation()
 #if USE_SPATIAL
 	return new SpatialAreaStore();
 #else
-	return new VectorAreaStore();
+	return new RTreeAreaStore();
 #endif
 }
 
@@ -68,6 +70,27 @@ void AreaStore::serialize(std::ostream &os) const
 	// Before 5.1.0-dev: version != 0 throws SerializationError
 	// After 5.1.0-dev:  version >= 5 throws SerializationError
 	// Forwards-compatibility is assumed before version 5.
+	// Version 5 is only written if the store does not fit into version 0,
+	// which silently truncated counts and data lengths to 16 bits.
+
+	bool fits_version_0 = areas_map.size() <= U16_MAX;
+	for (auto it = areas_map.begin(); fits_version_0 && it != areas_map.end(); ++it)
+		fits_version_0 = it->second.data.size() <= U16_MAX;
+
+	if (!fits_version_0) {
+		writeU8(os, 5); // Serialisation version
+
+		writeU32(os, areas_map.size());
+		for (const auto &it : areas_map) {
+			const Area &a = it.second;
+			writeU32(os, a.id);
+			writeV3S16(os, a.minedge);
+			writeV3S16(os, a.maxedge);
+			writeU32(os, a.data.size());
+			os.write(a.data.data(), a.data.size());
+		}
+		return;
+	}
 
 	writeU8(os, 0); // Serialisation version
 
@@ -90,31 +113,57 @@ void AreaStore::deserialize(std::istream &is)
 {
 	u8 ver = readU8(is);
 	// Assume forwards-compatibility before version 5
-	if (ver >= 5)
+	if (ver > 5)
 		throw SerializationError("Unknown AreaStore "
 				"serialization version!");
 
-	u16 num_areas = readU16(is);
 	std::vector<Area> areas;
+
+	if (ver == 5) {
+		u32 num_areas = readU32(is);
+		for (u32 i = 0; i < num_areas; ++i) {
+			Area a(readU32(is));
+			a.minedge = readV3S16(is);
+			a.maxedge = readV3S16(is);
+			u32 data_len = readU32(is);
+			if (!is.good())
+				throw SerializationError("Truncated AreaStore data");
+			a.data.resize(data_len);
+			is.read(&a.data[0], data_len);
+			areas.push_back(std::move(a));
+		}
+		if (!is.good())
+			throw SerializationError("Truncated AreaStore data");
+
+		insertAreas(areas);
+		return;
+	}
+
+	u16 num_areas = readU16(is);
+	areas.reserve(num_areas);
 	for (u32 i = 0; i < num_areas; ++i) {
 		Area a(U32_MAX);
 		a.minedge = readV3S16(is);
 		a.maxedge = readV3S16(is);
 		u16 data_len = readU16(is);
-		char *data = new char[data_len];
-		is.read(data, data_len);
-		a.data = std::string(data, data_len);
-		areas.emplace_back(a);
-		delete [] data;
+		a.data.resize(data_len);
+		is.read(&a.data[0], data_len);
+		areas.push_back(std::move(a));
 	}
 
 	bool read_ids = is.good(); // EOF for old formats
 
-	for (auto &area : areas) {
-		if (read_ids)
+	if (read_ids) {
+		for (auto &area : areas)
 			area.id = readU32(is);
-		insertArea(&area);
 	}
+	insertAreas(areas);
+}
+
+void AreaStore::insertAreas(std::vector<Area> &areas)
+{
+	for (Area &area : areas)
+		insertArea(&area);
 }
 
 void AreaStore::invalidateCache()
@@ -126,6 +175,10 @@ void AreaStore::invalidateCache()
 
 u32 AreaStore::getNextId() const
 {
+	// Without gaps the IDs are 0 to size() - 1
+	if (areas_map.empty() || areas_map.rbegin()->first == areas_map.size() - 1)
+		return areas_map.size();
+
 	u32 free_id = 0;
 	for (const auto &area : areas_map) {
 		if (area.first > free_id)
@@ -242,6 +295,482 @@ void VectorAreaStore::getAreasInArea(std::vector<Area *> *result,
 	}
 }
 
+////
+// RTreeAreaStore
+////
+
+
+static inline void box_extend(v3s16 &minedge, v3s16 &maxedge,
+		const v3s16 &omin, const v3s16 &omax)
+{
+	minedge.X = MYMIN(minedge.X, omin.X);
+	minedge.Y = MYMIN(minedge.Y, omin.Y);
+	minedge.Z = MYMIN(minedge.Z, omin.Z);
+	maxedge.X = MYMAX(maxedge.X, omax.X);
+	maxedge.Y = MYMAX(maxedge.Y, omax.Y);
+	maxedge.Z = MYMAX(maxedge.Z, omax.Z);
+}
+
+static inline s64 box_volume(const v3s16 &minedge, const v3s16 &maxedge)
+{
+	return (s64)(maxedge.X - minedge.X + 1) *
+		(s64)(maxedge.Y - minedge.Y + 1) *
+		(s64)(maxedge.Z - minedge.Z + 1);
+}
+
+// Volume of the box after extending it to include the other one
+static inline s64 box_volume_extended(v3s16 minedge, v3s16 maxedge,
+		const v3s16 &omin, const v3s16 &omax)
+{
+	box_extend(minedge, maxedge, omin, omax);
+	return box_volume(minedge, maxedge);
+}
+
+// Center of the box along one axis, doubled to stay integral
+static inline s32 box_center2(const v3s16 &minedge, const v3s16 &maxedge,
+		int axis)
+{
+	switch (axis) {
+	case 0:
+		return (s32)minedge.X + maxedge.X;
+	case 1:
+		return (s32)minedge.Y + maxedge.Y;
+	default:
+		return (s32)minedge.Z + maxedge.Z;
+	}
+}
+
+/*
+	Sort-Tile-Recursive ordering: sorts the items into slabs along X, each
+	slab into columns along Y and each column along Z, so that consecutive
+	runs of node_size items form nodes with little overlap.
+	T is Area or RTreeAreaStore::Node.
+*/
+template <typename T>
+static void str_sort(std::vector<T *> &items, u32 node_size)
+{
+	u32 num_nodes = (items.size() + node_size - 1) / node_size;
+	u32 slices = (u32)std::ceil(std::cbrt((double)num_nodes));
+	size_t slab = (size_t)node_size * slices * slices;
+	size_t column = (size_t)node_size * slices;
+
+	auto sort_range = [&items] (size_t begin, size_t end, int axis) {
+		std::sort(items.begin() + begin, items.begin() + end,
+			[axis] (const T *a, const T *b) {
+				return box_center2(a->minedge, a->maxedge, axis) <
+					box_center2(b->minedge, b->maxedge, axis);
+			});
+	};
+
+	sort_range(0, items.size(), 0);
+	for (size_t x = 0; x < items.size(); x += slab) {
+		size_t x_end = MYMIN(x + slab, items.size());
+		sort_range(x, x_end, 1);
+		for (size_t y = x; y < x_end; y += column)
+			sort_range(y, MYMIN(y + column, x_end), 2);
+	}
+}
+
+void RTreeAreaStore::Node::updateBox()
+{
+	if (count() == 0) {
+		minedge = maxedge = v3s16(0, 0, 0);
+		return;
+	}
+
+	if (leaf) {
+		minedge = areas[0]->minedge;
+		maxedge = areas[0]->maxedge;
+		for (const Area *a : areas)
+			box_extend(minedge, maxedge, a->minedge, a->maxedge);
+	} else {
+		minedge = children[0]->minedge;
+		maxedge = children[0]->maxedge;
+		for (const Node *child : children)
+			box_extend(minedge, maxedge, child->minedge, child->maxedge);
+	}
+}
+
+RTreeAreaStore::RTreeAreaStore() :
+	m_root(new Node(true))
+{
+}
+
+RTreeAreaStore::~RTreeAreaStore()
+{
+	deleteTree(m_root);
+}
+
+void RTreeAreaStore::deleteTree(Node *node)
+{
+	for (Node *child : node->children)
+		deleteTree(child);
+	delete node;
+}
+
+void RTreeAreaStore::collectAreas(Node *node, std::vector<Area *> *dest)
+{
+	if (node->leaf) {
+		dest->insert(dest->end(), node->areas.begin(), node->areas.end());
+		return;
+	}
+	for (Node *child : node->children)
+		collectAreas(child, dest);
+}
+
+bool RTreeAreaStore::insertArea(Area *a)
+{
+	if (a->id == U32_MAX)
+		a->id = getNextId();
+	std::pair<AreaMap::iterator, bool> res =
+			areas_map.insert(std::make_pair(a->id, *a));
+	if (!res.second)
+		// ID is not unique
+		return false;
+	insert(&res.first->second);
+	invalidateCache();
+	return true;
+}
+
+void RTreeAreaStore::insert(Area *a)
+{
+	// Descend into the child needing the least enlargement
+	Node *node = m_root;
+	while (!node->leaf) {
+		Node *best = nullptr;
+		s64 best_growth = 0, best_volume = 0;
+		for (Node *child : node->children) {
+			s64 volume = box_volume(child->minedge, child->maxedge);
+			s64 growth = box_volume_extended(child->minedge, child->maxedge,
+				a->minedge, a->maxedge) - volume;
+			if (!best || growth < best_growth ||
+					(growth == best_growth && volume < best_volume)) {
+				best = child;
+				best_growth = growth;
+				best_volume = volume;
+			}
+		}
+		node = best;
+	}
+
+	node->areas.push_back(a);
+	node->updateBox();
+	for (Node *n = node->parent; n; n = n->parent)
+		box_extend(n->minedge, n->maxedge, a->minedge, a->maxedge);
+
+	if (node->count() > MAX_ENTRIES)
+		split(node);
+}
+
+void RTreeAreaStore::split(Node *node)
+{
+	// Quadratic split as described by Guttman
+	const u32 count = node->count();
+	std::vector<v3s16> mins(count), maxs(count);
+	for (u32 i = 0; i < count; i++) {
+		if (node->leaf) {
+			mins[i] = node->areas[i]->minedge;
+			maxs[i] = node->areas[i]->maxedge;
+		} else {
+			mins[i] = node->children[i]->minedge;
+			maxs[i] = node->children[i]->maxedge;
+		}
+	}
+
+	// Seeds: the pair that would waste the most volume in one node
+	u32 seed[2] = {0, 1};
+	s64 worst_waste = S64_MIN;
+	for (u32 i = 0; i < count; i++)
+	for (u32 j = i + 1; j < count; j++) {
+		s64 waste = box_volume_extended(mins[i], maxs[i], mins[j], maxs[j]) -
+			box_volume(mins[i], maxs[i]) - box_volume(mins[j], maxs[j]);
+		if (waste > worst_waste) {
+			worst_waste = waste;
+			seed[0] = i;
+			seed[1] = j;
+		}
+	}
+
+	std::vector<u8> group(count, 2);
+	v3s16 gmin[2], gmax[2];
+	u32 gcount[2] = {1, 1};
+	for (u8 g = 0; g < 2; g++) {
+		group[seed[g]] = g;
+		gmin[g] = mins[seed[g]];
+		gmax[g] = maxs[seed[g]];
+	}
+
+	u32 remaining = count - 2;
+	while (remaining > 0) {
+		// Give the rest to a group that would be underfull otherwise
+		u8 forced = 2;
+		if (gcount[0] + remaining <= MIN_ENTRIES)
+			forced = 0;
+		else if (gcount[1] + remaining <= MIN_ENTRIES)
+			forced = 1;
+		if (forced != 2) {
+			for (u32 i = 0; i < count; i++) {
+				if (group[i] == 2) {
+					group[i] = forced;
+					box_extend(gmin[forced], gmax[forced], mins[i], maxs[i]);
+				}
+			}
+			break;
+		}
+
+		// Pick the entry with the strongest preference for one group
+		u32 pick = 0;
+		s64 pick_diff = -1, pick_growth[2] = {0, 0};
+		for (u32 i = 0; i < count; i++) {
+			if (group[i] != 2)
+				continue;
+			s64 growth[2];
+			for (u8 g = 0; g < 2; g++)
+				growth[g] = box_volume_extended(gmin[g], gmax[g], mins[i], maxs[i]) -
+					box_volume(gmin[g], gmax[g]);
+			s64 diff = growth[0] > growth[1] ?
+				growth[0] - growth[1] : growth[1] - growth[0];
+			if (diff > pick_diff) {
+				pick = i;
+				pick_diff = diff;
+				pick_growth[0] = growth[0];
+				pick_growth[1] = growth[1];
+			}
+		}
+
+		u8 g;
+		if (pick_growth[0] != pick_growth[1])
+			g = pick_growth[0] < pick_growth[1] ? 0 : 1;
+		else if (box_volume(gmin[0], gmax[0]) != box_volume(gmin[1], gmax[1]))
+			g = box_volume(gmin[0], gmax[0]) < box_volume(gmin[1], gmax[1]) ? 0 : 1;
+		else
+			g = gcount[0] <= gcount[1] ? 0 : 1;
+
+		group[pick] = g;
+		box_extend(gmin[g], gmax[g], mins[pick], maxs[pick]);
+		gcount[g]++;
+		remaining--;
+	}
+
+	// Group 0 stays in the node, group 1 moves to a new sibling
+	Node *sibling = new Node(node->leaf);
+	if (node->leaf) {
+		std::vector<Area *> keep;
+		for (u32 i = 0; i < count; i++)
+			(group[i] == 0 ? keep : sibling->areas).push_back(node->areas[i]);
+		node->areas.swap(keep);
+	} else {
+		std::vector<Node *> keep;
+		for (u32 i = 0; i < count; i++) {
+			Node *child = node->children[i];
+			if (group[i] == 0) {
+				keep.push_back(child);
+			} else {
+				sibling->children.push_back(child);
+				child->parent = sibling;
+			}
+		}
+		node->children.swap(keep);
+	}
+	node->updateBox();
+	sibling->updateBox();
+
+	if (node == m_root) {
+		m_root = new Node(false);
+		m_root->children.push_back(node);
+		m_root->children.push_back(sibling);
+		node->parent = sibling->parent = m_root;
+		m_root->updateBox();
+		return;
+	}
+
+	// The parent's box does not change, it still covers both halves
+	Node *parent = node->parent;
+	parent->children.push_back(sibling);
+	sibling->parent = parent;
+	if (parent->count() > MAX_ENTRIES)
+		split(parent);
+}
+
+RTreeAreaStore::Node *RTreeAreaStore::findLeaf(Node *node, const Area *a)
+{
+	if (node->leaf) {
+		if (std::find(node->areas.begin(), node->areas.end(), a) !=
+				node->areas.end())
+			return node;
+		return nullptr;
+	}
+
+	for (Node *child : node->children) {
+		if (!AST_CONTAINS_AREA(child->minedge, child->maxedge, a))
+			continue;
+		Node *leaf = findLeaf(child, a);
+		if (leaf)
+			return leaf;
+	}
+	return nullptr;
+}
+
+bool RTreeAreaStore::removeArea(u32 id)
+{
+	AreaMap::iterator it = areas_map.find(id);
+	if (it == areas_map.end())
+		return false;
+
+	Area *a = &it->second;
+	Node *leaf = findLeaf(m_root, a);
+	assert(leaf);
+	leaf->areas.erase(std::find(leaf->areas.begin(), leaf->areas.end(), a));
+
+	// Dissolve underfull nodes on the way up, their areas are reinserted
+	std::vector<Area *> orphans;
+	Node *node = leaf;
+	while (node != m_root) {
+		Node *parent = node->parent;
+		if (node->count() < MIN_ENTRIES) {
+			parent->children.erase(std::find(parent->children.begin(),
+				parent->children.end(), node));
+			collectAreas(node, &orphans);
+			deleteTree(node);
+		} else {
+			node->updateBox();
+		}
+		node = parent;
+	}
+	m_root->updateBox();
+
+	// Shorten the tree while the root has a single child
+	while (!m_root->leaf && m_root->children.size() <= 1) {
+		Node *old_root = m_root;
+		if (old_root->children.empty()) {
+			m_root = new Node(true);
+		} else {
+			m_root = old_root->children[0];
+			m_root->parent = nullptr;
+		}
+		delete old_root;
+	}
+
+	areas_map.erase(it);
+	for (Area *orphan : orphans)
+		insert(orphan);
+	invalidateCache();
+	return true;
+}
+
+void RTreeAreaStore::insertAreas(std::vector<Area> &areas)
+{
+	// Inserting a small batch into a big tree is cheaper than a rebuild
+	if (areas.size() < areas_map.size()) {
+		AreaStore::insertAreas(areas);
+		return;
+	}
+
+	for (Area &a : areas) {
+		if (a.id == U32_MAX)
+			a.id = getNextId();
+		// Duplicate IDs are skipped, as insertArea() would do
+		areas_map.insert(std::make_pair(a.id, a));
+	}
+
+	std::vector<Area *> all;
+	all.reserve(areas_map.size());
+	for (auto &it : areas_map)
+		all.push_back(&it.second);
+	bulkLoad(all);
+	invalidateCache();
+}
+
+void RTreeAreaStore::bulkLoad(std::vector<Area *> &areas)
+{
+	deleteTree(m_root);
+	m_root = new Node(true);
+	if (areas.empty())
+		return;
+
+	// Split n items into ceil(n / MAX_ENTRIES) nodes of nearly equal size,
+	// so that no node is underfull
+	auto node_range = [] (size_t n, size_t num_nodes, size_t i) {
+		return n * i / num_nodes;
+	};
+
+	str_sort(areas, MAX_ENTRIES);
+	std::vector<Node *> level;
+	size_t num_nodes = (areas.size() + MAX_ENTRIES - 1) / MAX_ENTRIES;
+	for (size_t i = 0; i < num_nodes; i++) {
+		Node *leaf = new Node(true);
+		leaf->areas.assign(
+			areas.begin() + node_range(areas.size(), num_nodes, i),
+			areas.begin() + node_range(areas.size(), num_nodes, i + 1));
+		leaf->updateBox();
+		level.push_back(leaf);
+	}
+
+	while (level.size() > 1) {
+		str_sort(level, MAX_ENTRIES);
+		std::vector<Node *> upper;
+		num_nodes = (level.size() + MAX_ENTRIES - 1) / MAX_ENTRIES;
+		for (size_t i = 0; i < num_nodes; i++) {
+			Node *inner = new Node(false);
+			inner->children.assign(
+				level.begin() + node_range(level.size(), num_nodes, i),
+				level.begin() + node_range(level.size(), num_nodes, i + 1));
+			for (Node *child : inner->children)
+				child->parent = inner;
+			inner->updateBox();
+			upper.push_back(inner);
+		}
+		level.swap(upper);
+	}
+
+	delete m_root;
+	m_root = level[0];
+}
+
+void RTreeAreaStore::getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos)
+{
+	std::vector<Node *> stack(1, m_root);
+	while (!stack.empty()) {
+		Node *node = stack.back();
+		stack.pop_back();
+		if (node->leaf) {
+			for (Area *area : node->areas) {
+				if (AST_CONTAINS_PT(area, pos))
+					result->push_back(area);
+			}
+			continue;
+		}
+		for (Node *child : node->children) {
+			if (AST_CONTAINS_PT(child, pos))
+				stack.push_back(child);
+		}
+	}
+}
+
+void RTreeAreaStore::getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap)
+{
+	std::vector<Node *> stack(1, m_root);
+	while (!stack.empty()) {
+		Node *node = stack.back();
+		stack.pop_back();
+		if (node->leaf) {
+			for (Area *area : node->areas) {
+				if (accept_overlap ? AST_AREAS_OVERLAP(minedge, maxedge, area) :
+						AST_CONTAINS_AREA(minedge, maxedge, area)) {
+					result->push_back(area);
+				}
+			}
+			continue;
+		}
+		// Areas contained in the queried one overlap it as well
+		for (Node *child : node->children) {
+			if (AST_AREAS_OVERLAP(minedge, maxedge, child))
+				stack.push_back(child);
+		}
+	}
+}
+
 #if USE_SPATIAL
 
 static inline SpatialIndex::Region get_spatial_region(const v3s16 minedge,
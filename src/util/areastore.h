@@ -100,6 +100,10 @@ class AreaStore {
 	void deserialize(std::istream &is);
 
 protected:
+	/// Adds many areas at once, used by deserialize().
+	/// Implementations can override this to build their index in one go.
+	virtual void insertAreas(std::vector<Area> &areas);
+
 	/// Invalidates the getAreasForPos cache.
 	/// Call after adding or removing an area.
 	void invalidateCache();
@@ -144,6 +148,56 @@ class VectorAreaStore : public AreaStore {
 };
 
 
+/*
+	R-tree of the areas' bounding boxes, without external dependencies.
+	Areas are inserted one by one with a quadratic split, batches given to
+	insertAreas() (as by deserialize()) rebuild the whole tree bottom-up
+	with Sort-Tile-Recursive packing.
+*/
+class RTreeAreaStore : public AreaStore {
+public:
+	RTreeAreaStore();
+	virtual ~RTreeAreaStore();
+
+	virtual bool insertArea(Area *a);
+	virtual bool removeArea(u32 id);
+	virtual void getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap);
+
+protected:
+	virtual void getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos);
+	virtual void insertAreas(std::vector<Area> &areas);
+
+private:
+	// Maximum and minimum number of entries per node
+	static const u32 MAX_ENTRIES = 16;
+	static const u32 MIN_ENTRIES = 6;
+
+	struct Node {
+		v3s16 minedge, maxedge;
+		Node *parent = nullptr;
+		bool leaf;
+		// Only used by inner nodes
+		std::vector<Node *> children;
+		// Only used by leaves
+		std::vector<Area *> areas;
+
+		Node(bool is_leaf) : leaf(is_leaf) {}
+		u32 count() const { return leaf ? areas.size() : children.size(); }
+		void updateBox();
+	};
+
+	void insert(Area *a);
+	void split(Node *node);
+	Node *findLeaf(Node *node, const Area *a);
+	void collectAreas(Node *node, std::vector<Area *> *dest);
+	void deleteTree(Node *node);
+	void bulkLoad(std::vector<Area *> &areas);
+
+	Node *m_root;
+};
+
+
 #if USE_SPATIAL
 
 class SpatialAreaStore : public AreaStore {
@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irr_v3d.h"
 #include "irr_aabb3d.h"
 #include <matrix4.h>
+#include <functional>
 
 #define rangelim(d, min, max) ((d) < (min) ? (min) : ((d) > (max) ? (max) : (d)))
 #define myfloor(x) ((x) < 0.0 ? (int)(x) - 1 : (int)(x))
@@ -140,6 +141,16 @@ inline v3s16 componentwise_max(const v3s16 &a, const v3s16 &b)
 	return v3s16(MYMAX(a.X, b.X), MYMAX(a.Y, b.Y), MYMAX(a.Z, b.Z));
 }
 
+// Hash of a block position, for unordered containers keyed by v3s16
+struct BlockPosHash
+{
+	size_t operator()(const v3s16 &p) const
+	{
+		return std::hash<u64>()(((u64)(u16)p.X << 32) |
+			((u64)(u16)p.Y << 16) | (u64)(u16)p.Z);
+	}
+};
+
 
 /** Returns \p f wrapped to the range [-360, 360]
  *